@@ -2,14 +2,32 @@
 #define GC_IS_HPP
 
 #include "gcis_eliasfano_codec.hpp"
+#include "gcis_fingerprint.hpp"
+#include "gcis_format.hpp"
+#include "gcis_level_cache.hpp"
+#include "gcis_level_index.hpp"
+#include "gcis_rule_bucket.hpp"
 #include "gcis_s8b_codec.hpp"
+#include "gcis_saca_external.hpp"
+#include "gcis_stream.hpp"
 #include "gcis_unary_codec.hpp"
 #include "sdsl/bit_vectors.hpp"
 #include "sdsl/int_vector.hpp"
 #include "util.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
-#define chr(i) (cs == sizeof(int_t) ? ((int_t *)s)[i] : ((unsigned char *)s)[i])	
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+// Symbol i of the typed sequence s (see gc_is_level)
+#define chr(i) ((int_t)s[i])
 
 #define false 0
 #define true 1
@@ -21,6 +39,8 @@
 
 #ifdef m64
 const int_t EMPTY = 0xffffffffffffffff;
+#elif defined(m40)
+const uint_t EMPTY = U_MAX;
 #else
 const int EMPTY = 0xffffffff;
 #endif
@@ -36,11 +56,55 @@ unsigned char mask[] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
 
 #define max(a,b) ((a) > (b) ? (a) : (b))
 
+// cs of a text of bytes read through gcis_escaped_text
+#define ESCAPED_BYTES -1
+
+// Runs gc_is_level on s viewed as symbols of cs bytes, or as escaped bytes
+// (see gcis_escaped_text). The reduced strings are packed into 1, 2 or 4
+// bytes per symbol by narrow_reduced_string.
+#define GC_IS_DISPATCH(s, SA, n, K, cs, level)                                 \
+    switch (cs) {                                                              \
+    case ESCAPED_BYTES:                                                        \
+        gc_is_level(gcis_escaped_text((const uint8_t *)(s), (n) - 1), SA, n,   \
+                    K, level);                                                 \
+        break;                                                                 \
+    case 1:                                                                    \
+        gc_is_level((const uint8_t *)(s), SA, n, K, level);                    \
+        break;                                                                 \
+    case 2:                                                                    \
+        gc_is_level((const uint16_t *)(s), SA, n, K, level);                   \
+        break;                                                                 \
+    case 4:                                                                    \
+        gc_is_level((const uint32_t *)(s), SA, n, K, level);                   \
+        break;                                                                 \
+    default:                                                                   \
+        gc_is_level((const uint_t *)(s), SA, n, K, level);                     \
+    }
+
 /**/
+/**
+ * @brief The n bytes of a text containing NUL bytes read as symbols shifted
+ * by one, followed by the sentinel 0, so that the sentinel stays the only
+ * occurrence of the smallest symbol without copying the text.
+ */
+struct gcis_escaped_text {
+    const uint8_t *s;
+    uint64_t n;
+
+    gcis_escaped_text(const uint8_t *s, uint64_t n) : s(s), n(n) {}
+
+    int_t operator[](uint64_t i) const { return i < n ? (int_t)s[i] + 1 : 0; }
+};
+
 #define RMQ   2  //variants = (1, trivial) (2, using Gog's stack)
 #define BINARY 0 //binary search on stack operations
 #define STACK_SIZE 895 //to use 10Kb of working space
 
+#define INDUCE_BLOCK 65536 // SA entries scanned per block by the parallel induced sorting
+#define EXPAND_CHUNK 4096 // reduced string symbols per chunk of the parallel decode
+#define EXTRACT_GROUP_GAP 256 // queries closer than this are extracted together
+#define EXTRACT_GROUP_MAX (1ULL << 20) // longest range of coalesced queries
+
 typedef struct _pair{
   uint_t idx;
   int_t lcp;
@@ -61,14 +125,196 @@ void stack_push(t_pair* STACK, int_t *top, uint_t idx, int_t lcp){
 
 class gcis_interface{
 public:
-    virtual void encode(char *s) = 0;
+    // Encodes the n bytes of s, which may contain NUL bytes. s[n] must be
+    // readable and 0 (the sentinel), as in gcis_mapped_file.
+    virtual void encode(const char *s, uint64_t n) = 0;
+    // Encodes the NUL-terminated string s
+    void encode(const char *s) { encode(s, strlen(s)); }
+    // Encodes the n bytes of s as a collection of documents, each ending
+    // with the byte separator (the last one may omit it), and records
+    // where each document ends. s[n] must be 0, as in encode.
+    virtual void encode_collection(const char *s, uint64_t n,
+                                   char separator) = 0;
+    // Number of documents of a collection, 0 if the text was not encoded
+    // with encode_collection
+    virtual uint64_t document_count() = 0;
+    // Length of the encoded text (the size of decode() without the sentinel)
+    virtual uint64_t text_length() = 0;
     virtual char *decode() = 0;
-    virtual void extract_batch(vector<pair<int,int>>& v_query) = 0;
+    // Writes the text to the file descriptor fd as it is decoded, without
+    // holding it in memory
+    virtual void decode_to(int fd) = 0;
+    // Writes T[l,r] of each query into out[k], which must hold r-l+1
+    // bytes. Overlapping and nearby queries are extracted together, and
+    // the queries are shared among the set_threads threads.
+    virtual void extract_batch(const vector<pair<uint64_t, uint64_t>> &query,
+                               const vector<unsigned char *> &out) = 0;
+    virtual void extract(uint64_t l, uint64_t r, unsigned char *out) = 0;
     virtual unsigned char* decode_saca(uint_t** SA) = 0;
     virtual unsigned char* decode_saca_lcp(uint_t** SA, int_t **LCP) = 0;
+    // Writes the SA, and the LCP array if lcp_fd >= 0 in the given format,
+    // to file descriptors while keeping the arrays in temporary files in
+    // tmp_dir. Throws gcis_memory_error if the arrays it needs do not fit
+    // in memory bytes, 0 setting no budget (see saca_external). Returns the
+    // text, as decode_saca.
+    virtual unsigned char *
+    decode_saca_external(int sa_fd, int lcp_fd, uint64_t memory,
+                         const std::string &tmp_dir,
+                         gcis_lcp_format format = GCIS_LCP_INT,
+                         int overflow_fd = -1) = 0;
+    // Writes the BWT of the text (the sentinel as a NUL byte), and the start
+    // of each of its runs if runs_fd >= 0, as the suffixes are induced,
+    // within memory as decode_saca_external. Returns the text.
+    virtual unsigned char *decode_bwt(int bwt_fd, int runs_fd, uint64_t memory,
+                                      const std::string &tmp_dir) = 0;
+    // Computes the SA and the document array of a collection, DA[i] being
+    // the document of suffix SA[i] (document_count() for the sentinel).
+    // Returns the text, as decode_saca.
+    virtual unsigned char *decode_saca_da(uint_t **SA, uint_t **DA) = 0;
+    // Writes the SA and the document array of a collection to file
+    // descriptors, as decode_saca_external writes the SA and the LCP array
+    virtual unsigned char *decode_saca_da_external(int sa_fd, int da_fd,
+                                                   uint64_t memory,
+                                                   const std::string &tmp_dir) = 0;
     virtual uint64_t size_in_bytes() = 0;
     virtual void serialize(std::ostream &o) = 0;
+    // Writes the layout read in place by gcis_mapped_dictionary
+    virtual void serialize_mapped(std::ostream &o) = 0;
     virtual void load(std::istream &i) = 0;
+    virtual void set_threads(int threads) = 0;
+    // Memory budget of the cache of decompressed levels (0 disables it)
+    virtual void set_level_cache(uint64_t bytes) = 0;
+    // Rules per front-coding bucket of the next encode, 0 choosing it per
+    // level within max_walk (see gcis_rule_builder::choose_bucket)
+    virtual void set_front_coding(uint64_t bucket,
+                                  double max_walk = FRONT_CODING_MAX_WALK) = 0;
+    // Builds in-memory indexes that speed up extract (see gcis_level_index)
+    virtual void build_position_index(bool plain_lengths) = 0;
+    // Computes the Karp-Rabin fingerprints of the rules used by lce and
+    // equal, with a base drawn from seed (see gcis_fingerprints)
+    virtual void build_fingerprints(uint64_t seed = FINGERPRINT_SEED) = 0;
+    // Length of the longest common prefix of the suffixes of the text
+    // starting at i and j, 0 if either is past its end
+    virtual uint64_t lce(uint64_t i, uint64_t j) = 0;
+    // lce of every pair of query into out, the queries sharing the buffers
+    // of the walks down the grammar
+    virtual void lce_batch(const vector<pair<uint64_t, uint64_t>> &query,
+                           vector<uint64_t> &out) = 0;
+    // Whether T[i, i+len) equals T[j, j+len), false if either goes past
+    // the end of the text. Fingerprints of different substrings collide
+    // with probability at most len / 2^61.
+    virtual bool equal(uint64_t i, uint64_t j, uint64_t len) = 0;
+
+    /**
+     * @brief Extracts several valid substrings of the form T[l,r]
+     * from the text and prints each one in a line, followed by the time
+     * spent extracting them.
+     *
+     * @param query A vector containing [l,r] pairs.
+     */
+    void extract_batch(const vector<pair<uint64_t, uint64_t>> &query) {
+        vector<std::string> text(query.size());
+        vector<unsigned char *> out(query.size());
+        for (uint64_t k = 0; k < query.size(); k++) {
+            text[k].resize(query[k].second - query[k].first + 1);
+            out[k] = (unsigned char *)&text[k][0];
+        }
+        auto t0 = std::chrono::high_resolution_clock::now();
+        extract_batch(query, out);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (auto &t : text) {
+            cout << t << endl;
+        }
+        std::chrono::duration<double> elapsed = t1 - t0;
+        cout << "Batch Extraction Total time(s): " << elapsed.count() << endl;
+    }
+
+  protected:
+    /**
+     * @brief Sorts the queries by their left end into order, and coalesces
+     * the queries overlapping or less than EXTRACT_GROUP_GAP symbols apart
+     * into groups. Group g covers T[group[g].first, group[g].second] and
+     * the queries order[begin[g], begin[g+1]). A group grows up to
+     * EXTRACT_GROUP_MAX symbols, unless its first query alone is longer.
+     */
+    static void coalesce_queries(const vector<pair<uint64_t, uint64_t>> &query,
+                                 vector<uint64_t> &order,
+                                 vector<pair<uint64_t, uint64_t>> &group,
+                                 vector<uint64_t> &begin) {
+        order.resize(query.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+            return query[a] < query[b];
+        });
+        group.clear();
+        begin.clear();
+        for (uint64_t i = 0; i < order.size(); i++) {
+            const pair<uint64_t, uint64_t> &q = query[order[i]];
+            if (!group.empty() &&
+                q.first <= group.back().second + EXTRACT_GROUP_GAP &&
+                std::max<uint64_t>(group.back().second, q.second) -
+                        group.back().first <
+                    EXTRACT_GROUP_MAX) {
+                group.back().second =
+                    std::max<uint64_t>(group.back().second, q.second);
+            } else {
+                group.push_back(q);
+                begin.push_back(i);
+            }
+        }
+        begin.push_back(order.size());
+    }
+
+    /**
+     * @brief Runs the queries of extract_batch by calling
+     * extract(l, r, out, ctx) on n_threads threads.
+     *
+     * The queries are coalesced by coalesce_queries. Each group is
+     * extracted once, so the rules that its queries share are expanded a
+     * single time, and the queries are copied out of it. Every thread has
+     * its own context_t with the scratch buffers of extract.
+     */
+    template <class context_t, class extract_f>
+    static void extract_coalesced(const vector<pair<uint64_t, uint64_t>> &query,
+                                  const vector<unsigned char *> &out,
+                                  int n_threads, extract_f extract) {
+        vector<uint64_t> order;
+        vector<pair<uint64_t, uint64_t>> group;
+        vector<uint64_t> begin;
+        coalesce_queries(query, order, group, begin);
+
+        // An exception cannot leave the parallel region, so the first one
+        // is rethrown after it
+        std::exception_ptr error;
+#pragma omp parallel num_threads(n_threads)
+        {
+            context_t ctx;
+            vector<unsigned char> buf;
+#pragma omp for schedule(dynamic)
+            for (int64_t g = 0; g < (int64_t)group.size(); g++) {
+                try {
+                    uint64_t l = group[g].first, r = group[g].second;
+                    if (begin[g + 1] - begin[g] == 1) {
+                        extract(l, r, out[order[begin[g]]], ctx);
+                        continue;
+                    }
+                    buf.resize(r - l + 1);
+                    extract(l, r, buf.data(), ctx);
+                    for (uint64_t i = begin[g]; i < begin[g + 1]; i++) {
+                        const pair<uint64_t, uint64_t> &q = query[order[i]];
+                        memcpy(out[order[i]], buf.data() + (q.first - l),
+                               q.second - q.first + 1);
+                    }
+                } catch (...) {
+#pragma omp critical
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
 };
 
 template <class codec_t> class gcis_abstract : public gcis_interface{
@@ -76,15 +322,2015 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
     std::vector<codec_t> g;
     sdsl::int_vector<> reduced_string;
 
+  protected:
+    int n_threads = 1;
+    gcis_header header; // header of the last loaded file
+    // The text being encoded contains NUL bytes (see encode)
+    bool escaped_text = false;
+    // Text position one past the end of each document of a collection,
+    // empty if the text is not a collection (see encode_collection)
+    sdsl::int_vector<> document_end;
+
+    // Document of a collection covering text position p, document_count()
+    // for the sentinel
+    uint64_t document_of(uint64_t p) const {
+        return std::upper_bound(document_end.begin(), document_end.end(), p) -
+               document_end.begin();
+    }
+
+    typedef decltype(std::declval<codec_t &>().decompress()) level_t;
+    gcis_level_cache<level_t> level_cache;
+
+    // Front coding of the next encode (see set_front_coding)
+    uint64_t front_coding_bucket = FRONT_CODING_BUCKET;
+    double front_coding_max_walk = FRONT_CODING_MAX_WALK;
+
+    // Position index of each level, empty until build_position_index
+    std::vector<gcis_level_index> level_index;
+    // Fingerprints of the rules, empty until build_fingerprints
+    gcis_fingerprints fingerprints;
+    // Rule of the level above unknown to extract
+    static constexpr uint64_t unknown_rule = ~0ULL;
+
+    // Length of the text expanded from rule c of level i
+    uint64_t rule_text_length(uint64_t i, uint64_t c) {
+        if (i < level_index.size() && level_index[i].has_lengths())
+            return level_index[i].length(c);
+        return g[i].fully_decoded_rule_len[c];
+    }
+
+    // Length of the text expanded from symbol i of the reduced string
+    uint64_t expanded_length(uint64_t i) {
+        return g.empty() ? 1
+                         : rule_text_length(g.size() - 1, reduced_string[i]);
+    }
+
+    /**
+     * @brief Builds the position index of every level. The rules of level 0
+     * expand to the text, so only the levels above it get samples.
+     */
+    void build_level_index(bool plain_lengths) {
+        level_index.assign(g.size(), gcis_level_index());
+        if (plain_lengths) {
+            for (uint64_t i = 0; i < g.size(); i++) {
+                level_index[i].build_lengths(
+                    g[i].fully_decoded_rule_len.size(),
+                    [&](uint64_t c) { return g[i].fully_decoded_rule_len[c]; });
+            }
+        }
+        for (uint64_t i = 1; i < g.size(); i++) {
+            std::shared_ptr<level_t> level = decompressed_level(i);
+            level_index[i].build_positions(
+                *level, g[i].fully_decoded_rule_len.size(),
+                [&](uint64_t c) { return rule_text_length(i - 1, c); });
+        }
+    }
+
+    /**
+     * @brief Scans buf[from,n), rules of level i whose expansion starts at
+     * text position text_l, for the symbol whose expansion covers the text
+     * position x.
+     * @param text_l receives the position where the expansion of the symbol
+     * starts
+     */
+    uint64_t sequential_lowerbound(uint64_t i, const sdsl::int_vector<> &buf,
+                                   uint64_t from, uint64_t n, int64_t x,
+                                   int64_t &text_l) {
+        for (; from < n; from++) {
+            int64_t len = rule_text_length(i, buf[from]);
+            if (text_l + len > x)
+                break;
+            text_l += len;
+        }
+        return from;
+    }
+
+    /**
+     * @brief Scans buf[0,n), rules of level i whose expansion ends at text
+     * position text_r (excluded), backwards for the symbol whose expansion
+     * covers the text position x.
+     * @param text_r receives the position where the expansion of the symbol
+     * ends
+     */
+    int64_t sequential_upperbound(uint64_t i, const sdsl::int_vector<> &buf,
+                                  uint64_t n, int64_t x, int64_t &text_r) {
+        int64_t k;
+        for (k = n - 1; k >= 0; k--) {
+            int64_t len = rule_text_length(i, buf[k]);
+            if (text_r - len <= x)
+                break;
+            text_r -= len;
+        }
+        return k;
+    }
+
+    /**
+     * @brief sequential_lowerbound over the expansion of rule of level i+1,
+     * which starts at buf[from], skipping first the symbols before the last
+     * sample of the position index at or before x.
+     */
+    uint64_t indexed_lowerbound(uint64_t i, const sdsl::int_vector<> &buf,
+                                uint64_t rule, uint64_t from, uint64_t n,
+                                int64_t x, int64_t &text_l) {
+        if (rule != unknown_rule && i + 1 < level_index.size() &&
+            level_index[i + 1].has_positions()) {
+            uint64_t sum;
+            from += level_index[i + 1].find(rule, x - text_l, sum);
+            text_l += sum;
+        }
+        return sequential_lowerbound(i, buf, from, n, x, text_l);
+    }
+
+    /**
+     * @brief sequential_upperbound when buf ends with the expansion of rule
+     * of level i+1, starting at buf[from]. With a position index the
+     * symbol is searched forwards from a sample of the rule instead.
+     */
+    int64_t indexed_upperbound(uint64_t i, const sdsl::int_vector<> &buf,
+                               uint64_t rule, uint64_t from, uint64_t n,
+                               int64_t x, int64_t &text_r) {
+        if (rule == unknown_rule || i + 1 >= level_index.size() ||
+            !level_index[i + 1].has_positions()) {
+            return sequential_upperbound(i, buf, n, x, text_r);
+        }
+        int64_t text_l = text_r - rule_text_length(i + 1, rule);
+        uint64_t k = indexed_lowerbound(i, buf, rule, from, n, x, text_l);
+        text_r = text_l + rule_text_length(i, buf[k]);
+        return k;
+    }
+
+    // Decompressed level i, from the level cache when it is enabled
+    std::shared_ptr<level_t> decompressed_level(uint64_t i) {
+        return level_cache.get(i, [&]() { return g[i].decompress(); });
+    }
+
+    /**
+     * @brief Sorts the suffixes of the reduced string into SA. Its symbols
+     * are usually the distinct names of the LMS-substrings of the top
+     * level, so the suffix array is their inverse. An encoder that stopped
+     * early (see evaluate_premature_stop) stores the string of the next
+     * level instead, which is sorted with SAIS.
+     */
+    void reduced_string_sa(uint_t *SA) {
+        uint64_t n1 = reduced_string.size();
+        std::vector<bool> seen(n1, false);
+        uint64_t i;
+        for (i = 0; i < n1; i++) {
+            uint64_t c = reduced_string[i];
+            if (c >= n1 || seen[c])
+                break;
+            seen[c] = true;
+            SA[c] = i;
+        }
+        if (i == n1)
+            return;
+        std::vector<uint_t> s1(n1);
+        uint64_t K = 0;
+        for (i = 0; i < n1; i++) {
+            s1[i] = reduced_string[i];
+            K = max(K, (uint64_t)reduced_string[i] + 1);
+        }
+        SAIS(s1.data(), SA, n1, K, 0);
+    }
+
+    /**
+     * @brief Decodes a text the encoder stored as the reduced string, with
+     * no level, and sorts its suffixes into SA with SAIS. The LCP array is
+     * also computed when LCP is not NULL.
+     */
+    unsigned char *plain_text_saca(uint_t *SA, int_t *LCP) {
+        uint_t n = reduced_string.size();
+        unsigned char *str = new unsigned char[n];
+        for (uint_t i = 0; i < n; i++) {
+            str[i] = reduced_string[i];
+        }
+        if (n == 1 || memchr(str, 0, n - 1) != NULL) {
+            delete[] str;
+            if (n == 1) {
+                SA[0] = 0;
+                if (LCP)
+                    LCP[0] = 0;
+                str = new unsigned char[1];
+                str[0] = 0;
+                return str;
+            }
+            throw(NotImplementedException("decode_saca of a text with NUL bytes"));
+        }
+        SAIS(str, SA, n, 256, 0);
+        if (LCP) {
+            // Every suffix is sampled, in text order
+            std::vector<uint_t> RA(n);
+            std::vector<int_t> PLCP(n);
+            for (uint_t i = 0; i < n; i++) {
+                RA[i] = i;
+            }
+            compute_lcp_phi_sparse_sais(str, SA, RA.data(), LCP, PLCP.data(),
+                                        n);
+        }
+        return str;
+    }
+
+    // Expands rule rule_num of a decompressed level into s[l..], counting
+    // its symbols into cnt
+    static void expand_rule_counting(level_t &level, uint64_t rule_num,
+                                     unsigned char *s, uint64_t &l,
+                                     int_t *cnt) {
+        uint64_t from = l;
+        level.expand_rule(rule_num, (char *)s, l);
+        for (; from < l; from++) {
+            cnt[s[from]]++;
+        }
+    }
+
+    static void expand_rule_counting(level_t &level, uint64_t rule_num,
+                                     sdsl::int_vector<> &s, uint64_t &l,
+                                     int_t *cnt) {
+        uint64_t from = l;
+        level.expand_rule(rule_num, s, l);
+        for (; from < l; from++) {
+            cnt[s[from]]++;
+        }
+    }
+
+    // The levels currently in the level cache (nullptr for the others)
+    std::vector<std::shared_ptr<level_t>> cached_levels() {
+        std::vector<std::shared_ptr<level_t>> cached(g.size());
+        if (level_cache.budget() > 0) {
+            for (uint64_t i = 0; i < g.size(); i++) {
+                cached[i] = level_cache.peek(i);
+            }
+        }
+        return cached;
+    }
+
+    // Appends rule rule_num of a level to out during extraction, copying
+    // it from the decompressed level when that level is cached, or else
+    // from its decoded bucket in buckets, instead of walking the front
+    // coding
+    void extract_rule(std::vector<std::shared_ptr<level_t>> &cached,
+                      gcis_bucket_cache *buckets, uint64_t level,
+                      uint64_t rule_num, sdsl::int_vector<> &out,
+                      uint64_t &k) {
+        if (cached[level])
+            cached[level]->expand_rule(rule_num, out, k);
+        else if (buckets)
+            buckets->expand_rule(level, g[level], rule_num, out, k);
+        else
+            g[level].extract_rule(rule_num, out, k);
+    }
+
+    // Expansion length and fingerprint of symbol c of the rules of level
+    // i + 1, a byte when i < 0
+    uint64_t symbol_length(int64_t i, uint64_t c) {
+        return i < 0 ? 1 : rule_text_length(i, c);
+    }
+
+    uint64_t symbol_fingerprint(int64_t i, uint64_t c) {
+        return i < 0 ? c : (uint64_t)fingerprints.rule[i][c];
+    }
+
+    // Symbol k of the root of the grammar, the tails of the levels followed
+    // by the reduced string without its last symbol, which expands to the
+    // sentinel. level receives the level of its rule, -1 for a byte.
+    uint64_t root_symbol(uint64_t k, int64_t &level) {
+        const std::vector<uint64_t> &begin = fingerprints.root_begin;
+        uint64_t s =
+            std::upper_bound(begin.begin(), begin.end(), k) - begin.begin() - 1;
+        if (s < g.size()) {
+            level = (int64_t)s - 1;
+            return g[s].tail[k - begin[s]];
+        }
+        level = (int64_t)g.size() - 1;
+        return reduced_string[k - begin[s]];
+    }
+
+    /**
+     * @brief Computes the fingerprints of the rules of every level from
+     * those of the level below, reading the rules from their decoded
+     * front-coding buckets, and then samples the fingerprints of the text
+     * before the root symbols.
+     */
+    void build_rule_fingerprints(uint64_t seed) {
+        fingerprints.clear();
+        fingerprints.kr = gcis_karp_rabin(seed);
+        const gcis_karp_rabin &kr = fingerprints.kr;
+        gcis_bucket_cache buckets;
+        fingerprints.rule.resize(g.size());
+        for (uint64_t i = 0; i < g.size(); i++) {
+            uint64_t n_rules = g[i].fully_decoded_rule_len.size();
+            std::vector<uint64_t> fp(n_rules);
+            for (uint64_t c = 0; c < n_rules; c++) {
+                uint64_t n;
+                const uint64_t *symbol = buckets.rule(i, g[i], c, n);
+                uint64_t h = 0;
+                for (uint64_t k = 0; k < n; k++) {
+                    h = kr.append(h, symbol_length((int64_t)i - 1, symbol[k]),
+                                  symbol_fingerprint((int64_t)i - 1, symbol[k]));
+                }
+                fp[c] = h;
+            }
+            pack_int_vector(fp, fingerprints.rule[i]);
+        }
+
+        std::vector<uint64_t> &begin = fingerprints.root_begin;
+        begin.push_back(0);
+        for (uint64_t i = 0; i < g.size(); i++) {
+            begin.push_back(begin.back() + g[i].tail.size());
+        }
+        begin.push_back(begin.back() + reduced_string.size() - 1);
+        std::vector<uint64_t> pos(1, 0), fp(1, 0);
+        uint64_t text = 0, h = 0;
+        for (uint64_t k = 0; k < begin.back(); k++) {
+            if (k && k % FINGERPRINT_SAMPLE == 0) {
+                pos.push_back(text);
+                fp.push_back(h);
+            }
+            int64_t level;
+            uint64_t c = root_symbol(k, level);
+            uint64_t len = symbol_length(level, c);
+            h = kr.append(h, len, symbol_fingerprint(level, c));
+            text += len;
+        }
+        pack_int_vector(pos, fingerprints.sample_pos);
+        pack_int_vector(fp, fingerprints.sample_fp);
+    }
+
+    /**
+     * @brief Fingerprint of T[0,p), p <= text_length(). The fingerprints
+     * of the root symbols are added from the last sample before p up to
+     * the symbol covering p, and then those of the symbols of each rule
+     * covering p, down to the bytes of the text.
+     */
+    uint64_t grammar_prefix_fingerprint(uint64_t p, gcis_bucket_cache &buckets) {
+        const gcis_karp_rabin &kr = fingerprints.kr;
+        const sdsl::int_vector<> &sample_pos = fingerprints.sample_pos;
+        uint64_t s = std::upper_bound(sample_pos.begin(), sample_pos.end(), p) -
+                     sample_pos.begin() - 1;
+        uint64_t text = sample_pos[s];
+        uint64_t h = fingerprints.sample_fp[s];
+        if (text == p)
+            return h;
+        int64_t level;
+        uint64_t c;
+        for (uint64_t k = s * FINGERPRINT_SAMPLE;; k++) {
+            c = root_symbol(k, level);
+            uint64_t len = symbol_length(level, c);
+            if (text + len > p)
+                break;
+            h = kr.append(h, len, symbol_fingerprint(level, c));
+            text += len;
+            if (text == p)
+                return h;
+        }
+        // c, a rule of level level, covers p strictly after text
+        for (;;) {
+            uint64_t n;
+            const uint64_t *symbol = buckets.rule(level, g[level], c, n);
+            level--;
+            for (uint64_t k = 0;; k++) {
+                c = symbol[k];
+                uint64_t len = symbol_length(level, c);
+                if (text + len > p)
+                    break;
+                h = kr.append(h, len, symbol_fingerprint(level, c));
+                text += len;
+                if (text == p)
+                    return h;
+            }
+        }
+    }
+
   public:
-    void extract_batch(vector<pair<int,int>>& v_query){
-        throw(NotImplementedException("extract_batch"));
+    using gcis_interface::encode;
+
+    // Number of threads used by the induced sorting scans of the encoder
+    // and of decode_saca, by the rule expansion of decode and by
+    // extract_batch. A value <= 0
+    // selects all the available cores.
+    void set_threads(int threads) {
+#ifdef _OPENMP
+        n_threads = threads > 0 ? threads : omp_get_max_threads();
+#else
+        n_threads = 1;
+#endif
+    }
+
+    // Decompressed levels are kept between calls to decode, decode_saca
+    // and extract up to the given number of bytes, least recently used
+    // levels being evicted first
+    void set_level_cache(uint64_t bytes) { level_cache.set_budget(bytes); }
+
+    // Reads of a level that found it in the level cache, and that had to
+    // decompress it
+    uint64_t level_cache_hits() const { return level_cache.hits(); }
+    uint64_t level_cache_misses() const { return level_cache.misses(); }
+
+    /**
+     * @brief Sets the number of rules per front-coding bucket used by the
+     * next encode. The first rule of a bucket stores its whole expansion,
+     * so smaller buckets make the rules faster to extract and larger ones
+     * make the dictionary smaller. With bucket 0 the size of each level is
+     * the largest one whose rules are expanded reading max_walk previous
+     * rules on average. The sizes are stored in the file. Codecs without
+     * front coding ignore them.
+     */
+    void set_front_coding(uint64_t bucket,
+                          double max_walk = FRONT_CODING_MAX_WALK) {
+        front_coding_bucket = bucket;
+        front_coding_max_walk = max_walk;
+    }
+
+    /**
+     * @brief Builds the position indexes used by extract to find the ends
+     * of the query at each level (see gcis_level_index). With plain_lengths
+     * the expansion lengths of the rules are also copied into bit-packed
+     * arrays. The indexes are not serialized and are dropped by encode and
+     * load.
+     */
+    virtual void build_position_index(bool plain_lengths) {
+        throw(NotImplementedException("build_position_index"));
+    }
+
+    // Bytes of the position indexes
+    uint64_t position_index_size_in_bytes() {
+        uint64_t bytes = 0;
+        for (auto &index : level_index) {
+            bytes += index.size_in_bytes();
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Streaming decoder of the text (see gcis_decoder). The
+     * dictionary must outlive it and must not be modified while it is used.
+     */
+    std::unique_ptr<gcis_decoder<level_t>> decoder() {
+        std::vector<std::shared_ptr<level_t>> levels(g.size());
+        std::vector<const sdsl::int_vector<> *> tails(g.size());
+        for (uint64_t i = 0; i < g.size(); i++) {
+            levels[i] = decompressed_level(i);
+            tails[i] = &g[i].tail;
+        }
+        return std::unique_ptr<gcis_decoder<level_t>>(new gcis_decoder<level_t>(
+            std::move(levels), std::move(tails), reduced_string, text_length()));
+    }
+
+    void decode_to(int fd){
+        throw(NotImplementedException("decode_to"));
+    }
+    // Scratch buffers of extract, reused by the queries of a thread
+    struct extract_context {
+        sdsl::int_vector<> text;
+        sdsl::int_vector<> tmp;
+        // Rule buckets decoded by the queries, kept only when cache_buckets
+        // is set, as extract_batch does: a single query rarely copies a rule
+        // twice, so for it decoding buckets costs more than it saves
+        gcis_bucket_cache buckets;
+        bool cache_buckets = false;
+    };
+
+    /**
+     * @brief Writes T[l,r] into out, which must hold r-l+1 symbols, using
+     * the buffers of ctx. Extraction does not modify the dictionary, so
+     * several threads may extract from it at the same time, each one with
+     * its own context.
+     */
+    virtual void extract(uint64_t l, uint64_t r, unsigned char *out,
+                         extract_context &ctx) {
+        throw(NotImplementedException("extract"));
+    }
+
+    // Writes T[l,r] into out, which must hold r-l+1 symbols
+    void extract(uint64_t l, uint64_t r, unsigned char *out){
+        extract_context ctx;
+        extract(l, r, out, ctx);
+    }
+
+    using gcis_interface::extract_batch;
+
+    void extract_batch(const vector<pair<uint64_t, uint64_t>> &query,
+                       const vector<unsigned char *> &out) {
+        extract_coalesced<extract_context>(
+            query, out, n_threads,
+            [&](uint64_t l, uint64_t r, unsigned char *o, extract_context &ctx) {
+                ctx.cache_buckets = true;
+                extract(l, r, o, ctx);
+            });
+    }
+
+    /**
+     * @brief Computes the Karp-Rabin fingerprints of the expansions of the
+     * rules, and samples of the fingerprints of the prefixes of the text,
+     * from which lce and equal walk the grammar down to the positions they
+     * compare instead of extracting the substrings. They are not
+     * serialized and are dropped by encode and load.
+     */
+    virtual void build_fingerprints(uint64_t seed = FINGERPRINT_SEED) {
+        throw(NotImplementedException("build_fingerprints"));
+    }
+
+    // Bytes of the fingerprints
+    uint64_t fingerprints_size_in_bytes() {
+        return fingerprints.size_in_bytes();
+    }
+
+    uint64_t lce(uint64_t i, uint64_t j) {
+        extract_context ctx;
+        return lce(i, j, ctx);
+    }
+
+    /**
+     * @brief lce using the bucket cache of ctx, which a thread can reuse
+     * for its queries. The length is found by doubling and then halving
+     * the compared extension, each step comparing the fingerprints of two
+     * substrings, which are differences of prefix fingerprints.
+     */
+    uint64_t lce(uint64_t i, uint64_t j, extract_context &ctx) {
+        check_fingerprints();
+        uint64_t n = text_length();
+        if (i >= n || j >= n)
+            return 0;
+        if (i == j)
+            return n - i;
+        const gcis_karp_rabin &kr = fingerprints.kr;
+        uint64_t m = n - max(i, j);
+        uint64_t fi = prefix_fingerprint(i, ctx);
+        uint64_t fj = prefix_fingerprint(j, ctx);
+        auto same = [&](uint64_t len) {
+            return kr.substring(fi, prefix_fingerprint(i + len, ctx), len) ==
+                   kr.substring(fj, prefix_fingerprint(j + len, ctx), len);
+        };
+        // T[i, i+lo) equals T[j, j+lo), and T[i, i+hi) differs or is too long
+        uint64_t lo = 0, hi = m + 1;
+        for (uint64_t step = 1; lo + step <= m; step *= 2) {
+            if (!same(lo + step)) {
+                hi = lo + step;
+                break;
+            }
+            lo += step;
+        }
+        while (hi - lo > 1) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (same(mid))
+                lo = mid;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    void lce_batch(const vector<pair<uint64_t, uint64_t>> &query,
+                   vector<uint64_t> &out) {
+        extract_context ctx;
+        out.resize(query.size());
+        for (uint64_t k = 0; k < query.size(); k++) {
+            out[k] = lce(query[k].first, query[k].second, ctx);
+        }
+    }
+
+    bool equal(uint64_t i, uint64_t j, uint64_t len) {
+        extract_context ctx;
+        return equal(i, j, len, ctx);
     }
-    unsigned char* decode_saca(uint_t** SA){
-        throw(NotImplementedException("decode_saca"));
+
+    // equal using the bucket cache of ctx
+    bool equal(uint64_t i, uint64_t j, uint64_t len, extract_context &ctx) {
+        check_fingerprints();
+        uint64_t n = text_length();
+        if (i > n || j > n || len > n - max(i, j))
+            return false;
+        if (i == j || len == 0)
+            return true;
+        const gcis_karp_rabin &kr = fingerprints.kr;
+        return kr.substring(prefix_fingerprint(i, ctx),
+                            prefix_fingerprint(i + len, ctx), len) ==
+               kr.substring(prefix_fingerprint(j, ctx),
+                            prefix_fingerprint(j + len, ctx), len);
+    }
+
+  protected:
+    // Fingerprint of T[0,p), p <= text_length(), for the codecs with
+    // fingerprints (see grammar_prefix_fingerprint)
+    virtual uint64_t prefix_fingerprint(uint64_t p, extract_context &ctx) {
+        throw(NotImplementedException("prefix_fingerprint"));
     }
-    unsigned char* decode_saca_lcp(uint_t** SA, int_t **LCP){
-        throw(NotImplementedException("decode_saca_lcp"));
+
+    void check_fingerprints() {
+        if (fingerprints.empty()) {
+            throw std::runtime_error(
+                "build_fingerprints must be called before lce and equal");
+        }
+    }
+
+  public:
+    /**
+     * @brief Decodes the text and induces its suffix array from the sorted
+     * LMS-substrings of each level, from the top level down. Only the
+     * decompressed levels are used, so it works with every codec.
+     */
+    virtual unsigned char *decode_saca(uint_t **sa) {
+        // Level 0 of a text with NUL bytes was sorted over shifted symbols
+        if (g.size() && g[0].alphabet_size > 256) {
+            throw(NotImplementedException("decode_saca of a text with NUL bytes"));
+        }
+
+        sdsl::int_vector<> r_string = reduced_string;
+        unsigned char* str;
+        uint_t n = g.size() ? g[0].string_size : (uint_t)reduced_string.size();
+        uint_t *SA = new uint_t[n];
+
+        int_t *s = (int_t *)SA + n / 2;
+
+        if (g.size()) {
+
+            for (int64_t level = g.size() - 1; level >= 0; level--) {
+#if TIME
+                auto start = timer::now();
+#endif
+
+                n = g[level].string_size;
+
+                uint_t n1 = r_string.size();
+                uint_t *SA1 = SA, *s1 = SA + n - n1;
+
+                // copy to s1[1]
+                if (level == g.size() - 1)
+                    reduced_string_sa(SA1);
+                else
+                    for (uint_t i = 0; i < n1; i++)
+                        s1[i] = SA[i];
+
+#if DEBUG
+                cout << endl
+                     << "level = " << level
+                     << "\t string_size = " << g[level].string_size << "\n"
+                     << "alphabet_size = " << g[level].alphabet_size << endl;
+                cout << "n = " << n << "\nn1 = " << n1 << endl;
+                cout << "\n####" << endl;
+                cout << "s1 = ";
+                for (uint_t i = 0; i < n1; i++) {
+                    cout << s1[i] << " ";
+                    cout << endl;
+                }
+#endif
+
+#if TIME
+                auto expand = timer::now();
+#endif
+
+                sdsl::int_vector<> next_r_string;
+                std::shared_ptr<level_t> gd =
+                    decompressed_level(level);
+                next_r_string.width(sdsl::bits::hi(g[level].alphabet_size - 1) +
+                                    1);
+                // level 0 is decoded into str instead
+                if (level > 0)
+                    next_r_string.resize(g[level].string_size);
+                uint64_t l = 0;
+
+                int_t K = g[level].alphabet_size; // alphabet
+
+                int_t *bkt = new int_t[K]; // bucket
+                int_t *cnt = new int_t[K]; // counters
+
+                init_buckets(cnt, K);
+
+                if (level == 0) {
+
+                    // delete[] s;
+                    // Convert the reduced string in the original text
+                    str = new unsigned char[g[level].string_size];
+                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
+                        str[l++] = g[level].tail[j];
+                        cnt[g[level].tail[j]]++; // count frequencies
+                    }
+                    for (uint64_t j = 0; j < r_string.size(); j++) {
+                        expand_rule_counting(*gd, r_string[j], str, l, cnt);
+                    }
+                    n = g[level].string_size;
+                    // Classify the type of each character
+                    uint_t cur_t, succ_t;
+                    uint_t j = n1 - 1;
+                    s1[j--] = n - 1;
+                    succ_t = 0; // s[n-2] must be L-type
+                    for (uint_t i = n - 2; i > 0; i--) {
+                        cur_t = (str[i - 1] < str[i] ||
+                                 (str[i - 1] == str[i] && succ_t == 1))
+                                    ? 1
+                                    : 0;
+                        if (cur_t == 0 && succ_t == 1)
+                            s1[j--] = i;
+                        succ_t = cur_t;
+                    }
+                } else {
+
+                    init_buckets(bkt, K);
+
+                    // Convert the reduced string in the previous reduced string
+                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
+                        next_r_string[l++] = g[level].tail[j];
+                        cnt[g[level].tail[j]]++; // count frequencies
+                    }
+                    for (uint64_t j = 0; j < r_string.size(); j++) {
+                        expand_rule_counting(*gd, r_string[j], next_r_string,
+                                             l, cnt);
+                    }
+                    r_string = std::move(next_r_string);
+
+                    // n=r_string.size();
+                    n = g[level].string_size;
+                    // copy to s[1]
+                    for (uint_t i = 0; i < n; i++)
+                        s[i] = r_string[i];
+
+                    // Classify the type of each character
+                    uint_t cur_t, succ_t;
+                    uint_t j = n1 - 1;
+                    s1[j--] = n - 1;
+                    succ_t = 0; // s[n-2] must be L-type
+                    for (uint_t i = n - 2; i > 0; i--) {
+                        cur_t =
+                            (r_string[i - 1] < r_string[i] ||
+                             (r_string[i - 1] == r_string[i] && succ_t == 1))
+                                ? 1
+                                : 0;
+                        if (cur_t == 0 && succ_t == 1)
+                            s1[j--] = i;
+                        succ_t = cur_t;
+                    }
+                }
+
+#if TIME
+                auto end = timer::now();
+                cout << "expand: "
+                     << (double)duration_cast<seconds>(end - expand).count()
+                     << " seconds" << endl;
+#endif
+
+#if DEGUB
+                cout << "n = " << n << "\nn1 = " << n1 << endl;
+                cout << "level = " << level
+                     << "\t string_size = " << g[level].string_size << "\n"
+                     << "alphabet_size = " << g[level].alphabet_size << endl;
+                cout << "SA1: ";
+                for (uint_t i = 0; i < n1; i++)
+                    cout << SA[i] << ", ";
+                cout << endl;
+#endif
+
+                // stage 3: induce the result for the original problem
+                get_buckets(cnt, bkt, K, true);
+
+#if TIME
+                auto begin = timer::now();
+#endif
+
+#if TIME
+                end = timer::now();
+                cout << "classify: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+                begin = timer::now();
+#endif
+
+#if DEGUB
+                for (int_t i = 0; i < n; i++) {
+                    cout << tget(i) << " ";
+                }
+                cout << endl;
+#endif
+
+                int_t j = 0;
+                for (int_t i = 0; i < n1; i++) {
+                    SA1[i] = s1[SA1[i]]; // get index in s1
+                }
+                for (int_t i = n1; i < n; i++) {
+                    SA[i] = EMPTY; // init SA[n1..n-1]
+                }
+
+                if (level) {
+                    for (int_t i = n1 - 1; i >= 0; i--) {
+                        j = SA[i];
+                        SA[i] = EMPTY;
+                        SA[bkt[chr(j)]--] = j;
+                    }
+                } else {
+                    for (int_t i = n1 - 1; i > 0; i--) {
+                        j = SA[i];
+                        SA[i] = EMPTY;
+                        SA[bkt[str[j]]--] = j;
+                    }
+                    SA[0] = n - 1;
+                }
+
+#if TIME
+                end = timer::now();
+                cout << "position: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+                begin = timer::now();
+#endif
+
+                if (level)
+                    induceSAl(SA, s, cnt, bkt, n, K, level);
+                else
+                    induceSAl(SA, str, cnt, bkt, n, K, level);
+
+#if TIME
+                end = timer::now();
+                cout << "induce L: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+                begin = timer::now();
+#endif
+
+                if (level)
+                    induceSAs(SA, s, cnt, bkt, n, K, level);
+                else
+                    induceSAs(SA, str, cnt, bkt, n, K, level);
+
+#if TIME
+                end = timer::now();
+                cout << "induce S: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+#endif
+
+#if DEGUB
+                cout << "SA: ";
+                for (uint_t i = 0; i < n; i++) {
+                    cout << SA[i] << ", ";
+                }
+                cout << endl;
+#endif
+                delete[] bkt;
+                delete[] cnt;
+
+#if TIME
+                auto stop = timer::now();
+                cout << "time: "
+                     << (double)duration_cast<seconds>(stop - start).count()
+                     << " seconds" << endl;
+#endif
+            }
+        } else {
+            str = plain_text_saca(SA, NULL);
+        }
+
+        *sa = SA;
+        return str;
+    }//end decode_saca
+
+    // decode_saca that also induces the LCP array at level 0
+    virtual unsigned char *decode_saca_lcp(uint_t **sa, int_t **lcp) {
+        // Level 0 of a text with NUL bytes was sorted over shifted symbols
+        if (g.size() && g[0].alphabet_size > 256) {
+            throw(NotImplementedException("decode_saca of a text with NUL bytes"));
+        }
+
+        sdsl::int_vector<> r_string = reduced_string;
+        unsigned char *str;
+        uint_t n = g.size() ? g[0].string_size : (uint_t)reduced_string.size();
+        uint_t *SA = new uint_t[n];
+        int_t *LCP = new int_t[n];
+
+        uint_t i;
+        for(i=0;i<n;i++) SA[i]=LCP[i]=0;
+
+        int_t *s = (int_t *)SA + n / 2;
+
+        if (g.size()) {
+
+            for (int64_t level = g.size() - 1; level >= 0; level--) {
+#if TIME
+                auto start = timer::now();
+#endif
+
+                n = g[level].string_size;
+
+                uint_t n1 = r_string.size();
+                uint_t *SA1 = SA, *s1 = SA + n - n1;
+
+                // copy to s1[1]
+                if (level == g.size() - 1)
+                    reduced_string_sa(SA1);
+                else
+                    for (uint_t i = 0; i < n1; i++)
+                        s1[i] = SA[i];
+
+#if DEBUG
+                cout << endl
+                     << "level = " << level
+                     << "\t string_size = " << g[level].string_size << "\n"
+                     << "alphabet_size = " << g[level].alphabet_size << endl;
+                cout << "n = " << n << "\nn1 = " << n1 << endl;
+                cout << "\n####" << endl;
+                cout << "s1 = ";
+                for (uint_t i = 0; i < n1; i++) {
+                    cout << s1[i] << " ";
+                    cout << endl;
+                }
+#endif
+
+#if TIME
+                auto expand = timer::now();
+#endif
+
+                sdsl::int_vector<> next_r_string;
+                std::shared_ptr<level_t> gd =
+                    decompressed_level(level);
+                next_r_string.width(sdsl::bits::hi(g[level].alphabet_size - 1) +
+                                    1);
+                // level 0 is decoded into str instead
+                if (level > 0)
+                    next_r_string.resize(g[level].string_size);
+                uint64_t l = 0;
+
+                int_t K = g[level].alphabet_size; // alphabet
+
+                int_t *bkt = new int_t[K]; // bucket
+                int_t *cnt = new int_t[K]; // counters
+
+                init_buckets(cnt, K);
+
+                if (level == 0) {
+
+                    // delete[] s;
+                    // Convert the reduced string in the original text
+                    str = new unsigned char[g[level].string_size];
+                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
+                        str[l++] = g[level].tail[j];
+                        cnt[g[level].tail[j]]++; // count frequencies
+                    }
+                    for (uint64_t j = 0; j < r_string.size(); j++) {
+                        expand_rule_counting(*gd, r_string[j], str, l, cnt);
+                    }
+                    n = g[level].string_size;
+                    str[n-1]=0;
+                    // Classify the type of each character
+                    uint_t cur_t, succ_t;
+                    uint_t j = n1 - 1;
+                    s1[j--] = n - 1;
+                    succ_t = 0; // s[n-2] must be L-type
+                    for (uint_t i = n - 2; i > 0; i--) {
+                        cur_t = (str[i - 1] < str[i] ||
+                                 (str[i - 1] == str[i] && succ_t == 1))
+                                    ? 1
+                                    : 0;
+                        if (cur_t == 0 && succ_t == 1)
+                            s1[j--] = i;
+                        succ_t = cur_t;
+                    }
+                } else {
+
+                    init_buckets(bkt, K);
+
+                    // Convert the reduced string in the previous reduced string
+                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
+                        next_r_string[l++] = g[level].tail[j];
+                        cnt[g[level].tail[j]]++; // count frequencies
+                    }
+                    for (uint64_t j = 0; j < r_string.size(); j++) {
+                        expand_rule_counting(*gd, r_string[j], next_r_string,
+                                             l, cnt);
+                    }
+                    r_string = std::move(next_r_string);
+
+                    // n=r_string.size();
+                    n = g[level].string_size;
+                    // copy to s[1]
+                    for (uint_t i = 0; i < n; i++)
+                        s[i] = r_string[i];
+
+                    // Classify the type of each character
+                    uint_t cur_t, succ_t;
+                    uint_t j = n1 - 1;
+                    s1[j--] = n - 1;
+                    succ_t = 0; // s[n-2] must be L-type
+                    for (uint_t i = n - 2; i > 0; i--) {
+                        cur_t =
+                            (r_string[i - 1] < r_string[i] ||
+                             (r_string[i - 1] == r_string[i] && succ_t == 1))
+                                ? 1
+                                : 0;
+                        if (cur_t == 0 && succ_t == 1)
+                            s1[j--] = i;
+                        succ_t = cur_t;
+                    }
+                }
+
+#if TIME
+                auto end = timer::now();
+                cout << "expand: "
+                     << (double)duration_cast<seconds>(end - expand).count()
+                     << " seconds" << endl;
+#endif
+
+#if DEGUB
+                cout << "n = " << n << "\nn1 = " << n1 << endl;
+                cout << "level = " << level
+                     << "\t string_size = " << g[level].string_size << "\n"
+                     << "alphabet_size = " << g[level].alphabet_size << endl;
+                cout << "SA1: ";
+                for (uint_t i = 0; i < n1; i++)
+                    cout << SA[i] << ", ";
+                cout << endl;
+#endif
+
+                // stage 3: induce the result for the original problem
+                get_buckets(cnt, bkt, K, true);
+
+#if TIME
+                auto begin = timer::now();
+#endif
+
+#if TIME
+                end = timer::now();
+                cout << "classify: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+                begin = timer::now();
+#endif
+
+#if DEGUB
+                for (int_t i = 0; i < n; i++) {
+                    cout << tget(i) << " ";
+                }
+                cout << endl;
+#endif
+
+                if(level == 0){
+                  uint_t *RA=s1;
+                  int_t *PLCP=LCP+n-n1;//PHI is stored in PLCP array
+                  //compute the LCP of consecutive LMS-suffixes
+                  compute_lcp_phi_sparse_sais(str, SA1, RA, LCP, PLCP, n1);
+                }
+
+                int_t j = 0;
+                for (int_t i = 0; i < n1; i++) {
+                    SA1[i] = s1[SA1[i]]; // get index in s1
+                }
+                for (int_t i = n1; i < n; i++) {
+                    SA[i] = EMPTY; // init SA[n1..n-1]
+                }
+
+                if(level == 0){
+                  for(i=n1;i<n;i++) LCP[i]=0;
+                }
+
+                if (level) {
+                    for (int_t i = n1 - 1; i >= 0; i--) {
+                        j = SA[i]; SA[i] = EMPTY;
+                        SA[bkt[chr(j)]--] = j;
+                    }
+                } else {
+                    int_t l;
+                    for (int_t i = n1 - 1; i > 0; i--) {
+                        j = SA[i];SA[i] = U_MAX;
+                        l=LCP[i]; LCP[i]=0;
+                    
+                        SA[bkt[str[j]]] = j;
+                        LCP[bkt[str[j]]--] = l;
+                    }
+                }
+
+#if TIME
+                end = timer::now();
+                cout << "position: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+                begin = timer::now();
+#endif
+
+                if (level)
+                    induceSAl(SA, s, cnt, bkt, n, K, level);
+                else
+                    //induceSAl(SA, (int_t *)str, cnt, bkt, n, K,
+                    //          sizeof(char), level);
+                    induceSAl_LCP(SA, LCP, str, cnt, bkt, n, K, level);
+
+                #if DEGUB
+                if(level==0){
+                  for(i=0; i<n; i++)
+                        printf("%d\t", SA[i]);
+                  printf("\n\n");
+                  for(i=0; i<n; i++)
+                        printf("%d\t", LCP[i]);
+                  printf("\n");
+                }
+                #endif
+
+#if TIME
+                end = timer::now();
+                cout << "induce L: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+                begin = timer::now();
+#endif
+
+                if (level)
+                    induceSAs(SA, s, cnt, bkt, n, K, level);
+                else{
+                    //induceSAs(SA, (int_t *)str, cnt, bkt, n, K,
+                    //          sizeof(char), level);
+                    induceSAs_LCP(SA, LCP, str, cnt, bkt, n, K, level);
+                    SA[0]=n-1;
+                }
+
+                #if DEGUB
+                if(level==0){
+                  for(i=0; i<n; i++)
+                        printf("%d\t", SA[i]);
+                  printf("\n\n");
+                  for(i=0; i<n; i++)
+                        printf("%d\t", LCP[i]);
+                  printf("\n");
+                }
+                #endif
+#if TIME
+                end = timer::now();
+                cout << "induce S: "
+                     << (double)duration_cast<seconds>(end - begin).count()
+                     << " seconds" << endl;
+#endif
+
+#if DEGUB
+                cout << "SA: ";
+                for (uint_t i = 0; i < n; i++) {
+                    cout << SA[i] << ", ";
+                }
+                cout << endl;
+#endif
+                delete[] bkt;
+                delete[] cnt;
+
+#if TIME
+                auto stop = timer::now();
+                cout << "time: "
+                     << (double)duration_cast<seconds>(stop - start).count()
+                     << " seconds" << endl;
+#endif
+            }
+        } else {
+            str = plain_text_saca(SA, LCP);
+        }
+
+        *sa = SA;
+        *lcp = LCP;
+        return str;
+    }//end decode_saca_lcp
+
+    /**
+     * @brief Semi-external decode_saca and decode_saca_lcp: the suffix
+     * array, and the LCP array when lcp_fd >= 0, are written to file
+     * descriptors in the format of gc-is-codec -s and -l (the number of
+     * suffixes without the sentinel, then the entries after it) instead of
+     * being returned. See saca_external for the memory used.
+     *
+     * The LCP array is written in the given format (see gcis_lcp_format)
+     * as the suffixes are induced. The compact formats are never converted
+     * from the integer arrays, so they always go through the temporary
+     * files, even when the arrays fit in memory. With GCIS_LCP_BYTE, the values of 255 or more are written to
+     * overflow_fd, which must then be given.
+     *
+     * @return the decoded text, as decode_saca
+     */
+    virtual unsigned char *
+    decode_saca_external(int sa_fd, int lcp_fd, uint64_t memory,
+                         const std::string &tmp_dir,
+                         gcis_lcp_format format = GCIS_LCP_INT,
+                         int overflow_fd = -1) {
+        bool with_lcp = lcp_fd >= 0;
+        if (with_lcp && format == GCIS_LCP_BYTE && overflow_fd < 0) {
+            throw std::invalid_argument(
+                "GCIS_LCP_BYTE needs a file descriptor for the large values");
+        }
+        // The compact layouts are written as the LCP values are induced,
+        // never converted from the integer array
+        bool compact = with_lcp && format != GCIS_LCP_INT;
+        std::vector<uint_t> sa_buf;
+        std::vector<int_t> lcp_buf;
+        std::vector<unsigned char> byte_buf;
+        std::vector<char> overflow_buf;
+        std::vector<uint64_t> plcp;
+        auto flush = [&]() {
+            write_fd(sa_fd, (const char *)sa_buf.data(),
+                     sa_buf.size() * sizeof(uint_t));
+            sa_buf.clear();
+            if (format == GCIS_LCP_INT) {
+                write_fd(lcp_fd, (const char *)lcp_buf.data(),
+                         lcp_buf.size() * sizeof(int_t));
+                lcp_buf.clear();
+            } else if (format == GCIS_LCP_BYTE) {
+                write_fd(lcp_fd, (const char *)byte_buf.data(), byte_buf.size());
+                write_fd(overflow_fd, overflow_buf.data(), overflow_buf.size());
+                byte_buf.clear();
+                overflow_buf.clear();
+            }
+        };
+        // The buffers, and the PLCP bitvector which is written at the end
+        uint64_t sink_bytes = EXTERNAL_WRITE_BUFFER * sizeof(uint_t);
+        if (with_lcp && format == GCIS_LCP_INT) {
+            sink_bytes += EXTERNAL_WRITE_BUFFER * sizeof(int_t);
+        } else if (with_lcp && format == GCIS_LCP_BYTE) {
+            sink_bytes += EXTERNAL_WRITE_BUFFER *
+                          (1 + sizeof(uint_t) + sizeof(int_t));
+        } else if (with_lcp) {
+            sink_bytes += (2 * text_length() + 63) / 64 * sizeof(uint64_t);
+        }
+        uint64_t i = 0;
+        unsigned char *str = saca_external(
+            with_lcp, memory, tmp_dir, sink_bytes, !compact,
+            [&](const unsigned char *, uint64_t n, uint_t v, int_t lcp) {
+                if (i++ == 0) {
+                    // the sentinel
+                    size_t m = n - 1;
+                    write_fd(sa_fd, (const char *)&m, sizeof(m));
+                    if (with_lcp)
+                        write_fd(lcp_fd, (const char *)&m, sizeof(m));
+                    if (with_lcp && format == GCIS_LCP_PLCP)
+                        plcp.assign((2 * m + 63) / 64, 0);
+                    return;
+                }
+                sa_buf.push_back(v);
+                if (with_lcp && format == GCIS_LCP_INT) {
+                    lcp_buf.push_back(lcp);
+                } else if (with_lcp && format == GCIS_LCP_BYTE) {
+                    byte_buf.push_back(lcp < 255 ? (unsigned char)lcp : 255);
+                    if (lcp >= 255) {
+                        uint_t entry = i - 2;
+                        overflow_buf.insert(overflow_buf.end(), (char *)&entry,
+                                            (char *)&entry + sizeof(uint_t));
+                        overflow_buf.insert(overflow_buf.end(), (char *)&lcp,
+                                            (char *)&lcp + sizeof(int_t));
+                    }
+                } else if (with_lcp) {
+                    uint64_t b = 2 * (uint64_t)v + lcp;
+                    plcp[b / 64] |= 1ULL << (b % 64);
+                }
+                if (sa_buf.size() == EXTERNAL_WRITE_BUFFER)
+                    flush();
+            });
+        flush();
+        if (with_lcp && format == GCIS_LCP_PLCP)
+            write_fd(lcp_fd, (const char *)plcp.data(),
+                     plcp.size() * sizeof(uint64_t));
+        return str;
+    }
+
+    /**
+     * @brief Writes the BWT of the text to bwt_fd as the suffixes are
+     * induced, instead of the suffix array. The BWT has one symbol per
+     * suffix, including the sentinel, which is written as a NUL byte. If
+     * runs_fd >= 0, the position where each run of equal symbols of the
+     * BWT starts is written to it as a uint_t. Memory is used as in
+     * decode_saca_external without the LCP array: a budget that holds the
+     * suffix array and the text builds it in memory, and a smaller one
+     * keeps the suffixes being induced in temporary files.
+     *
+     * @return the decoded text, as decode_saca
+     */
+    virtual unsigned char *decode_bwt(int bwt_fd, int runs_fd, uint64_t memory,
+                                      const std::string &tmp_dir) {
+        std::vector<unsigned char> bwt_buf;
+        std::vector<uint_t> run_buf;
+        auto flush = [&]() {
+            write_fd(bwt_fd, (const char *)bwt_buf.data(), bwt_buf.size());
+            if (runs_fd >= 0)
+                write_fd(runs_fd, (const char *)run_buf.data(),
+                         run_buf.size() * sizeof(uint_t));
+            bwt_buf.clear();
+            run_buf.clear();
+        };
+        uint64_t i = 0;
+        unsigned char prev = 0;
+        unsigned char *str = saca_external(
+            false, memory, tmp_dir,
+            EXTERNAL_WRITE_BUFFER * (1 + sizeof(uint_t)), true,
+            [&](const unsigned char *s, uint64_t, uint_t v, int_t) {
+                unsigned char c = v > 0 ? s[v - 1] : 0;
+                bwt_buf.push_back(c);
+                if (runs_fd >= 0 && (i == 0 || c != prev))
+                    run_buf.push_back(i);
+                prev = c;
+                i++;
+                if (bwt_buf.size() == EXTERNAL_WRITE_BUFFER)
+                    flush();
+            });
+        flush();
+        return str;
+    }
+
+    unsigned char *decode_saca_da(uint_t **SA, uint_t **DA) {
+        if (document_end.empty())
+            throw std::runtime_error("the text is not a document collection");
+        unsigned char *str = decode_saca(SA);
+        uint64_t n = text_length() + 1;
+        uint_t *sa = *SA;
+        uint_t *da = new uint_t[n];
+#pragma omp parallel for num_threads(n_threads)
+        for (int64_t i = 0; i < (int64_t)n; i++) {
+            da[i] = document_of(sa[i]);
+        }
+        *DA = da;
+        return str;
+    }
+
+    unsigned char *decode_saca_da_external(int sa_fd, int da_fd,
+                                           uint64_t memory,
+                                           const std::string &tmp_dir) {
+        if (document_end.empty())
+            throw std::runtime_error("the text is not a document collection");
+        std::vector<uint_t> sa_buf, da_buf;
+        auto flush = [&]() {
+            write_fd(sa_fd, (const char *)sa_buf.data(),
+                     sa_buf.size() * sizeof(uint_t));
+            write_fd(da_fd, (const char *)da_buf.data(),
+                     da_buf.size() * sizeof(uint_t));
+            sa_buf.clear();
+            da_buf.clear();
+        };
+        bool sentinel = true;
+        unsigned char *str = saca_external(
+            false, memory, tmp_dir, EXTERNAL_WRITE_BUFFER * 2 * sizeof(uint_t),
+            true, [&](const unsigned char *, uint64_t n, uint_t v, int_t) {
+                if (sentinel) {
+                    size_t m = n - 1;
+                    write_fd(sa_fd, (const char *)&m, sizeof(m));
+                    write_fd(da_fd, (const char *)&m, sizeof(m));
+                    sentinel = false;
+                    return;
+                }
+                sa_buf.push_back(v);
+                da_buf.push_back(document_of(v));
+                if (sa_buf.size() == EXTERNAL_WRITE_BUFFER)
+                    flush();
+            });
+        flush();
+        return str;
+    }
+
+    /**
+     * @brief Decodes the text and calls sink(str, n, SA[i], LCP[i]) for
+     * every entry of its suffix array in order, with n the number of
+     * suffixes and LCP[i] = 0 if with_lcp is false. The sink holds
+     * sink_bytes of buffers while it is called.
+     *
+     * If whole_arrays is true and the arrays, the text, level 0
+     * decompressed and the buffers of the sink fit in memory bytes, or if
+     * the dictionary has no level, decode_saca or decode_saca_lcp is used. Otherwise the levels above the text are sorted in memory,
+     * which takes two integers per LMS-suffix of the text (four with the
+     * LCP array), the strings of two levels and a decompressed level at a
+     * time. The sorted LMS-suffixes are then spilled to a temporary file in
+     * tmp_dir and those arrays are freed, so that the suffixes of the text
+     * are induced with the text, the buffers of the sink and buffers of the
+     * buckets kept in temporary files (see gcis_bucket_file), which take
+     * the rest of the budget.
+     *
+     * Each of these arrays is counted against memory before it is
+     * allocated, and gcis_memory_error is thrown, before sink is called,
+     * if one does not fit. A memory of 0 sets no budget: the suffixes are
+     * then induced through the temporary files with about n bytes of
+     * buffers of the buckets.
+     */
+    template <class sink_f>
+    unsigned char *saca_external(bool with_lcp, uint64_t memory,
+                                 const std::string &tmp_dir,
+                                 uint64_t sink_bytes, bool whole_arrays,
+                                 sink_f sink) {
+        // Level 0 of a text with NUL bytes was sorted over shifted symbols
+        if (g.size() && g[0].alphabet_size > 256) {
+            throw(NotImplementedException("decode_saca of a text with NUL bytes"));
+        }
+        uint64_t n = g.size() ? (uint64_t)g[0].string_size : reduced_string.size();
+        uint64_t entry_bytes = sizeof(uint_t) + (with_lcp ? sizeof(int_t) : 0);
+
+        // decode_saca and decode_saca_lcp hold the arrays and the text, and
+        // while they decode the text the string of level 1 and level 0
+        // decompressed, whose size is only known once it is built
+        uint64_t n1 = g.size() > 1 ? (uint64_t)g[1].string_size : reduced_string.size();
+        uint64_t in_memory = n * (entry_bytes + 1) + sink_bytes;
+        bool fits = whole_arrays && memory && in_memory <= memory;
+        if (g.size() && fits) {
+            in_memory += n1 * sizeof(uint_t) +
+                         decompressed_level(0)->size_in_bytes();
+            fits = in_memory <= memory;
+        }
+        if (g.empty() || fits) {
+            if (memory && in_memory > memory) {
+                throw gcis_memory_error("the arrays of a text without levels",
+                                        in_memory, memory);
+            }
+            uint_t *SA;
+            int_t *LCP = NULL;
+            unsigned char *str =
+                with_lcp ? decode_saca_lcp(&SA, &LCP) : decode_saca(&SA);
+            for (uint64_t i = 0; i < n; i++) {
+                sink(str, n, SA[i], LCP ? LCP[i] : (int_t)0);
+            }
+            delete[] SA;
+            delete[] LCP;
+            return str;
+        }
+        gcis_memory_budget budget(memory ? memory : UINT64_MAX);
+
+        // Sorted LMS-suffixes of the text, and the LCP of each one and the
+        // previous one, read once in order by induce_external. They are
+        // written and read one output buffer at a time.
+        uint64_t seed_chunk = std::min<uint64_t>(n1, EXTERNAL_WRITE_BUFFER);
+        budget.take(2 * seed_chunk * entry_bytes,
+                    "buffering the sorted LMS-suffixes");
+        gcis_bucket_file<uint_t> seed(1, seed_chunk, tmp_dir);
+        std::unique_ptr<gcis_bucket_file<int_t>> seed_lcp;
+        if (with_lcp)
+            seed_lcp.reset(new gcis_bucket_file<int_t>(1, seed_chunk, tmp_dir));
+        std::unique_ptr<unsigned char[]> str;
+        {
+            // The sorted suffixes, the strings and the LMS-positions of two
+            // levels at a time
+            uint64_t level_bytes = 8 * seed_chunk * sizeof(uint_t);
+            budget.take(level_bytes, "buffering the levels");
+            std::unique_ptr<gcis_bucket_file<uint_t>> sorted, string;
+            reduced_levels_external(sorted, string, seed_chunk, memory, budget,
+                                    tmp_dir);
+
+            std::shared_ptr<level_t> gd = decompressed_level(0);
+            uint64_t gd_bytes = gd->size_in_bytes();
+            budget.take(gd_bytes + n, "decoding the text");
+            str.reset(new unsigned char[n]);
+            gcis_bucket_file<uint_t> lms(1, seed_chunk, tmp_dir);
+            uint64_t l = 0;
+            for (uint64_t j = 0; j < g[0].tail.size(); j++) {
+                str[l++] = g[0].tail[j];
+            }
+            for (uint64_t j = 0; j < string->size(0); j++) {
+                lms.push(0, l);
+                gd->expand_rule(string->at(0, j), (char *)str.get(), l);
+            }
+            str[n - 1] = 0;
+            gd.reset();
+            string.reset();
+            budget.give(gd_bytes);
+
+            lms_seeds_external(*sorted, lms, seed, str.get(), seed_lcp.get(),
+                               memory, budget, tmp_dir);
+            budget.give(level_bytes);
+        }
+
+        // The scans keep the file offsets of the spilled chunks, an LCP
+        // stack of at most 4K entries and a few integers per bucket
+        const uint64_t K = 256;
+        uint64_t files = with_lcp ? 4 : 2;
+        budget.take(sink_bytes, "the output buffers");
+        budget.take(8 * files * (n / BUCKET_FILE_MIN_CHUNK + K) + 256 * K,
+                    "the state of the scans");
+        // Both bucket files of the SA (and of the LCP) buffer up to chunk
+        // entries of each of the K buckets, and read one chunk at a time.
+        // No bucket holds more than n entries.
+        uint64_t chunk_bytes = (2 * K + 2) * entry_bytes;
+        uint64_t chunk = std::max<uint64_t>(
+            memory ? std::min<uint64_t>(budget.left() / chunk_bytes, n)
+                   : n / chunk_bytes,
+            BUCKET_FILE_MIN_CHUNK);
+        budget.take(chunk * chunk_bytes, "buffering the buckets");
+
+        induce_external(str.get(), n, seed, seed_lcp.get(), n1, chunk, tmp_dir,
+                        sink);
+        return str.release();
+    }
+
+    /**
+     * @brief Sorts the suffixes of the string of level 1, which is the
+     * order of the LMS-substrings of the text, inducing them from the
+     * reduced string level by level as decode_saca does, but with
+     * induce_level_external. Only the string of the level being sorted is
+     * kept in memory: the strings of the other levels, the sorted suffixes
+     * of the level above and the LMS-positions are kept in single-list
+     * gcis_bucket_file of chunk entries. On return, sorted holds the
+     * suffixes of level 1 in order, as positions in its string, and string
+     * its symbols.
+     *
+     * The strings and the buckets of each level are counted against
+     * budget, which already holds the buffers of four of these files,
+     * before they are allocated, and each decompressed level as soon as it
+     * is built. The buckets of each level take the rest of the budget, half
+     * of it in memory and half in buffers of temporary files. With a
+     * memory of 0, a level is sorted in memory about 1/64 of its suffixes
+     * at a time, with as many entries of buffers as suffixes.
+     */
+    void reduced_levels_external(
+        std::unique_ptr<gcis_bucket_file<uint_t>> &sorted,
+        std::unique_ptr<gcis_bucket_file<uint_t>> &string, uint64_t chunk,
+        uint64_t memory, gcis_memory_budget &budget,
+        const std::string &tmp_dir) {
+        uint64_t m = reduced_string.size();
+        sorted.reset(new gcis_bucket_file<uint_t>(1, chunk, tmp_dir));
+        string.reset(new gcis_bucket_file<uint_t>(1, chunk, tmp_dir));
+        {
+            // The suffix array, and at most a copy of the reduced string
+            // and a byte per symbol
+            uint64_t top_bytes = m * (2 * sizeof(uint_t) + 1);
+            budget.take(top_bytes, "sorting the reduced string");
+            std::vector<uint_t> SA(m);
+            reduced_string_sa(SA.data());
+            for (uint64_t i = 0; i < m; i++) {
+                sorted->push(0, SA[i]);
+                string->push(0, reduced_string[i]);
+            }
+            budget.give(top_bytes);
+        }
+        for (int64_t level = g.size() - 1; level > 0; level--) {
+            std::string name = "level " + std::to_string(level);
+            uint64_t n = g[level].string_size, K = g[level].alphabet_size;
+            sdsl::int_vector<> s;
+            uint64_t string_bytes;
+            // Sorted LMS-suffixes of the level, the suffixes of the level
+            // above
+            gcis_bucket_file<uint_t> seed(1, chunk, tmp_dir);
+            {
+                gcis_bucket_file<uint_t> lms(1, chunk, tmp_dir);
+                string_bytes = level_string(level, *string, s, lms, budget);
+                string.reset();
+                lms_seeds_external(*sorted, lms, seed, NULL, NULL, memory,
+                                   budget, tmp_dir);
+            }
+            sorted.reset(new gcis_bucket_file<uint_t>(1, chunk, tmp_dir));
+
+            uint64_t cap = std::max<uint64_t>(
+                memory ? budget.left() / 2 /
+                             gcis_group_buckets<uint_t>::bytes(1)
+                       : n / 64,
+                BUCKET_FILE_MIN_CHUNK);
+            cap = std::min(cap, n);
+            uint64_t group_bytes = gcis_symbol_groups::bytes(n, K, cap) +
+                                   gcis_group_buckets<uint_t>::bytes(cap);
+            budget.take(group_bytes, "grouping the buckets of " + name);
+            gcis_symbol_groups groups(s, K, cap);
+
+            // The lists of the L-type and S-type suffixes of each group
+            // buffer up to level_chunk entries, as do the lists of the
+            // sorted ones and the three files read one chunk at a time. The
+            // scans keep the offsets of the spilled chunks.
+            uint64_t lists = 2 * groups.size() + 7;
+            uint64_t state_bytes =
+                8 * 4 * (n / BUCKET_FILE_MIN_CHUNK + 1) + 64 * lists;
+            budget.take(state_bytes, "the state of the scans of " + name);
+            uint64_t level_chunk = std::max<uint64_t>(
+                memory ? std::min<uint64_t>(
+                             budget.left() / (lists * sizeof(uint_t)), n)
+                       : n / lists,
+                BUCKET_FILE_MIN_CHUNK);
+            uint64_t chunk_bytes = level_chunk * lists * sizeof(uint_t);
+            budget.take(chunk_bytes, "buffering the buckets of " + name);
+            induce_level_external(s, groups, seed, *sorted, level_chunk,
+                                  tmp_dir);
+            budget.give(group_bytes + state_bytes + chunk_bytes);
+
+            string.reset(new gcis_bucket_file<uint_t>(1, chunk, tmp_dir));
+            for (uint64_t i = 0; i < n; i++) {
+                string->push(0, s[i]);
+            }
+            budget.give(string_bytes);
+        }
+    }
+
+    /**
+     * @brief Expands the string of level level into s, from the symbols of
+     * the level above in the single list of above, and appends to lms the
+     * position in s where each one is expanded, its LMS-positions in
+     * order. Returns the bytes of s, which are taken from budget with
+     * those of the decompressed level.
+     */
+    uint64_t level_string(uint64_t level, gcis_bucket_file<uint_t> &above,
+                          sdsl::int_vector<> &s, gcis_bucket_file<uint_t> &lms,
+                          gcis_memory_budget &budget) {
+        std::shared_ptr<level_t> gd = decompressed_level(level);
+        uint64_t n = g[level].string_size;
+        uint64_t width = sdsl::bits::hi(g[level].alphabet_size - 1) + 1;
+        uint64_t gd_bytes = gd->size_in_bytes();
+        uint64_t string_bytes = (n * width + 63) / 64 * 8;
+        budget.take(gd_bytes + string_bytes,
+                    "decoding level " + std::to_string(level));
+        s.width(width);
+        s.resize(n);
+        uint64_t l = 0;
+        for (uint64_t j = 0; j < g[level].tail.size(); j++) {
+            s[l++] = g[level].tail[j];
+        }
+        for (uint64_t j = 0; j < above.size(0); j++) {
+            lms.push(0, l);
+            gd->expand_rule(above.at(0, j), s, l);
+        }
+        budget.give(gd_bytes);
+        return string_bytes;
+    }
+
+    /**
+     * @brief Sorts the suffixes of the string s of a level above the text,
+     * whose last symbol is the sentinel, from its sorted LMS-suffixes in
+     * the single list of seed, and appends them in order to the single
+     * list of out.
+     *
+     * This is induce_external for an alphabet too large for a list per
+     * bucket: the lists of the L-type and S-type suffixes are kept per
+     * range of buckets of groups. The scans sort the suffixes of a range
+     * of several symbols in memory when they reach it (see
+     * gcis_group_buckets), and those of a single symbol in its list, as
+     * induce_external does. The L-type suffixes are appended to a list in
+     * the order of the first scan, and the S-type ones in reverse order to
+     * another, and both are merged by bucket into out.
+     */
+    void induce_level_external(const sdsl::int_vector<> &s,
+                               const gcis_symbol_groups &groups,
+                               gcis_bucket_file<uint_t> &seed,
+                               gcis_bucket_file<uint_t> &out, uint64_t chunk,
+                               const std::string &tmp_dir) {
+        const uint64_t NONE = UINT64_MAX;
+        uint64_t n = s.size(), G = groups.size();
+        gcis_bucket_file<uint_t> L(G, chunk, tmp_dir), S(G, chunk, tmp_dir);
+        gcis_bucket_file<uint_t> L_sorted(1, chunk, tmp_dir),
+            S_sorted(1, chunk, tmp_dir);
+        gcis_group_buckets<uint_t> group;
+        // Range loaded in group, whose suffixes are induced into it
+        uint64_t loaded = NONE;
+        auto induce = [&](gcis_bucket_file<uint_t> &f, uint64_t v) {
+            uint64_t c = s[v - 1], r = groups.of(c);
+            if (r == loaded)
+                group.push(c, v - 1);
+            else
+                f.push(r, v - 1);
+        };
+
+        // L-type suffixes, scanning the L-type and the LMS-suffixes
+        auto induce_l = [&](uint64_t v) {
+            L_sorted.push(0, v);
+            if (v > 0 && s[v - 1] >= s[v])
+                induce(L, v);
+        };
+        uint64_t n1 = seed.size(0), k1 = 0;
+        for (uint64_t r = 0; r < G; r++) {
+            uint64_t a = groups.begin(r), b = groups.end(r);
+            loaded = NONE;
+            if (b - a == 1) {
+                for (uint64_t k = 0; k < L.size(r); k++) {
+                    induce_l(L.at(r, k));
+                }
+            } else {
+                group.load(s, a, b, L, r, groups.count(r));
+                loaded = r;
+            }
+            for (uint64_t c = a; c < b; c++) {
+                if (loaded == r)
+                    group.scan(c, induce_l);
+                for (; k1 < n1 && s[seed.at(0, k1)] == c; k1++) {
+                    uint64_t v = seed.at(0, k1);
+                    if (v > 0 && s[v - 1] >= s[v])
+                        induce(L, v);
+                }
+            }
+        }
+
+        // S-type suffixes, scanning them and the L-type suffixes backward
+        uint64_t l = L_sorted.size(0);
+        for (uint64_t r = G; r-- > 0;) {
+            uint64_t a = groups.begin(r), b = groups.end(r);
+            loaded = NONE;
+            if (b - a > 1) {
+                group.load(s, a, b, S, r, groups.count(r));
+                loaded = r;
+            }
+            for (uint64_t c = b; c-- > a;) {
+                auto induce_s = [&](uint64_t v) {
+                    S_sorted.push(0, v);
+                    if (v > 0 && s[v - 1] <= c)
+                        induce(S, v);
+                };
+                if (loaded == r) {
+                    group.scan(c, induce_s);
+                } else {
+                    for (uint64_t k = 0; k < S.size(r); k++) {
+                        induce_s(S.at(r, k));
+                    }
+                }
+                for (; l > 0 && s[L_sorted.at(0, l - 1)] == c; l--) {
+                    uint64_t v = L_sorted.at(0, l - 1);
+                    if (v > 0 && s[v - 1] < c)
+                        induce(S, v);
+                }
+            }
+        }
+
+        // The sentinel, then the L-type and S-type suffixes of each bucket
+        out.push(0, n - 1);
+        uint64_t nl = L_sorted.size(0), ns = S_sorted.size(0);
+        l = 0;
+        while (l < nl || ns > 0) {
+            uint64_t c = std::min(l < nl ? s[L_sorted.at(0, l)] : NONE,
+                                  ns > 0 ? s[S_sorted.at(0, ns - 1)] : NONE);
+            for (; l < nl && s[L_sorted.at(0, l)] == c; l++) {
+                out.push(0, L_sorted.at(0, l));
+            }
+            for (; ns > 0 && s[S_sorted.at(0, ns - 1)] == c; ns--) {
+                out.push(0, S_sorted.at(0, ns - 1));
+            }
+        }
+    }
+
+    /**
+     * @brief Appends to seed the positions of the sorted LMS-suffixes of a
+     * string, given by the single list of sorted as their ranks in text
+     * order, from their positions in text order in the single list of lms.
+     * If str is not NULL, the string is the text str and the LCP of each
+     * LMS-suffix and the previous one is appended to seed_lcp, the values
+     * of compute_lcp_phi_sparse_sais.
+     *
+     * The ranks are permuted through gcis_bucket_file lists of cap ranks
+     * each, a list at a time in memory: the ranks in text order by list
+     * of their position in text order, the positions in sorted order by
+     * list of their rank, and for the LCP values, which are computed in
+     * text order, the position of the previous suffix of each one by list
+     * of its position in text order, and the values by list of rank. The
+     * lists and their buffers take the rest of budget, half each, or about
+     * 1/64 of the LMS-suffixes and as many entries of buffers with a
+     * memory of 0.
+     */
+    void lms_seeds_external(gcis_bucket_file<uint_t> &sorted,
+                            gcis_bucket_file<uint_t> &lms,
+                            gcis_bucket_file<uint_t> &seed,
+                            const unsigned char *str,
+                            gcis_bucket_file<int_t> *seed_lcp,
+                            uint64_t memory, gcis_memory_budget &budget,
+                            const std::string &tmp_dir) {
+        struct rank_entry {
+            uint_t u, rank;
+        };
+        // The position of an LMS-suffix and the length of its LMS-substring
+        struct position_entry {
+            uint_t rank, pos, len;
+        };
+        struct previous_entry {
+            uint_t u, rank, pos, len;
+        };
+        struct lcp_entry {
+            uint_t rank;
+            int_t lcp;
+        };
+        uint64_t n1 = sorted.size(0);
+        uint64_t cap = std::max<uint64_t>(
+            memory ? budget.left() / 2 / (3 * sizeof(uint_t)) : n1 / 64,
+            BUCKET_FILE_MIN_CHUNK);
+        cap = std::min(cap, n1);
+        uint64_t R = (n1 + cap - 1) / cap;
+        uint64_t range_bytes = 3 * cap * sizeof(uint_t);
+        // Two of the files at a time
+        uint64_t entry_bytes =
+            str ? sizeof(position_entry) + sizeof(previous_entry)
+                : sizeof(rank_entry) + sizeof(position_entry);
+        uint64_t state_bytes = 8 * 2 * (R + n1 / BUCKET_FILE_MIN_CHUNK + 1);
+        budget.take(range_bytes + state_bytes, "permuting the LMS-suffixes");
+        uint64_t chunk = std::max<uint64_t>(
+            memory ? std::min<uint64_t>(budget.left() / ((R + 1) * entry_bytes),
+                                        cap)
+                   : n1 / (R + 1),
+            BUCKET_FILE_MIN_CHUNK);
+        uint64_t chunk_bytes = chunk * (R + 1) * entry_bytes;
+        budget.take(chunk_bytes, "buffering the LMS-suffixes");
+
+        // The length of the LMS-substring of the sentinel is taken as 0
+        auto length = [&](uint64_t u, uint64_t pos) {
+            return u + 1 < n1 ? lms.at(0, u + 1) - pos : 0;
+        };
+        std::unique_ptr<gcis_bucket_file<position_entry>> position(
+            new gcis_bucket_file<position_entry>(R, chunk, tmp_dir));
+        {
+            gcis_bucket_file<rank_entry> rank(R, chunk, tmp_dir);
+            for (uint64_t i = 0; i < n1; i++) {
+                uint_t u = sorted.at(0, i);
+                rank.push(u / cap, {u, (uint_t)i});
+            }
+            std::vector<uint_t> rank_of(cap);
+            for (uint64_t q = 0; q < R; q++) {
+                uint64_t first = q * cap;
+                for (uint64_t k = 0; k < rank.size(q); k++) {
+                    rank_entry e = rank.at(q, k);
+                    rank_of[e.u - first] = e.rank;
+                }
+                for (uint64_t u = first; u < std::min(first + cap, n1); u++) {
+                    uint64_t i = rank_of[u - first], pos = lms.at(0, u);
+                    position->push(i / cap, {(uint_t)i, (uint_t)pos,
+                                             (uint_t)length(u, pos)});
+                }
+            }
+        }
+        std::unique_ptr<gcis_bucket_file<previous_entry>> previous;
+        if (str)
+            previous.reset(
+                new gcis_bucket_file<previous_entry>(R, chunk, tmp_dir));
+        {
+            std::vector<uint_t> pos_of(cap), len_of(cap);
+            uint64_t prev_pos = 0, prev_len = 0;
+            for (uint64_t q = 0; q < R; q++) {
+                uint64_t first = q * cap;
+                for (uint64_t k = 0; k < position->size(q); k++) {
+                    position_entry e = position->at(q, k);
+                    pos_of[e.rank - first] = e.pos;
+                    len_of[e.rank - first] = e.len;
+                }
+                for (uint64_t i = first; i < std::min(first + cap, n1); i++) {
+                    seed.push(0, pos_of[i - first]);
+                    if (str && i > 0) {
+                        uint_t u = sorted.at(0, i);
+                        previous->push(u / cap, {u, (uint_t)i, (uint_t)prev_pos,
+                                                 (uint_t)prev_len});
+                    }
+                    prev_pos = pos_of[i - first];
+                    prev_len = len_of[i - first];
+                }
+            }
+        }
+        position.reset();
+        if (str) {
+            gcis_bucket_file<lcp_entry> lcp(R, chunk, tmp_dir);
+            {
+                std::vector<uint_t> rank_of(cap), pos_of(cap), len_of(cap);
+                int64_t l = 0;
+                for (uint64_t q = 0; q < R; q++) {
+                    uint64_t first = q * cap;
+                    for (uint64_t k = 0; k < previous->size(q); k++) {
+                        previous_entry e = previous->at(q, k);
+                        rank_of[e.u - first] = e.rank;
+                        pos_of[e.u - first] = e.pos;
+                        len_of[e.u - first] = e.len;
+                    }
+                    // The sentinel, last in text order, has no previous
+                    // suffix
+                    uint64_t last = std::min(first + cap, n1 - 1);
+                    for (uint64_t u = first; u < last; u++) {
+                        if (l < 0)
+                            l = 0;
+                        uint64_t p = lms.at(0, u), p_prev = pos_of[u - first];
+                        while (str[p + l] == str[p_prev + l])
+                            l++;
+                        uint64_t i = rank_of[u - first];
+                        lcp.push(i / cap, {(uint_t)i, (int_t)l});
+                        l -= max((uint64_t)length(u, p),
+                                 (uint64_t)len_of[u - first]);
+                    }
+                }
+            }
+            previous.reset();
+            lcp.push(0, {(uint_t)0, (int_t)0});
+            std::vector<int_t> lcp_of(cap);
+            for (uint64_t q = 0; q < R; q++) {
+                uint64_t first = q * cap;
+                for (uint64_t k = 0; k < lcp.size(q); k++) {
+                    lcp_entry e = lcp.at(q, k);
+                    lcp_of[e.rank - first] = e.lcp;
+                }
+                for (uint64_t i = first; i < std::min(first + cap, n1); i++) {
+                    seed_lcp->push(0, lcp_of[i - first]);
+                }
+            }
+        }
+        budget.give(range_bytes + state_bytes + chunk_bytes);
+    }
+
+    /**
+     * @brief Induces the suffix array of the text str[0..n), with
+     * str[n-1] = 0, from its n1 sorted LMS-suffixes, the single list of
+     * seed, and its LCP array when seed_lcp (the LCP of each LMS-suffix and
+     * the previous one) is not NULL, and passes their entries to sink as
+     * saca_external does. The seeds are read once, in order.
+     *
+     * Bucket c of the suffix array is the L-type suffixes starting with c
+     * followed by the S-type ones. The L-type suffixes of each bucket are
+     * appended in the order of the scan that induces them, and the S-type
+     * ones in reverse order, to the lists of two gcis_bucket_file. The LCP
+     * of an induced suffix and the one induced before it into the same
+     * bucket is one more than the minimum LCP of the scan between the
+     * suffixes they were induced from (see gcis_lcp_stack).
+     */
+    template <class sink_f>
+    void induce_external(const unsigned char *str, uint64_t n,
+                         gcis_bucket_file<uint_t> &seed,
+                         gcis_bucket_file<int_t> *seed_lcp, uint64_t n1,
+                         uint64_t chunk, const std::string &tmp_dir,
+                         sink_f &sink) {
+        const uint64_t K = 256, NONE = UINT64_MAX;
+        bool with_lcp = seed_lcp != NULL;
+        gcis_bucket_file<uint_t> L(K, chunk, tmp_dir), S(K, chunk, tmp_dir);
+        std::unique_ptr<gcis_bucket_file<int_t>> L_lcp, S_lcp;
+        if (with_lcp) {
+            L_lcp.reset(new gcis_bucket_file<int_t>(K, chunk, tmp_dir));
+            S_lcp.reset(new gcis_bucket_file<int_t>(K, chunk, tmp_dir));
+        }
+        // LCP with the last L-type suffix of bucket c (0 if there is none)
+        auto seam = [&](uint64_t v, uint64_t c) {
+            uint64_t l = 0;
+            if (L.size(c)) {
+                uint64_t u = L.at(c, L.size(c) - 1);
+                while (str[v + l] == str[u + l])
+                    l++;
+            }
+            return (int_t)l;
+        };
+        gcis_lcp_stack stack;
+        // Scan index from which the LCP of the next suffix induced into
+        // each bucket is taken
+        std::vector<uint64_t> from(K, NONE);
+
+        // L-type suffixes, scanning the sentinel, the L-type and the
+        // LMS-suffixes, with the LCP of each one and the previous one
+        uint64_t p = 0;
+        auto induce_l = [&](uint64_t v, int_t lcp) {
+            if (with_lcp)
+                stack.push(p, lcp);
+            if (v > 0 && str[v - 1] >= str[v]) {
+                uint64_t c = str[v - 1];
+                L.push(c, v - 1);
+                if (with_lcp) {
+                    L_lcp->push(c, from[c] == NONE ? 0 : stack.min_from(from[c]) + 1);
+                    from[c] = p + 1;
+                }
+            }
+            p++;
+            if (with_lcp && stack.size() > 4 * K)
+                stack.compact(from);
+        };
+        uint64_t k1 = 0;
+        for (uint64_t c = 0; c < K; c++) {
+            for (uint64_t k = 0; k < L.size(c); k++) {
+                induce_l(L.at(c, k), with_lcp ? L_lcp->at(c, k) : (int_t)0);
+            }
+            for (uint64_t k = k1; k1 < n1 && str[seed.at(0, k1)] == c; k1++) {
+                uint64_t v = seed.at(0, k1);
+                int_t lcp = 0;
+                if (with_lcp)
+                    lcp = k1 == k ? seam(v, c) : seed_lcp->at(0, k1);
+                induce_l(v, lcp);
+            }
+        }
+
+        // S-type suffixes, scanning every suffix but the sentinel from
+        // right to left. An S-type suffix is induced after the LCP of the
+        // suffix it follows in its bucket is taken.
+        std::vector<int_t> seams(K, 0);
+        stack.clear();
+        from.assign(K, NONE);
+        uint64_t q = 0;
+        auto induce_s = [&](uint64_t v, uint64_t max_c) {
+            if (v > 0 && str[v - 1] <= max_c) {
+                uint64_t c = str[v - 1];
+                S.push(c, v - 1);
+                if (with_lcp) {
+                    S_lcp->push(c, from[c] == NONE ? 0 : stack.min_from(from[c]) + 1);
+                    from[c] = q;
+                }
+            }
+        };
+        auto scanned = [&](int_t lcp) {
+            if (with_lcp) {
+                stack.push(q, lcp);
+                if (stack.size() > 4 * K)
+                    stack.compact(from);
+            }
+            q++;
+        };
+        for (uint64_t c = K - 1; c > 0; c--) {
+            for (uint64_t k = 0; k < S.size(c); k++) {
+                uint64_t v = S.at(c, k);
+                induce_s(v, c);
+                int_t lcp = 0;
+                if (with_lcp) {
+                    if (k + 1 < S.size(c))
+                        lcp = S_lcp->at(c, k + 1);
+                    else
+                        lcp = seams[c] = seam(v, c);
+                }
+                scanned(lcp);
+            }
+            for (uint64_t k = L.size(c); k-- > 0;) {
+                induce_s(L.at(c, k), c - 1);
+                scanned(with_lcp ? L_lcp->at(c, k) : (int_t)0);
+            }
+        }
+
+        // Bucket by bucket, the L-type suffixes and the S-type ones reversed
+        sink(str, n, (uint_t)(n - 1), (int_t)0);
+        for (uint64_t c = 1; c < K; c++) {
+            for (uint64_t k = 0; k < L.size(c); k++) {
+                sink(str, n, L.at(c, k), with_lcp ? L_lcp->at(c, k) : (int_t)0);
+            }
+            for (uint64_t k = S.size(c); k-- > 0;) {
+                int_t lcp = 0;
+                if (with_lcp)
+                    lcp = k + 1 == S.size(c) ? seams[c] : S_lcp->at(c, k + 1);
+                sink(str, n, S.at(c, k), lcp);
+            }
+        }
+    }
+    void serialize_mapped(std::ostream &o){
+        throw(NotImplementedException("serialize_mapped"));
     }
     virtual uint64_t size_in_bytes() {
         uint64_t total_bytes = 0;
@@ -92,40 +2338,106 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
             total_bytes += g[i].size_in_bytes();
         }
         total_bytes += sdsl::size_in_bytes(reduced_string);
+        total_bytes += sdsl::size_in_bytes(document_end);
         return total_bytes;
     }
 
-    void encode(char *s) {
-        int_t n = strlen(s) + 1;
-        uint_t *SA = new uint_t[n];
-        int_t K = 256;
-        int cs = sizeof(char);
+    void encode(const char *s, uint64_t n) {
+        if (n + 1 > (uint64_t)I_MAX) {
+            throw std::length_error(
+                "input too large for " + std::to_string(8 * sizeof(uint_t)) +
+                "-bit indexes");
+        }
+        uint_t *SA = new uint_t[n + 1];
         int level = 0;
-
-        gc_is((int_t *)s, SA, n, K, cs, level);
+        level_cache.clear();
+        level_index.clear();
+        fingerprints.clear();
+        document_end = sdsl::int_vector<>();
+
+        // The sentinel must be the only occurrence of the smallest symbol,
+        // so a text containing NUL bytes is sorted with its bytes shifted
+        // by one as they are read (see gcis_escaped_text). The dictionary
+        // still stores the original bytes (see stored_symbol).
+        escaped_text = memchr(s, 0, n) != NULL;
+        if (escaped_text) {
+            gc_is((int_t *)s, SA, n + 1, 257, ESCAPED_BYTES, level);
+        } else {
+            gc_is((int_t *)s, SA, n + 1, 256, sizeof(char), level);
+        }
+        escaped_text = false;
 
         delete[] SA;
     }
 
+    void encode_collection(const char *s, uint64_t n, char separator) {
+        encode(s, n);
+        std::vector<uint64_t> end;
+        for (const char *p = s; p < s + n;) {
+            const char *q = (const char *)memchr(p, separator, s + n - p);
+            p = q ? q + 1 : s + n;
+            end.push_back(p - s);
+        }
+        document_end = sdsl::int_vector<>(end.size());
+        for (uint64_t k = 0; k < end.size(); k++) {
+            document_end[k] = end[k];
+        }
+        sdsl::util::bit_compress(document_end);
+    }
+
+    uint64_t document_count() { return document_end.size(); }
+
+    uint64_t text_length() {
+        if (g.empty())
+            return reduced_string.size() - 1;
+        return (uint64_t)g[0].string_size - 1;
+    }
+
     virtual char *decode() = 0;
 
     virtual void serialize(std::ostream &o) {
+        gcis_header h;
+        h.index_bytes = sizeof(uint_t);
+        h.serialize(o);
         reduced_string.serialize(o);
         uint64_t size = g.size();
         o.write((char *)&size, sizeof(uint64_t));
         for (uint64_t i = 0; i < g.size(); i++) {
             g[i].serialize(o);
         }
+        document_end.serialize(o);
     }
 
     virtual void load(std::istream &i) {
         uint64_t size;
+        header.load(i);
+        if (header.magic == GCIS_BLOCKS_MAGIC) {
+            throw std::runtime_error(
+                "file is a block container, load it with gcis_blocks");
+        }
+        if (header.magic == GCIS_MAPPED_MAGIC) {
+            throw std::runtime_error("file is a mapped dictionary, open it "
+                                     "with gcis_mapped_dictionary");
+        }
+        if (header.index_bytes != sizeof(uint_t)) {
+            throw std::runtime_error(
+                "file was compressed with " +
+                std::to_string(8 * header.index_bytes) +
+                "-bit indexes, this build uses " +
+                std::to_string(8 * sizeof(uint_t)) + "-bit indexes");
+        }
+        level_cache.clear();
+        level_index.clear();
+        fingerprints.clear();
         reduced_string.load(i);
         i.read((char *)&size, sizeof(uint64_t));
         g.resize(size);
         for (uint64_t j = 0; j < size; j++) {
             g[j].load(i);
         }
+        document_end = sdsl::int_vector<>();
+        if (header.version >= 4)
+            document_end.load(i);
     }
 
     bool lcp_array_check(uint_t *SA, int_t *LCP, unsigned char *s, size_t len, int cs,
@@ -214,10 +2526,9 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
     uint_t *saca(char *s, uint_t *SA, int_t n) {
 
         int_t K = 256;
-        int cs = sizeof(char);
         int level = 0;
 
-        SAIS((int_t *)s, SA, n, K, cs, level);
+        SAIS((unsigned char *)s, SA, n, K, level);
 
         return SA;
     }
@@ -234,16 +2545,229 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         return false;
     }
 
+    /**
+     * @brief Stores the length of each LMS-substring of s in the slot
+     * SA[n1 + pos / 2] where its name is later written, so the naming loop
+     * reads it in O(1) instead of walking the type array. The sentinel
+     * LMS-substring has length 1.
+     */
+    void store_lms_lengths(unsigned char *t, uint_t *SA, int_t n, int_t n1) {
+        int_t next = n - 1;
+        SA[n1 + (n - 1) / 2] = 1;
+        for (int_t j = n - 2; j > 0; j--) {
+            if (isLMS(j)) {
+                SA[n1 + j / 2] = next - j;
+                next = j;
+            }
+        }
+    }
+
+    /**
+     * @brief Length of the longest common prefix of s[a,a+m) and s[b,b+m).
+     * Symbols narrower than 64 bits are compared a word at a time.
+     */
+    template <class sym_t>
+    int_t lms_lcp(const sym_t *s, int_t a, int_t b, int_t m) {
+        int_t d = 0;
+        if (std::is_integral<sym_t>::value && sizeof(sym_t) < 8) {
+            const int_t w = 8 / sizeof(sym_t); // symbols per word
+            for (; d + w <= m; d += w) {
+                uint64_t x, y;
+                memcpy(&x, s + a + d, 8);
+                memcpy(&y, s + b + d, 8);
+                if (x != y) {
+                    // The first differing symbol holds the lowest differing
+                    // byte on little endian machines
+                    return d + (__builtin_ctzll(x ^ y) >> 3) / sizeof(sym_t);
+                }
+            }
+        }
+        while (d < m && chr(a + d) == chr(b + d))
+            d++;
+        return d;
+    }
+
+    // lms_lcp of a text read through a view, symbol by symbol
+    template <class text_t>
+    int_t lms_lcp(text_t s, int_t a, int_t b, int_t m) {
+        int_t d = 0;
+        while (d < m && chr(a + d) == chr(b + d))
+            d++;
+        return d;
+    }
+
+    /**
+     * @brief Compares the LMS-substrings starting at pos and prev, of
+     * lengths len and prev_len.
+     *
+     * @param last_symbol Whether the symbols at pos+len and prev+len (the
+     * LMS positions closing both substrings) take part in the comparison.
+     * Substrings closed by the sentinel are always different.
+     * @param d Receives the LCP of both substrings.
+     * @return true if the substrings differ
+     */
+    template <class text_t>
+    bool lms_substrings_differ(text_t s, int_t pos, int_t len,
+                               int_t prev, int_t prev_len, int_t n,
+                               bool last_symbol, int_t &d) {
+        int_t m = len < prev_len ? len : prev_len;
+        d = lms_lcp(s, pos, prev, m);
+        if (d < m || len != prev_len)
+            return true;
+        if (!last_symbol)
+            return false;
+        return pos + len == n - 1 || prev + len == n - 1 ||
+               chr(pos + len) != chr(prev + len);
+    }
+
+    /**
+     * @brief Counts the rules the naming step creates from the n1 sorted
+     * LMS-substrings in SA[0..n1), whose lengths are in SA[n1..) (see
+     * store_lms_lengths), so that their buffers are allocated once.
+     * @param last_symbol as in lms_substrings_differ
+     */
+    template <class text_t>
+    uint64_t count_rules(text_t s, uint_t *SA, int_t n, int_t n1,
+                         bool last_symbol) {
+        uint64_t rules = 0;
+        int_t prev = -1;
+        int_t prev_len = 0;
+        for (int_t i = 0; i < n1; i++) {
+            int_t pos = SA[i];
+            int_t len = SA[n1 + pos / 2];
+            int_t d;
+            if (prev == -1 || lms_substrings_differ(s, pos, len, prev,
+                                                    prev_len, n, last_symbol,
+                                                    d)) {
+                rules++;
+                prev = pos;
+                prev_len = len;
+            }
+        }
+        return rules;
+    }
+
+    // Symbol s[i] as written to the dictionary: the bytes of an escaped
+    // text (see encode) are shifted back at level 0
+    template <class text_t>
+    uint64_t stored_symbol(text_t s, uint64_t i, int level) {
+        uint64_t c = (uint64_t)s[i];
+        return (level == 0 && escaped_text && c > 0) ? c - 1 : c;
+    }
+
+    /**
+     * @brief Packs the reduced string s1, stored as n1 uint_t values, in
+     * place into the narrowest symbol type able to hold an alphabet of
+     * size K, so the next level reads fewer bytes per symbol.
+     * @return the width in bytes of the packed symbols
+     */
+    int narrow_reduced_string(uint_t *s1, int_t n1, int_t K) {
+        if ((uint64_t)K <= 0x100ULL)
+            return pack_symbols<uint8_t>(s1, n1);
+        if ((uint64_t)K <= 0x10000ULL)
+            return pack_symbols<uint16_t>(s1, n1);
+        if ((uint64_t)K <= 0x100000000ULL)
+            return pack_symbols<uint32_t>(s1, n1);
+        return sizeof(uint_t);
+    }
+
+    // Overwrites s1 with its values converted to sym_t. Symbol i is read
+    // before any write can reach it, since sym_t is not wider than uint_t.
+    template <class sym_t> int pack_symbols(uint_t *s1, int_t n1) {
+        if (sizeof(sym_t) < sizeof(uint_t)) {
+            unsigned char *p = (unsigned char *)s1;
+            for (int_t i = 0; i < n1; i++) {
+                sym_t v = (sym_t)(uint64_t)s1[i];
+                memcpy(p + i * sizeof(sym_t), &v, sizeof(sym_t));
+            }
+        }
+        return sizeof(sym_t);
+    }
+
+    /**
+     * @brief Writes the tail of a level followed by the expansion of the
+     * symbols of r_string by the rules of gd into out.
+     *
+     * With several threads, r_string is split into chunks whose output
+     * offsets come from a prefix sum of their rule lengths. The thread of
+     * a chunk writes the output positions from the multiple of 64 at or
+     * after its offset up to the one of the next chunk, so threads never
+     * share a word of a bit-packed out.
+     */
+    template <class level_t, class out_t>
+    void expand_level(level_t &gd, sdsl::int_vector<> &tail,
+                      sdsl::int_vector<> &r_string, out_t &out) {
+        uint64_t l = 0;
+        for (uint64_t j = 0; j < tail.size(); j++) {
+            out[l++] = tail[j];
+        }
+        uint64_t m = r_string.size();
+        if (n_threads == 1 || m < 2 * EXPAND_CHUNK) {
+            for (uint64_t j = 0; j < m; j++) {
+                gd.expand_rule(r_string[j], out, l);
+            }
+            return;
+        }
+
+        uint64_t n_chunks = (m + EXPAND_CHUNK - 1) / EXPAND_CHUNK;
+        std::vector<uint64_t> offset(n_chunks + 1, 0);
+#pragma omp parallel for schedule(static) num_threads(n_threads)
+        for (int64_t c = 0; c < (int64_t)n_chunks; c++) {
+            uint64_t end = std::min<uint64_t>(m, (c + 1) * EXPAND_CHUNK);
+            uint64_t len = 0;
+            for (uint64_t j = c * EXPAND_CHUNK; j < end; j++) {
+                len += gd.rule_length(r_string[j]);
+            }
+            offset[c + 1] = len;
+        }
+        offset[0] = l;
+        for (uint64_t c = 0; c < n_chunks; c++) {
+            offset[c + 1] += offset[c];
+        }
+
+#pragma omp parallel for schedule(static) num_threads(n_threads)
+        for (int64_t c = 0; c < (int64_t)n_chunks; c++) {
+            // The tail is already written, so the first chunk starts right
+            // after it. Rounding up must not pass the end of out, which a
+            // short last chunk may leave within 64 positions of the end.
+            uint64_t total = offset[n_chunks];
+            uint64_t begin =
+                c == 0 ? offset[0]
+                       : std::min<uint64_t>((offset[c] + 63) & ~63ULL, total);
+            uint64_t end =
+                std::min<uint64_t>((offset[c + 1] + 63) & ~63ULL, total);
+            uint64_t p = offset[c];
+            for (uint64_t j = c * EXPAND_CHUNK; p < end && j < m; j++) {
+                uint64_t rule = r_string[j];
+                uint64_t start = gd.rule_start(rule);
+                uint64_t len = gd.rule_length(rule);
+                uint64_t k = p < begin ? std::min(begin - p, len) : 0;
+                for (; k < len && p + k < end; k++) {
+                    out[p + k] = gd.rule[start + k];
+                }
+                p += len;
+            }
+        }
+    }
+
     //!
     //! \param s Sequence containing \0 in the end
     //! \param SA i-th level Suffix Array
     //! \param n size of sequence s
     //! \param K  Alphabet Size
-    //! \param cs Symbol Length
+    //! \param cs Symbol Length (1, 2, 4 or sizeof(uint_t) bytes)
     //! \param level current level of recursion.
 
     virtual void gc_is(int_t *s, uint_t *SA, int_t n, int_t K, int cs,
                        int level) {
+        GC_IS_DISPATCH(s, SA, n, K, cs, level);
+    }
+
+    // Body of gc_is for the symbols of the current level, an array of
+    // symbols or a gcis_escaped_text
+    template <class text_t>
+    void gc_is_level(text_t s, uint_t *SA, int_t n, int_t K,
+                     int level) {
         int_t i, j;
 
 #ifdef MEM_MONITOR
@@ -277,7 +2801,7 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         size_t first = n - 1;
 
         // sort all the S-substrings
-        get_buckets(s, bkt, n, K, cs, true); // find ends of buckets
+        get_buckets(s, bkt, n, K, true); // find ends of buckets
 
         for (i = 0; i < n; i++) {
             SA[i] = EMPTY;
@@ -293,10 +2817,10 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         SA[0] = n - 1; // set the single sentinel LMS-substring
 
         // Induce L-Type suffixes by using LMS-Type and L-Type suffixes
-        induceSAl(t, SA, s, bkt, n, K, cs, level);
+        induceSAl(t, SA, s, bkt, n, K, level);
 
         // Induce S-Type suffixes by using L-Type and S-Type suffixes
-        induceSAs(t, SA, s, bkt, n, K, cs, level);
+        induceSAs(t, SA, s, bkt, n, K, level);
 
         delete[] bkt;
 
@@ -312,15 +2836,17 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
 
         // Init the name array buffer
         // SA[0,n1-1] = LMS starting positions
-        // SA[n1,n-1] = Name for each LMS substring
+        // SA[n1,n-1] = Name for each LMS substring (its length until named)
         for (i = n1; i < n; i++) {
             SA[i] = EMPTY;
         }
+        store_lms_lengths(t, SA, n, n1);
 
         // find the lexicographic names of all LMS-substrings by comparing the
         // consecutive ones
         int_t name = -1;
         int_t prev = -1;
+        int_t prev_len = 0;
 
         int_t last_set_lcp_bit = -1;
         uint_t rule_index = 0;
@@ -328,41 +2854,19 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         // Iterate over all suffixes in the LMS sorted array
         for (i = 0; i < n1; i++) {
             int_t pos = SA[i];
-            bool diff = false;
-            int_t d;
+            // Length of the LMS-substring, replaced by its name below
+            int_t len = SA[n1 + pos / 2];
+            bool diff = true;
             // d equals to the LCP between two consecutive LMS-substrings
-            for (d = 0; d < n; d++) {
-                // If is first suffix in LMS order (sentinel), or one of the
-                // suffixes reached the last position of T, or the
-                // characters of T differs or the type os suffixes differ.
-                if (prev == -1 || pos + d == n - 1 || prev + d == n - 1 ||
-                    chr(pos + d) != chr(prev + d) ||
-                    (isLMS(pos + d) ^ (isLMS(prev + d)))) {
-                    diff = true;
-                    break;
-                }
-                // The comparison has reached the end of at least one
-                // LMS-substring
-                if (d > 0 && (isLMS(pos + d) || isLMS(prev + d))) {
-                    break;
-                }
+            int_t d = 0;
+            if (prev != -1) {
+                diff = lms_substrings_differ(s, pos, len, prev, prev_len, n,
+                                             true, d);
             }
 
             // The consecutive LMS-substrings differs
             if (diff) {
 
-                // Get the length of the current lms-substring
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
-
-                // Get the length of the previous LMS-Substring
-                size_t len2 = 1;
-                if (prev != n - 1)
-                    while (!isLMS(prev + len2))
-                        len2++;
-
                 // Resizes Rule array, LCP array and rule delimiter bitvector
                 uint64_t old_lcp_size, old_rule_delim_size;
 
@@ -384,13 +2888,10 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
                 // a new name
                 name++;
                 prev = pos;
+                prev_len = len;
             }
 #ifdef REPORT
             else {
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
                 discarded_rules_len += len;
                 discarded_rules_n++;
             }
@@ -449,7 +2950,8 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         bool premature_stop =
             evaluate_premature_stop(n, K, n1, name + 1, level);
         if (name + 1 < n1 && !premature_stop) {
-            gc_is((int_t *)s1, SA1, n1, name + 1, sizeof(int_t), level + 1);
+            gc_is((int_t *)s1, SA1, n1, name + 1,
+                  narrow_reduced_string(s1, n1, name + 1), level + 1);
         } else { // generate the suffix array of s1 directly
             if (premature_stop) {
 #ifdef REPORT
@@ -458,7 +2960,7 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
                 reduced_string.resize(n);
                 for (j = 0; j < n; j++) {
                     // Copy the reduced substring
-                    reduced_string[j] = s[j];
+                    reduced_string[j] = stored_symbol(s, j, level);
                 }
                 // Discard the last computed level
                 g.pop_back();
@@ -511,10 +3013,17 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
 
     // compute SA for the S-Type suffixes by inducing the L-Type suffixes and
     // the S-Type suffixes
-    void induceSAs(unsigned char *t, uint_t *SA, int_t *s, int_t *bkt, int_t n,
-                   int_t K, int cs, int level) {
+    template <class text_t>
+    void induceSAs(unsigned char *t, uint_t *SA, text_t s, int_t *bkt,
+                   int_t n, int_t K, int level) {
         int_t i, j;
-        get_buckets(s, bkt, n, K, cs, true); // find ends of buckets
+#ifdef _OPENMP
+        if (n_threads > 1 && n > INDUCE_BLOCK) {
+            induceSAs_parallel(t, SA, s, bkt, n, K, level);
+            return;
+        }
+#endif
+        get_buckets(s, bkt, n, K, true); // find ends of buckets
         for (i = n - 1; i >= 0; i--) {
             if (SA[i] != EMPTY) {
                 j = SA[i] - 1;
@@ -527,11 +3036,18 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
 
     // compute SA for the L-Type suffixes by inducing the LMS-Suffixes and the
     // L-Suffixes
-    void induceSAl(unsigned char *t, uint_t *SA, int_t *s, int_t *bkt, int_t n,
-                   int_t K, int cs, int level) {
+    template <class text_t>
+    void induceSAl(unsigned char *t, uint_t *SA, text_t s, int_t *bkt,
+                   int_t n, int_t K, int level) {
         int_t i, j;
+#ifdef _OPENMP
+        if (n_threads > 1 && n > INDUCE_BLOCK) {
+            induceSAl_parallel(t, SA, s, bkt, n, K, level);
+            return;
+        }
+#endif
         // find heads of buckets
-        get_buckets(s, bkt, n, K, cs, false);
+        get_buckets(s, bkt, n, K, false);
         //  if(level==0) bkt[0]++;
         for (i = 0; i < n; i++) {
             if (SA[i] != EMPTY) {
@@ -543,9 +3059,195 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         }
     }
 
-    void compute_lcp_phi_sparse_sais(int_t *s, uint_t *SA1, 
+#ifdef _OPENMP
+    // Block-wise parallel version of induceSAl. SA is scanned in blocks of
+    // INDUCE_BLOCK entries: the predecessor of each suffix in the block and
+    // its bucket are fetched in parallel, then the bucket heads are advanced
+    // sequentially (keeping the exact order of the sequential scan), and
+    // the induced suffixes that fall after the block are written in parallel.
+    // An entry induced inside its own block is detected by comparing it
+    // against the value seen in the first phase and is resolved on the spot.
+    template <class text_t>
+    void induceSAl_parallel(unsigned char *t, uint_t *SA, text_t s,
+                            int_t *bkt, int_t n, int_t K, int level) {
+        get_buckets(s, bkt, n, K, false);
+        std::vector<uint_t> seen(INDUCE_BLOCK), val(INDUCE_BLOCK);
+        std::vector<int_t> sym(INDUCE_BLOCK), pos(INDUCE_BLOCK);
+        for (int64_t b = 0; b < n; b += INDUCE_BLOCK) {
+            int64_t e = b + INDUCE_BLOCK < (int64_t)n ? b + INDUCE_BLOCK : (int64_t)n;
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t i = b; i < e; i++) {
+                uint_t v = SA[i];
+                seen[i - b] = v;
+                sym[i - b] = (v != (uint_t)EMPTY && v > 0 && !tget(v - 1))
+                                 ? (int_t)chr(v - 1)
+                                 : (int_t)-1;
+            }
+            int64_t m = 0;
+            for (int64_t i = b; i < e; i++) {
+                uint_t v = SA[i];
+                int_t c = sym[i - b];
+                if (v != seen[i - b]) {
+                    c = (v != (uint_t)EMPTY && v > 0 && !tget(v - 1))
+                            ? (int_t)chr(v - 1)
+                            : (int_t)-1;
+                }
+                if (c < 0)
+                    continue;
+                int_t p = bkt[c]++;
+                if (p < e) {
+                    SA[p] = v - 1;
+                } else {
+                    pos[m] = p;
+                    val[m++] = v - 1;
+                }
+            }
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t k = 0; k < m; k++) {
+                SA[pos[k]] = val[k];
+            }
+        }
+    }
+
+    // Block-wise parallel version of induceSAs, scanning SA from right to
+    // left (see induceSAl_parallel).
+    template <class text_t>
+    void induceSAs_parallel(unsigned char *t, uint_t *SA, text_t s,
+                            int_t *bkt, int_t n, int_t K, int level) {
+        get_buckets(s, bkt, n, K, true);
+        std::vector<uint_t> seen(INDUCE_BLOCK), val(INDUCE_BLOCK);
+        std::vector<int_t> sym(INDUCE_BLOCK), pos(INDUCE_BLOCK);
+        for (int64_t e = n; e > 0; e -= INDUCE_BLOCK) {
+            int64_t b = e > INDUCE_BLOCK ? e - INDUCE_BLOCK : 0;
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t i = b; i < e; i++) {
+                uint_t v = SA[i];
+                seen[i - b] = v;
+                sym[i - b] = (v != (uint_t)EMPTY && v > 0 && tget(v - 1))
+                                 ? (int_t)chr(v - 1)
+                                 : (int_t)-1;
+            }
+            int64_t m = 0;
+            for (int64_t i = e - 1; i >= b; i--) {
+                uint_t v = SA[i];
+                int_t c = sym[i - b];
+                if (v != seen[i - b]) {
+                    c = (v != (uint_t)EMPTY && v > 0 && tget(v - 1))
+                            ? (int_t)chr(v - 1)
+                            : (int_t)-1;
+                }
+                if (c < 0)
+                    continue;
+                int_t p = bkt[c]--;
+                if (p >= b) {
+                    SA[p] = v - 1;
+                } else {
+                    pos[m] = p;
+                    val[m++] = v - 1;
+                }
+            }
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t k = 0; k < m; k++) {
+                SA[pos[k]] = val[k];
+            }
+        }
+    }
+
+    // Block-wise parallel version of the induceSAl of decode_saca, which
+    // tells the L-type predecessors by comparing symbols instead of reading
+    // a type array (see induceSAl_parallel above).
+    template <class text_t>
+    void induceSAl_parallel(uint_t *SA, text_t s, int_t *cnt,
+                            int_t *bkt, int_t n, int_t K, int level) {
+        get_buckets(cnt, bkt, K, false);
+        std::vector<uint_t> seen(INDUCE_BLOCK), val(INDUCE_BLOCK);
+        std::vector<int_t> sym(INDUCE_BLOCK), pos(INDUCE_BLOCK);
+        for (int64_t b = 0; b < n; b += INDUCE_BLOCK) {
+            int64_t e = b + INDUCE_BLOCK < (int64_t)n ? b + INDUCE_BLOCK : (int64_t)n;
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t i = b; i < e; i++) {
+                uint_t v = SA[i];
+                seen[i - b] = v;
+                sym[i - b] = (v != (uint_t)EMPTY && v > 0 && chr(v - 1) >= chr(v))
+                                 ? (int_t)chr(v - 1)
+                                 : (int_t)-1;
+            }
+            int64_t m = 0;
+            for (int64_t i = b; i < e; i++) {
+                uint_t v = SA[i];
+                int_t c = sym[i - b];
+                if (v != seen[i - b]) {
+                    c = (v != (uint_t)EMPTY && v > 0 && chr(v - 1) >= chr(v))
+                            ? (int_t)chr(v - 1)
+                            : (int_t)-1;
+                }
+                if (c < 0)
+                    continue;
+                int_t p = bkt[c]++;
+                if (p < e) {
+                    SA[p] = v - 1;
+                } else {
+                    pos[m] = p;
+                    val[m++] = v - 1;
+                }
+            }
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t k = 0; k < m; k++) {
+                SA[pos[k]] = val[k];
+            }
+        }
+    }
+
+    // Block-wise parallel version of the induceSAs of decode_saca. A suffix
+    // is only induced to the left of the current entry, which is checked
+    // against the bucket tail in the sequential phase.
+    template <class text_t>
+    void induceSAs_parallel(uint_t *SA, text_t s, int_t *cnt,
+                            int_t *bkt, int_t n, int_t K, int level) {
+        get_buckets(cnt, bkt, K, true);
+        std::vector<uint_t> seen(INDUCE_BLOCK), val(INDUCE_BLOCK);
+        std::vector<int_t> sym(INDUCE_BLOCK), pos(INDUCE_BLOCK);
+        for (int64_t e = n; e > 0; e -= INDUCE_BLOCK) {
+            int64_t b = e > INDUCE_BLOCK ? e - INDUCE_BLOCK : 0;
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t i = b; i < e; i++) {
+                uint_t v = SA[i];
+                seen[i - b] = v;
+                sym[i - b] = (v != (uint_t)EMPTY && v > 0 && chr(v - 1) <= chr(v))
+                                 ? (int_t)chr(v - 1)
+                                 : (int_t)-1;
+            }
+            int64_t m = 0;
+            for (int64_t i = e - 1; i >= b; i--) {
+                uint_t v = SA[i];
+                int_t c = sym[i - b];
+                if (v != seen[i - b]) {
+                    c = (v != (uint_t)EMPTY && v > 0 && chr(v - 1) <= chr(v))
+                            ? (int_t)chr(v - 1)
+                            : (int_t)-1;
+                }
+                if (c < 0 || bkt[c] >= i)
+                    continue;
+                int_t p = bkt[c]--;
+                if (p >= b) {
+                    SA[p] = v - 1;
+                } else {
+                    pos[m] = p;
+                    val[m++] = v - 1;
+                }
+            }
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int64_t k = 0; k < m; k++) {
+                SA[pos[k]] = val[k];
+            }
+        }
+    }
+#endif
+
+    template <class text_t>
+    void compute_lcp_phi_sparse_sais(text_t s, uint_t *SA1,
       uint_t *RA, int_t *LCP, int_t *PLCP,
-      uint_t n1, int cs) {
+      uint_t n1) {
     
       uint_t i;
     
@@ -579,9 +3281,16 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
 
     // compute SA for the S-Type suffixes by inducing the L-Type suffixes and
     // the S-Type suffixes
-    void induceSAs(uint_t *SA, int_t *s, int_t *cnt, int_t *bkt, int_t n,
-                   int_t K, int cs, int level) {
+    template <class text_t>
+    void induceSAs(uint_t *SA, text_t s, int_t *cnt, int_t *bkt, int_t n,
+                   int_t K, int level) {
         int_t i, j;
+#ifdef _OPENMP
+        if (n_threads > 1 && n > INDUCE_BLOCK) {
+            induceSAs_parallel(SA, s, cnt, bkt, n, K, level);
+            return;
+        }
+#endif
         get_buckets(cnt, bkt, K, true);
         for (i = n - 1; i >= 0; i--) {
             if (SA[i] != EMPTY) {
@@ -596,8 +3305,9 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
 
     // compute SA for the S-Type suffixes by inducing the L-Type suffixes and
     // the S-Type suffixes
-    void induceSAs_LCP(uint_t *SA, int_t *LCP, int_t *s, int_t *cnt, int_t *bkt, int_t n,
-                   int_t K, int cs, int level) {
+    template <class text_t>
+    void induceSAs_LCP(uint_t *SA, int_t *LCP, text_t s, int_t *cnt, int_t *bkt, int_t n,
+                   int_t K, int level) {
         int_t i, j;
         get_buckets(cnt, bkt, K, true);
 
@@ -669,7 +3379,7 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
               for(k=0; k<K; k++) if(M[k]>LCP[i]) M[k] = LCP[i];
             #elif RMQ == 2
 
-            int_t lcp=max(0,LCP[i]);
+            int_t lcp=max((int_t)0,LCP[i]);
             
             while(STACK[(top)-1].lcp>=lcp) (top)--;
             stack_push(STACK, &top, i, lcp);
@@ -714,9 +3424,16 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
 
     // compute SA for the L-Type suffixes by inducing the LMS-Suffixes and the
     // L-Suffixes
-    void induceSAl(uint_t *SA, int_t *s, int_t *cnt, int_t *bkt, int_t n,
-                   int_t K, int cs, int level) {
+    template <class text_t>
+    void induceSAl(uint_t *SA, text_t s, int_t *cnt, int_t *bkt, int_t n,
+                   int_t K, int level) {
         int_t i, j;
+#ifdef _OPENMP
+        if (n_threads > 1 && n > INDUCE_BLOCK) {
+            induceSAl_parallel(SA, s, cnt, bkt, n, K, level);
+            return;
+        }
+#endif
         // find heads of buckets
         get_buckets(cnt, bkt, K, false);
         //  if(level==0) bkt[0]++;
@@ -732,8 +3449,9 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
     }
     // compute SA for the L-Type suffixes by inducing the LMS-Suffixes and the
     // L-Suffixes
-    void induceSAl_LCP(uint_t *SA, int_t *LCP, int_t *s, int_t *cnt, int_t *bkt, int_t n,
-                   int_t K, int cs, int level) {
+    template <class text_t>
+    void induceSAl_LCP(uint_t *SA, int_t *LCP, text_t s, int_t *cnt, int_t *bkt, int_t n,
+                   int_t K, int level) {
         int_t i, j;
 
         for(i=0;i<K;i++)
@@ -781,7 +3499,7 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
                   last = last_occ[chr(SA[i]-1)];
                   last_occ[chr(SA[i]-1)] = i+1;
                   }
-                  int_t lcp=max(0,LCP[i]);
+                  int_t lcp=max((int_t)0,LCP[i]);
                   #if BINARY == 1 
                     int_t a=0, b=top-1;  
                     int_t m = (b-a)/2;                    
@@ -890,7 +3608,8 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
     }
 
     // Count frequencies
-    void get_counts(int_t *s, int_t *bkt, int_t n, int_t K, int cs) {
+    template <class text_t>
+    void get_counts(text_t s, int_t *bkt, int_t n, int_t K) {
         init_buckets(bkt, K);           // clear all buckets
         for (int_t i = 0; i < n; i++) { // compute the size of each bucket
             bkt[chr(i)]++;
@@ -915,7 +3634,8 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
     }
 
     // Compute the head or end of each bucket
-    void get_buckets(int_t *s, int_t *bkt, int_t n, int_t K, int cs, bool end) {
+    template <class text_t>
+    void get_buckets(text_t s, int_t *bkt, int_t n, int_t K, bool end) {
         int_t i, sum = 0;
 
         // clear all buckets
@@ -964,8 +3684,9 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         return 1;
     }
 
-    void SAIS(int_t *s, uint_t *SA, int_t n, int_t K, int cs, int level) {
-        int i, j;
+    template <class text_t>
+    void SAIS(text_t s, uint_t *SA, int_t n, int_t K, int level) {
+        int_t i, j;
 
         unsigned char *t =
             (unsigned char *)malloc(n / 8 + 1); // LS-type array in bits
@@ -981,10 +3702,10 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
                         ? 1
                         : 0);
 
-        int *bkt = (int *)malloc(sizeof(int) * K); // bucket counters
+        int_t *bkt = (int_t *)malloc(sizeof(int_t) * K); // bucket counters
 
         // sort all the S-substrings
-        get_buckets(s, bkt, n, K, cs, true); // find ends of buckets
+        get_buckets(s, bkt, n, K, true); // find ends of buckets
         for (i = 0; i < n; i++)
             SA[i] = EMPTY;
         for (i = n - 2; i >= 0; i--)
@@ -992,14 +3713,14 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
                 SA[bkt[chr(i)]--] = i;
         SA[0] = n - 1; // set the single sentinel LMS-substring
 
-        induceSAl(t, SA, s, bkt, n, K, cs, level);
-        induceSAs(t, SA, s, bkt, n, K, cs, level);
+        induceSAl(t, SA, s, bkt, n, K, level);
+        induceSAs(t, SA, s, bkt, n, K, level);
 
         free(bkt);
 
         // compact all the sorted substrings into the first n1 items of s
         // 2*n1 must be not larger than n (proveable)
-        int n1 = 0;
+        int_t n1 = 0;
         for (i = 0; i < n; i++)
             if (isLMS(SA[i]))
                 SA[n1++] = SA[i];
@@ -1008,11 +3729,11 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
         for (i = n1; i < n; i++)
             SA[i] = EMPTY;
         // find the lexicographic names of all substrings
-        int name = 0, prev = -1;
+        int_t name = 0, prev = -1;
         for (i = 0; i < n1; i++) {
-            int pos = SA[i];
+            int_t pos = SA[i];
             bool diff = false;
-            for (int d = 0; d < n; d++)
+            for (int_t d = 0; d < n; d++)
                 if (prev == -1 || pos + d == n - 1 || prev + d == n - 1 ||
                     chr(pos + d) != chr(prev + d) ||
                     tget(pos + d) != tget(prev + d)) {
@@ -1039,17 +3760,17 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
 
         // recurse if names are not yet unique
         if (name < n1) {
-            SAIS((int_t *)s1, SA1, n1, name, sizeof(int), level + 1);
+            SAIS((const uint_t *)s1, SA1, n1, name, level + 1);
         } else // generate the suffix array of s1 directly
             for (i = 0; i < n1; i++)
                 SA1[s1[i]] = i;
 
         // stage 3: induce the result for the original problem
 
-        bkt = (int *)malloc(sizeof(int) * K); // bucket counters
+        bkt = (int_t *)malloc(sizeof(int_t) * K); // bucket counters
 
         // put all left-most S characters into their buckets
-        get_buckets(s, bkt, n, K, cs, true); // find ends of buckets
+        get_buckets(s, bkt, n, K, true); // find ends of buckets
         j = 0;
         for (i = 1; i < n; i++)
             if (isLMS(i))
@@ -1067,8 +3788,8 @@ template <class codec_t> class gcis_abstract : public gcis_interface{
                 SA[bkt[chr(j)]--] = j;
         }
 
-        induceSAl(t, SA, s, bkt, n, K, cs, level);
-        induceSAs(t, SA, s, bkt, n, K, cs, level);
+        induceSAl(t, SA, s, bkt, n, K, level);
+        induceSAs(t, SA, s, bkt, n, K, level);
 
         free(bkt);
         free(t);
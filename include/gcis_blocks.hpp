@@ -0,0 +1,298 @@
+#ifndef GC_IS_GCIS_BLOCKS_HPP
+#define GC_IS_GCIS_BLOCKS_HPP
+
+#include "gcis.hpp"
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DEFAULT_BLOCK_SIZE (64ULL << 20) // symbols per block
+
+/**
+ * @brief Container of independent GC-IS grammars, one for each block of
+ * block_size consecutive symbols of the text.
+ *
+ * Blocks are encoded, decoded and loaded in parallel and extraction only
+ * touches the blocks overlapping each query, at the cost of not capturing
+ * repetitions across blocks. The memory of each thread is bounded by the
+ * block size.
+ *
+ * File layout: gcis_header (GCIS_BLOCKS_MAGIC), block size, number of
+ * blocks b, the text offset of each block followed by the text length
+ * (b+1 values), the byte offset of each serialized block followed by the
+ * end of the last one (b+1 values, relative to the first block) and the
+ * serialized blocks.
+ */
+template <class codec_t> class gcis_blocks : public gcis_interface {
+  public:
+    std::vector<gcis_dictionary<codec_t>> blocks;
+    // offset[b] is the position in the text of the first symbol of block b
+    std::vector<uint64_t> offset;
+
+  private:
+    uint64_t block_size;
+    int n_threads = 1;
+    uint64_t level_cache_bytes = 0;
+    uint64_t front_coding_bucket = FRONT_CODING_BUCKET;
+    double front_coding_max_walk = FRONT_CODING_MAX_WALK;
+
+    // Writes T[l,r] into out, block by block
+    void extract(uint64_t l, uint64_t r, unsigned char *out,
+                 typename gcis_dictionary<codec_t>::extract_context &ctx) {
+        uint64_t b =
+            std::upper_bound(offset.begin(), offset.end(), l) - offset.begin() - 1;
+        for (; b < blocks.size() && offset[b] <= r; b++) {
+            if (offset[b] == offset[b + 1])
+                continue;
+            uint64_t bl = (l > offset[b] ? l : offset[b]) - offset[b];
+            uint64_t br = (r < offset[b + 1] - 1 ? r : offset[b + 1] - 1) - offset[b];
+            blocks[b].extract(bl, br, out + (offset[b] + bl - l), ctx);
+        }
+    }
+
+    // Splits the level cache budget evenly among the blocks
+    void apply_level_cache() {
+        for (auto &b : blocks) {
+            b.set_level_cache(level_cache_bytes / blocks.size());
+        }
+    }
+
+  public:
+    gcis_blocks(uint64_t block_size = DEFAULT_BLOCK_SIZE)
+        : block_size(block_size) {}
+
+    // Number of blocks processed in parallel (<= 0 uses all the cores)
+    void set_threads(int threads) {
+#ifdef _OPENMP
+        n_threads = threads > 0 ? threads : omp_get_max_threads();
+#else
+        n_threads = 1;
+#endif
+    }
+
+    void set_level_cache(uint64_t bytes) {
+        level_cache_bytes = bytes;
+        apply_level_cache();
+    }
+
+    // Front coding used to encode every block
+    void set_front_coding(uint64_t bucket,
+                          double max_walk = FRONT_CODING_MAX_WALK) {
+        front_coding_bucket = bucket;
+        front_coding_max_walk = max_walk;
+    }
+
+    // Builds the position indexes of every block; encode and load drop them
+    void build_position_index(bool plain_lengths) {
+        for (auto &b : blocks) {
+            b.build_position_index(plain_lengths);
+        }
+    }
+
+    using gcis_interface::encode;
+
+    void encode(const char *s, uint64_t n) {
+        if (block_size + 1 > (uint64_t)I_MAX) {
+            throw std::length_error(
+                "block too large for " + std::to_string(8 * sizeof(uint_t)) +
+                "-bit indexes");
+        }
+        uint64_t n_blocks = n ? (n + block_size - 1) / block_size : 1;
+        blocks.clear();
+        blocks.resize(n_blocks);
+        apply_level_cache();
+        offset.resize(n_blocks + 1);
+        for (uint64_t b = 0; b < n_blocks; b++) {
+            offset[b] = b * block_size;
+        }
+        offset[n_blocks] = n;
+
+#pragma omp parallel for schedule(dynamic) num_threads(n_threads)
+        for (int64_t b = 0; b < (int64_t)n_blocks; b++) {
+            uint64_t len = offset[b + 1] - offset[b];
+            char *block = new char[len + 1];
+            memcpy(block, s + offset[b], len);
+            block[len] = 0;
+            blocks[b].set_front_coding(front_coding_bucket,
+                                       front_coding_max_walk);
+            blocks[b].encode(block, len);
+            delete[] block;
+        }
+    }
+
+    uint64_t text_length() { return offset.back(); }
+
+    char *decode() {
+        uint64_t n = offset.back();
+        char *str = new char[n + 1];
+#pragma omp parallel for schedule(dynamic) num_threads(n_threads)
+        for (int64_t b = 0; b < (int64_t)blocks.size(); b++) {
+            char *block = blocks[b].decode();
+            memcpy(str + offset[b], block, offset[b + 1] - offset[b]);
+            delete[] block;
+        }
+        str[n] = 0;
+        return str;
+    }
+
+    // The blocks are decoded one after the other, so only the grammar of
+    // the current block is expanded at any time
+    void decode_to(int fd) {
+        for (auto &b : blocks) {
+            b.decode_to(fd);
+        }
+    }
+
+    void extract(uint64_t l, uint64_t r, unsigned char *out) {
+        typename gcis_dictionary<codec_t>::extract_context ctx;
+        extract(l, r, out, ctx);
+    }
+
+    using gcis_interface::extract_batch;
+
+    // Extracts several substrings T[l,r] into out, see extract_coalesced
+    void extract_batch(const vector<pair<uint64_t, uint64_t>> &query,
+                       const vector<unsigned char *> &out) {
+        typedef typename gcis_dictionary<codec_t>::extract_context context_t;
+        extract_coalesced<context_t>(
+            query, out, n_threads,
+            [&](uint64_t l, uint64_t r, unsigned char *o, context_t &ctx) {
+                ctx.cache_buckets = true;
+                extract(l, r, o, ctx);
+            });
+    }
+
+    unsigned char *decode_saca(uint_t **SA) {
+        throw(NotImplementedException("decode_saca on block containers"));
+    }
+
+    unsigned char *decode_saca_lcp(uint_t **SA, int_t **LCP) {
+        throw(NotImplementedException("decode_saca_lcp on block containers"));
+    }
+
+    unsigned char *decode_saca_external(int sa_fd, int lcp_fd, uint64_t memory,
+                                        const std::string &tmp_dir,
+                                        gcis_lcp_format format, int overflow_fd) {
+        throw(NotImplementedException(
+            "decode_saca_external on block containers"));
+    }
+
+    unsigned char *decode_bwt(int bwt_fd, int runs_fd, uint64_t memory,
+                              const std::string &tmp_dir) {
+        throw(NotImplementedException("decode_bwt on block containers"));
+    }
+
+    void encode_collection(const char *s, uint64_t n, char separator) {
+        throw(NotImplementedException("encode_collection on block containers"));
+    }
+
+    uint64_t document_count() { return 0; }
+
+    unsigned char *decode_saca_da(uint_t **SA, uint_t **DA) {
+        throw(NotImplementedException("decode_saca_da on block containers"));
+    }
+
+    unsigned char *decode_saca_da_external(int sa_fd, int da_fd,
+                                           uint64_t memory,
+                                           const std::string &tmp_dir) {
+        throw(NotImplementedException(
+            "decode_saca_da_external on block containers"));
+    }
+
+    void build_fingerprints(uint64_t seed = FINGERPRINT_SEED) {
+        throw(NotImplementedException("build_fingerprints on block containers"));
+    }
+
+    uint64_t lce(uint64_t i, uint64_t j) {
+        throw(NotImplementedException("lce on block containers"));
+    }
+
+    void lce_batch(const vector<pair<uint64_t, uint64_t>> &query,
+                   vector<uint64_t> &out) {
+        throw(NotImplementedException("lce on block containers"));
+    }
+
+    bool equal(uint64_t i, uint64_t j, uint64_t len) {
+        throw(NotImplementedException("equal on block containers"));
+    }
+
+    void serialize_mapped(std::ostream &o) {
+        throw(NotImplementedException("serialize_mapped on block containers"));
+    }
+
+    uint64_t size_in_bytes() {
+        uint64_t total_bytes = sizeof(block_size);
+        total_bytes += 2 * offset.size() * sizeof(uint64_t);
+        for (auto &b : blocks) {
+            total_bytes += b.size_in_bytes();
+        }
+        return total_bytes;
+    }
+
+    void serialize(std::ostream &o) {
+        std::vector<std::string> data(blocks.size());
+#pragma omp parallel for schedule(dynamic) num_threads(n_threads)
+        for (int64_t b = 0; b < (int64_t)blocks.size(); b++) {
+            std::ostringstream ss;
+            blocks[b].serialize(ss);
+            data[b] = ss.str();
+        }
+        std::vector<uint64_t> pos(blocks.size() + 1, 0);
+        for (uint64_t b = 0; b < blocks.size(); b++) {
+            pos[b + 1] = pos[b] + data[b].size();
+        }
+
+        gcis_header h;
+        h.magic = GCIS_BLOCKS_MAGIC;
+        h.index_bytes = sizeof(uint_t);
+        h.serialize(o);
+        uint64_t n_blocks = blocks.size();
+        o.write((char *)&block_size, sizeof(block_size));
+        o.write((char *)&n_blocks, sizeof(n_blocks));
+        o.write((char *)offset.data(), sizeof(uint64_t) * offset.size());
+        o.write((char *)pos.data(), sizeof(uint64_t) * pos.size());
+        for (auto &d : data) {
+            o.write(d.data(), d.size());
+        }
+    }
+
+    void load(std::istream &i) {
+        gcis_header h;
+        h.load(i);
+        if (h.magic != GCIS_BLOCKS_MAGIC) {
+            throw std::runtime_error("file is not a block container");
+        }
+        if (h.index_bytes != sizeof(uint_t)) {
+            throw std::runtime_error(
+                "file was compressed with " + std::to_string(8 * h.index_bytes) +
+                "-bit indexes, this build uses " +
+                std::to_string(8 * sizeof(uint_t)) + "-bit indexes");
+        }
+        uint64_t n_blocks;
+        i.read((char *)&block_size, sizeof(block_size));
+        i.read((char *)&n_blocks, sizeof(n_blocks));
+        offset.resize(n_blocks + 1);
+        std::vector<uint64_t> pos(n_blocks + 1);
+        i.read((char *)offset.data(), sizeof(uint64_t) * offset.size());
+        i.read((char *)pos.data(), sizeof(uint64_t) * pos.size());
+
+        // Read the blocks sequentially and parse them in parallel
+        std::vector<std::string> data(n_blocks);
+        for (uint64_t b = 0; b < n_blocks; b++) {
+            data[b].resize(pos[b + 1] - pos[b]);
+            i.read(&data[b][0], data[b].size());
+        }
+        blocks.clear();
+        blocks.resize(n_blocks);
+        apply_level_cache();
+#pragma omp parallel for schedule(dynamic) num_threads(n_threads)
+        for (int64_t b = 0; b < (int64_t)n_blocks; b++) {
+            std::istringstream ss(data[b]);
+            blocks[b].load(ss);
+            std::string().swap(data[b]);
+        }
+    }
+};
+
+#endif // GC_IS_GCIS_BLOCKS_HPP
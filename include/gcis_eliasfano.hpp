@@ -7,6 +7,9 @@
 
 #include "gcis.hpp"
 #include "gcis_eliasfano_codec.hpp"
+#include "gcis_mapped.hpp"
+#include "gcis_partial_sum.hpp"
+#include "gcis_rule_builder.hpp"
 #include <iostream>
 
 
@@ -25,54 +28,47 @@ class gcis_dictionary<gcis_eliasfano_codec>
   public:
     void serialize(std::ostream &o) override {
         gcis_abstract::serialize(o);
-        uint64_t n = partial_sum.size();
-        o.write((char *)&n, sizeof(n));
-        o.write((char *)partial_sum.data(), sizeof(uint32_t) * n);
+        partial_sum.serialize(o);
+        for (auto &level : g) {
+            o.write((char *)&level.front_coding_bucket, sizeof(uint64_t));
+        }
     }
 
     void load(std::istream &i) override {
         gcis_abstract::load(i);
+        if (header.version >= 2) {
+            partial_sum.load(i);
+        } else {
+            load_legacy_partial_sum(i);
+        }
+        // files before version 3 use FRONT_CODING_BUCKET on every level
+        for (auto &level : g) {
+            level.front_coding_bucket = FRONT_CODING_BUCKET;
+            if (header.version >= 3)
+                i.read((char *)&level.front_coding_bucket, sizeof(uint64_t));
+        }
+    }
+
+    // Older files store every partial sum, with 32 bits in version 0
+    void load_legacy_partial_sum(std::istream &i) {
         uint64_t n;
         i.read((char *)&n, sizeof(n));
-        partial_sum.resize(n);
-        i.read((char *)partial_sum.data(), sizeof(uint32_t) * n);
+        if (header.version == 0) {
+            std::vector<uint32_t> legacy(n);
+            i.read((char *)legacy.data(), sizeof(uint32_t) * n);
+            partial_sum.build(legacy);
+        } else {
+            std::vector<uint64_t> legacy(n);
+            i.read((char *)legacy.data(), sizeof(uint64_t) * n);
+            partial_sum.build(legacy);
+        }
     }
 
-
-    /**
-     * @brief Extracts several valid substrings of the form T[l,r]
-     * from the text.
-     *
-     * @param query A vector containing [l,r] pairs.
-     */
-       void extract_batch(vector<pair<int, int>> &query) {
-        int l, r;
-        std::tie(l, r) = query[0];
-        uint64_t query_length = 50000;
-        uint64_t size = query_length;
-        //            g.size() ?  (g.back().fully_decoded_tail_len +
-        //            (query_length))
-        //                   : (query_length);
-        sdsl::int_vector<> extracted_text(size);
-        sdsl::int_vector<> tmp_text(size);
-        auto first = std::chrono::high_resolution_clock::now();
-        auto total_time = std::chrono::high_resolution_clock::now();
-        for (auto p : query) {
-            // cout << "Extracting"
-            //      << "[" << p.first << "," << p.second << "]" << endl;
-            auto t0 = std::chrono::high_resolution_clock::now();
-            extract(p.first, p.second, extracted_text, tmp_text);
-            auto t1 = std::chrono::high_resolution_clock::now();
-            total_time += t1-t0;
-            for (uint64_t i = p.first; i <= p.second; i++) {
-                cout << (unsigned char)extracted_text[i - p.first];
-            }
-            cout << endl;
-        }
-        std::chrono::duration<double> elapsed = total_time - first;
-        cout << "Batch Extraction Total time(s): " << elapsed.count() << endl;
+    void serialize_mapped(std::ostream &o) override {
+        gcis_serialize_mapped(o, g, reduced_string);
     }
 
+
     /**
      * Extracts any valid substring T[l,r] from the text
      * @param l Beggining of such substring
@@ -89,33 +85,41 @@ class gcis_dictionary<gcis_eliasfano_codec>
         return extracted_text;
     }
 
+    using gcis_abstract::extract;
+
+    void extract(uint64_t l, uint64_t r, unsigned char *out,
+                 extract_context &ctx) override {
+        uint64_t size =
+            g.size() ? 4 * (g.back().fully_decoded_tail_len + (r - l + 1))
+                     : (r - l + 1);
+        if (ctx.text.size() < size) {
+            ctx.text.resize(size);
+            ctx.tmp.resize(size);
+        }
+        extract(l, r, ctx.text, ctx.tmp,
+                ctx.cache_buckets ? &ctx.buckets : nullptr);
+        for (uint64_t i = 0; i <= r - l; i++) {
+            out[i] = ctx.text[i];
+        }
+    }
+
     char *decode() override {
         sdsl::int_vector<> r_string = reduced_string;
         char *str;
         if (g.size()) {
             for (int64_t i = g.size() - 1; i >= 0; i--) {
                 sdsl::int_vector<> next_r_string;
-                gcis_eliasfano_codec_level gd = std::move(g[i].decompress());
+                std::shared_ptr<gcis_eliasfano_codec_level> gd =
+                    decompressed_level(i);
                 next_r_string.width(sdsl::bits::hi(g[i].alphabet_size - 1) + 1);
                 next_r_string.resize(g[i].string_size);
-                uint64_t l = 0;
                 if (i == 0) {
                     // Convert the reduced string in the original text
                     str = new char[g[i].string_size];
-                    for (uint64_t j = 0; j < g[i].tail.size(); j++) {
-                        str[l++] = g[i].tail[j];
-                    }
-                    for (uint64_t j = 0; j < r_string.size(); j++) {
-                        gd.expand_rule(r_string[j], str, l);
-                    }
+                    expand_level(*gd, g[i].tail, r_string, str);
                 } else {
                     // Convert the reduced string in the previous reduced string
-                    for (uint64_t j = 0; j < g[i].tail.size(); j++) {
-                        next_r_string[l++] = g[i].tail[j];
-                    }
-                    for (uint64_t j = 0; j < r_string.size(); j++) {
-                        gd.expand_rule(r_string[j], next_r_string, l);
-                    }
+                    expand_level(*gd, g[i].tail, r_string, next_r_string);
                     r_string = std::move(next_r_string);
                 }
             }
@@ -128,561 +132,33 @@ class gcis_dictionary<gcis_eliasfano_codec>
         return str;
     }
 
-    unsigned char* decode_saca(uint_t **sa) {
-
-        sdsl::int_vector<> r_string = reduced_string;
-        unsigned char* str;
-        uint_t n = g[0].string_size;
-        uint_t *SA = new uint_t[n];
-
-        int_t *s = (int_t *)SA + n / 2;
-
-        int cs = sizeof(int_t);
-        if (g.size()) {
-
-            for (int64_t level = g.size() - 1; level >= 0; level--) {
-#if TIME
-                auto start = timer::now();
-#endif
-
-                n = g[level].string_size;
-
-                uint_t n1 = r_string.size();
-                uint_t *SA1 = SA, *s1 = SA + n - n1;
-
-                // copy to s1[1]
-                if (level == g.size() - 1)
-                    for (uint_t i = 0; i < n1; i++)
-                        SA1[r_string[i]] = i;
-                else
-                    for (uint_t i = 0; i < n1; i++)
-                        s1[i] = SA[i];
-
-#if DEBUG
-                cout << endl
-                     << "level = " << level
-                     << "\t string_size = " << g[level].string_size << "\n"
-                     << "alphabet_size = " << g[level].alphabet_size << endl;
-                cout << "n = " << n << "\nn1 = " << n1 << endl;
-                cout << "\n####" << endl;
-                cout << "s1 = ";
-                for (uint_t i = 0; i < n1; i++) {
-                    cout << s1[i] << " ";
-                    cout << endl;
-                }
-#endif
-
-#if TIME
-                auto expand = timer::now();
-#endif
-
-                sdsl::int_vector<> next_r_string;
-                gcis_eliasfano_codec_level gd =
-                    std::move(g[level].decompress());
-                next_r_string.width(sdsl::bits::hi(g[level].alphabet_size - 1) +
-                                    1);
-                next_r_string.resize(g[level].string_size);
-                uint64_t l = 0;
-
-                int_t K = g[level].alphabet_size; // alphabet
-
-                int_t *bkt = new int_t[K]; // bucket
-                int_t *cnt = new int_t[K]; // counters
-
-                init_buckets(cnt, K);
-
-                if (level == 0) {
-
-                    // delete[] s;
-                    // Convert the reduced string in the original text
-                    str = new unsigned char[g[level].string_size];
-                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
-                        str[l++] = g[level].tail[j];
-                        cnt[g[level].tail[j]]++; // count frequencies
-                    }
-                    for (uint64_t j = 0; j < r_string.size(); j++) {
-                        gd.expand_rule_bkt(r_string[j], str, l, cnt);
-                    }
-                    n = g[level].string_size;
-                    // Classify the type of each character
-                    uint_t cur_t, succ_t;
-                    uint_t j = n1 - 1;
-                    s1[j--] = n - 1;
-                    succ_t = 0; // s[n-2] must be L-type
-                    for (uint_t i = n - 2; i > 0; i--) {
-                        cur_t = (str[i - 1] < str[i] ||
-                                 (str[i - 1] == str[i] && succ_t == 1))
-                                    ? 1
-                                    : 0;
-                        if (cur_t == 0 && succ_t == 1)
-                            s1[j--] = i;
-                        succ_t = cur_t;
-                    }
-                } else {
-
-                    init_buckets(bkt, K);
-
-                    // Convert the reduced string in the previous reduced string
-                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
-                        next_r_string[l++] = g[level].tail[j];
-                        cnt[g[level].tail[j]]++; // count frequencies
-                    }
-                    for (uint64_t j = 0; j < r_string.size(); j++) {
-                        gd.expand_rule_bkt(r_string[j], next_r_string, l, cnt);
-                    }
-                    r_string = std::move(next_r_string);
-
-                    // n=r_string.size();
-                    n = g[level].string_size;
-                    // copy to s[1]
-                    for (uint_t i = 0; i < n; i++)
-                        s[i] = r_string[i];
-
-                    // Classify the type of each character
-                    uint_t cur_t, succ_t;
-                    uint_t j = n1 - 1;
-                    s1[j--] = n - 1;
-                    succ_t = 0; // s[n-2] must be L-type
-                    for (uint_t i = n - 2; i > 0; i--) {
-                        cur_t =
-                            (r_string[i - 1] < r_string[i] ||
-                             (r_string[i - 1] == r_string[i] && succ_t == 1))
-                                ? 1
-                                : 0;
-                        if (cur_t == 0 && succ_t == 1)
-                            s1[j--] = i;
-                        succ_t = cur_t;
-                    }
-                }
-
-#if TIME
-                auto end = timer::now();
-                cout << "expand: "
-                     << (double)duration_cast<seconds>(end - expand).count()
-                     << " seconds" << endl;
-#endif
-
-#if DEGUB
-                cout << "n = " << n << "\nn1 = " << n1 << endl;
-                cout << "level = " << level
-                     << "\t string_size = " << g[level].string_size << "\n"
-                     << "alphabet_size = " << g[level].alphabet_size << endl;
-                cout << "SA1: ";
-                for (uint_t i = 0; i < n1; i++)
-                    cout << SA[i] << ", ";
-                cout << endl;
-#endif
-
-                // stage 3: induce the result for the original problem
-                get_buckets(cnt, bkt, K, true);
-
-#if TIME
-                auto begin = timer::now();
-#endif
-
-#if TIME
-                end = timer::now();
-                cout << "classify: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-                begin = timer::now();
-#endif
-
-#if DEGUB
-                for (int_t i = 0; i < n; i++) {
-                    cout << tget(i) << " ";
-                }
-                cout << endl;
-#endif
-
-                int_t j = 0;
-                for (int_t i = 0; i < n1; i++) {
-                    SA1[i] = s1[SA1[i]]; // get index in s1
-                }
-                for (int_t i = n1; i < n; i++) {
-                    SA[i] = EMPTY; // init SA[n1..n-1]
-                }
-
-                if (level) {
-                    for (int_t i = n1 - 1; i >= 0; i--) {
-                        j = SA[i];
-                        SA[i] = EMPTY;
-                        SA[bkt[chr(j)]--] = j;
-                    }
-                } else {
-                    for (int_t i = n1 - 1; i > 0; i--) {
-                        j = SA[i];
-                        SA[i] = EMPTY;
-                        SA[bkt[str[j]]--] = j;
-                    }
-                    SA[0] = n - 1;
-                }
-
-#if TIME
-                end = timer::now();
-                cout << "position: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-                begin = timer::now();
-#endif
-
-                if (level)
-                    induceSAl(SA, s, cnt, bkt, n, K, cs, level);
-                else
-                    induceSAl(SA, (int_t *)str, cnt, bkt, n, K,
-                              sizeof(unsigned char), level);
-
-#if TIME
-                end = timer::now();
-                cout << "induce L: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-                begin = timer::now();
-#endif
-
-                if (level)
-                    induceSAs(SA, s, cnt, bkt, n, K, cs, level);
-                else
-                    induceSAs(SA, (int_t *)str, cnt, bkt, n, K,
-                              sizeof(unsigned char), level);
-
-#if TIME
-                end = timer::now();
-                cout << "induce S: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-#endif
-
-#if DEGUB
-                cout << "SA: ";
-                for (uint_t i = 0; i < n; i++) {
-                    cout << SA[i] << ", ";
-                }
-                cout << endl;
-#endif
-                delete[] bkt;
-                delete[] cnt;
-
-#if TIME
-                auto stop = timer::now();
-                cout << "time: "
-                     << (double)duration_cast<seconds>(stop - start).count()
-                     << " seconds" << endl;
-#endif
-            }
-        } else {
-            str = new unsigned char[reduced_string.size()];
-            for (uint64_t i = 0; i < reduced_string.size(); i++)
-                str[i] = reduced_string[i];
-        }
-
-        *sa = SA;
-        return str;
-    }//end decode_saca
-
-    unsigned char *decode_saca_lcp(uint_t **sa, int_t **lcp) {
-
-        sdsl::int_vector<> r_string = reduced_string;
-        unsigned char *str;
-        uint_t n = g[0].string_size;
-        uint_t *SA = new uint_t[n];
-        int_t *LCP = new int_t[n];
-
-        uint_t i;
-        for(i=0;i<n;i++) SA[i]=LCP[i]=0;
-
-        int_t *s = (int_t *)SA + n / 2;
-
-        int cs = sizeof(int_t);
-        if (g.size()) {
-
-            for (int64_t level = g.size() - 1; level >= 0; level--) {
-#if TIME
-                auto start = timer::now();
-#endif
-
-                n = g[level].string_size;
-
-                uint_t n1 = r_string.size();
-                uint_t *SA1 = SA, *s1 = SA + n - n1;
-
-                // copy to s1[1]
-                if (level == g.size() - 1)
-                    for (uint_t i = 0; i < n1; i++)
-                        SA1[r_string[i]] = i;
-                else
-                    for (uint_t i = 0; i < n1; i++)
-                        s1[i] = SA[i];
-
-#if DEBUG
-                cout << endl
-                     << "level = " << level
-                     << "\t string_size = " << g[level].string_size << "\n"
-                     << "alphabet_size = " << g[level].alphabet_size << endl;
-                cout << "n = " << n << "\nn1 = " << n1 << endl;
-                cout << "\n####" << endl;
-                cout << "s1 = ";
-                for (uint_t i = 0; i < n1; i++) {
-                    cout << s1[i] << " ";
-                    cout << endl;
-                }
-#endif
-
-#if TIME
-                auto expand = timer::now();
-#endif
-
-                sdsl::int_vector<> next_r_string;
-                gcis_eliasfano_codec_level gd =
-                std::move(g[level].decompress());
-                next_r_string.width(sdsl::bits::hi(g[level].alphabet_size - 1) +
-                                    1);
-                next_r_string.resize(g[level].string_size);
-                uint64_t l = 0;
-
-                int_t K = g[level].alphabet_size; // alphabet
-
-                int_t *bkt = new int_t[K]; // bucket
-                int_t *cnt = new int_t[K]; // counters
-
-                init_buckets(cnt, K);
-
-                if (level == 0) {
-
-                    // delete[] s;
-                    // Convert the reduced string in the original text
-                    str = new unsigned char[g[level].string_size];
-                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
-                        str[l++] = g[level].tail[j];
-                        cnt[g[level].tail[j]]++; // count frequencies
-                    }
-                    for (uint64_t j = 0; j < r_string.size(); j++) {
-                        gd.expand_rule_bkt(r_string[j], str, l, cnt);
-                    }
-                    n = g[level].string_size;
-                    str[n-1]=0;
-                    // Classify the type of each character
-                    uint_t cur_t, succ_t;
-                    uint_t j = n1 - 1;
-                    s1[j--] = n - 1;
-                    succ_t = 0; // s[n-2] must be L-type
-                    for (uint_t i = n - 2; i > 0; i--) {
-                        cur_t = (str[i - 1] < str[i] ||
-                                 (str[i - 1] == str[i] && succ_t == 1))
-                                    ? 1
-                                    : 0;
-                        if (cur_t == 0 && succ_t == 1)
-                            s1[j--] = i;
-                        succ_t = cur_t;
-                    }
-                } else {
-
-                    init_buckets(bkt, K);
-
-                    // Convert the reduced string in the previous reduced string
-                    for (uint64_t j = 0; j < g[level].tail.size(); j++) {
-                        next_r_string[l++] = g[level].tail[j];
-                        cnt[g[level].tail[j]]++; // count frequencies
-                    }
-                    for (uint64_t j = 0; j < r_string.size(); j++) {
-                        gd.expand_rule_bkt(r_string[j], next_r_string, l, cnt);
-                    }
-                    r_string = std::move(next_r_string);
-
-                    // n=r_string.size();
-                    n = g[level].string_size;
-                    // copy to s[1]
-                    for (uint_t i = 0; i < n; i++)
-                        s[i] = r_string[i];
-
-                    // Classify the type of each character
-                    uint_t cur_t, succ_t;
-                    uint_t j = n1 - 1;
-                    s1[j--] = n - 1;
-                    succ_t = 0; // s[n-2] must be L-type
-                    for (uint_t i = n - 2; i > 0; i--) {
-                        cur_t =
-                            (r_string[i - 1] < r_string[i] ||
-                             (r_string[i - 1] == r_string[i] && succ_t == 1))
-                                ? 1
-                                : 0;
-                        if (cur_t == 0 && succ_t == 1)
-                            s1[j--] = i;
-                        succ_t = cur_t;
-                    }
-                }
-
-#if TIME
-                auto end = timer::now();
-                cout << "expand: "
-                     << (double)duration_cast<seconds>(end - expand).count()
-                     << " seconds" << endl;
-#endif
-
-#if DEGUB
-                cout << "n = " << n << "\nn1 = " << n1 << endl;
-                cout << "level = " << level
-                     << "\t string_size = " << g[level].string_size << "\n"
-                     << "alphabet_size = " << g[level].alphabet_size << endl;
-                cout << "SA1: ";
-                for (uint_t i = 0; i < n1; i++)
-                    cout << SA[i] << ", ";
-                cout << endl;
-#endif
-
-                // stage 3: induce the result for the original problem
-                get_buckets(cnt, bkt, K, true);
-
-#if TIME
-                auto begin = timer::now();
-#endif
-
-#if TIME
-                end = timer::now();
-                cout << "classify: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-                begin = timer::now();
-#endif
-
-#if DEGUB
-                for (int_t i = 0; i < n; i++) {
-                    cout << tget(i) << " ";
-                }
-                cout << endl;
-#endif
-
-                if(level == 0){
-                  uint_t *RA=s1;
-                  int_t *PLCP=LCP+n-n1;//PHI is stored in PLCP array
-                  //compute the LCP of consecutive LMS-suffixes
-                  compute_lcp_phi_sparse_sais((int_t*)str, SA1, RA, LCP, PLCP, n1, sizeof(char));
-                }
-
-                int_t j = 0;
-                for (int_t i = 0; i < n1; i++) {
-                    SA1[i] = s1[SA1[i]]; // get index in s1
-                }
-                for (int_t i = n1; i < n; i++) {
-                    SA[i] = EMPTY; // init SA[n1..n-1]
-                }
-
-                if(level == 0){
-                  for(i=n1;i<n;i++) LCP[i]=0;
-                }
-
-                if (level) {
-                    for (int_t i = n1 - 1; i >= 0; i--) {
-                        j = SA[i]; SA[i] = EMPTY;
-                        SA[bkt[chr(j)]--] = j;
-                    }
-                } else {
-                    int_t l;
-                    for (int_t i = n1 - 1; i > 0; i--) {
-                        j = SA[i];SA[i] = U_MAX;
-                        l=LCP[i]; LCP[i]=0;
-                    
-                        SA[bkt[str[j]]] = j;
-                        LCP[bkt[str[j]]--] = l;
-                    }
-                }
-
-#if TIME
-                end = timer::now();
-                cout << "position: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-                begin = timer::now();
-#endif
-
-                if (level)
-                    induceSAl(SA, s, cnt, bkt, n, K, cs, level);
-                else
-                    //induceSAl(SA, (int_t *)str, cnt, bkt, n, K,
-                    //          sizeof(char), level);
-                    induceSAl_LCP(SA, LCP, (int_t *)str, cnt, bkt, n, K,
-                              sizeof(unsigned char), level);
+    void decode_to(int fd) override { decoder()->write_to(fd); }
 
-                #if DEGUB
-                if(level==0){
-                  for(i=0; i<n; i++)
-                        printf("%d\t", SA[i]);
-                  printf("\n\n");
-                  for(i=0; i<n; i++)
-                        printf("%d\t", LCP[i]);
-                  printf("\n");
-                }
-                #endif
-
-#if TIME
-                end = timer::now();
-                cout << "induce L: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-                begin = timer::now();
-#endif
-
-                if (level)
-                    induceSAs(SA, s, cnt, bkt, n, K, cs, level);
-                else{
-                    //induceSAs(SA, (int_t *)str, cnt, bkt, n, K,
-                    //          sizeof(char), level);
-                    induceSAs_LCP(SA, LCP, (int_t *)str, cnt, bkt, n, K,
-                              sizeof(unsigned char), level);
-                    SA[0]=n-1;
-                }
-
-                #if DEGUB
-                if(level==0){
-                  for(i=0; i<n; i++)
-                        printf("%d\t", SA[i]);
-                  printf("\n\n");
-                  for(i=0; i<n; i++)
-                        printf("%d\t", LCP[i]);
-                  printf("\n");
-                }
-                #endif
-#if TIME
-                end = timer::now();
-                cout << "induce S: "
-                     << (double)duration_cast<seconds>(end - begin).count()
-                     << " seconds" << endl;
-#endif
-
-#if DEGUB
-                cout << "SA: ";
-                for (uint_t i = 0; i < n; i++) {
-                    cout << SA[i] << ", ";
-                }
-                cout << endl;
-#endif
-                delete[] bkt;
-                delete[] cnt;
+    void build_position_index(bool plain_lengths) override {
+        build_level_index(plain_lengths);
+    }
 
-#if TIME
-                auto stop = timer::now();
-                cout << "time: "
-                     << (double)duration_cast<seconds>(stop - start).count()
-                     << " seconds" << endl;
-#endif
-            }
-        } else {
-            str = new unsigned char[reduced_string.size()];
-            for (uint64_t i = 0; i < reduced_string.size(); i++)
-                str[i] = reduced_string[i];
-        }
+    void build_fingerprints(uint64_t seed = FINGERPRINT_SEED) override {
+        build_rule_fingerprints(seed);
+    }
 
-        *sa = SA;
-        *lcp = LCP;
-        return str;
-    }//end decode_saca
+  protected:
+    uint64_t prefix_fingerprint(uint64_t p, extract_context &ctx) override {
+        return grammar_prefix_fingerprint(p, ctx.buckets);
+    }
 
   private:
-    std::vector<uint32_t> partial_sum;
+    gcis_partial_sum partial_sum;
 
   private:
     void gc_is(int_t *s, uint_t *SA, int_t n, int_t K, int cs,
                int level) override {
+        GC_IS_DISPATCH(s, SA, n, K, cs, level);
+    }
+
+    template <class text_t>
+    void gc_is_level(text_t s, uint_t *SA, int_t n, int_t K,
+                     int level) {
 
         int_t i, j;
 
@@ -717,7 +193,7 @@ class gcis_dictionary<gcis_eliasfano_codec>
         size_t first = n - 1;
 
         // sort all the S-substrings
-        get_buckets(s, bkt, n, K, cs, true); // find ends of buckets
+        get_buckets(s, bkt, n, K, true); // find ends of buckets
 
         for (i = 0; i < n; i++) {
             SA[i] = EMPTY;
@@ -733,10 +209,10 @@ class gcis_dictionary<gcis_eliasfano_codec>
         SA[0] = n - 1; // set the single sentinel LMS-substring
 
         // Induce L-Type suffixes by using LMS-Type and L-Type suffixes
-        induceSAl(t, SA, s, bkt, n, K, cs, level);
+        induceSAl(t, SA, s, bkt, n, K, level);
 
         // Induce S-Type suffixes by using L-Type and S-Type suffixes
-        induceSAs(t, SA, s, bkt, n, K, cs, level);
+        induceSAs(t, SA, s, bkt, n, K, level);
 
         delete[] bkt;
 
@@ -752,107 +228,53 @@ class gcis_dictionary<gcis_eliasfano_codec>
 
         // Init the name array buffer
         // SA[0,n1-1] = LMS starting positions
-        // SA[n1,n-1] = Name for each LMS substring
+        // SA[n1,n-1] = Name for each LMS substring (its length until named)
         for (i = n1; i < n; i++) {
             SA[i] = EMPTY;
         }
+        store_lms_lengths(t, SA, n, n1);
 
         // find the lexicographic names of all LMS-substrings by comparing the
         // consecutive ones
         int_t name = -1;
         int_t prev = -1;
+        int_t prev_len = 0;
 
+        uint64_t n_rules = count_rules(s, SA, n, n1, false);
         std::vector<uint64_t> fdrlen;
+        fdrlen.reserve(n_rules);
 
-        uint_t rule_index = 0;
-        sdsl::bit_vector lcp;
-        sdsl::bit_vector rule_delim;
+        gcis_rule_builder rules;
+        rules.reserve(n_rules);
         g.push_back(gcis_eliasfano_codec());
         // Iterate over all suffixes in the LMS sorted array
         for (i = 0; i < n1; i++) {
             int_t pos = SA[i];
-            bool diff = false;
-            int_t d;
+            // Length of the LMS-substring, replaced by its name below
+            int_t len = SA[n1 + pos / 2];
+            bool diff = true;
             // d equals to the LCP between two consecutive LMS-substrings
-            for (d = 0; d < n; d++) {
-                // If is first suffix in LMS order (sentinel), or one of the
-                // suffixes reached the last position of T, or the
-                // characters of T differs or the type os suffixes differ.
-                if (prev == -1 ||
-                    (chr(pos + d) != chr(prev + d) &&
-                     (d == 0 || (!isLMS(pos + d) && !isLMS(prev + d)))) ||
-                    (isLMS(pos + d) ^ (isLMS(prev + d)))) {
-                    diff = true;
-                    break;
-                }
-                // The comparison has reached the end of at least one
-                // LMS-substring
-                if (d > 0 && (isLMS(pos + d) || isLMS(prev + d))) {
-                    break;
-                }
+            int_t d = 0;
+            if (prev != -1) {
+                diff = lms_substrings_differ(s, pos, len, prev, prev_len, n,
+                                             false, d);
             }
 
             // The consecutive LMS-substrings differs
             if (diff) {
-
-                // TODO: can we replace len =1 for len	=d?
-                // Get the length of the current lms-substring
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
-
-                // Get the length of the previous LMS-Substring
-                size_t len2 = 1;
-                if (prev != n - 1)
-                    while (!isLMS(prev + len2))
-                        len2++;
-
-                // Resizes Rule array, LCP array and rule delimiter bitvector
-                uint64_t old_lcp_size, old_rule_delim_size;
-
-                old_lcp_size = lcp.size();
-                old_rule_delim_size = rule_delim.size();
-
-                // Put a limit on how far Front Coding goes back
-                // TODO: change magic number
-                if (name % 32 == 0) {
-                    d = 0;
-                }
-
-                g[level].rule.resize(g[level].rule.size() + len - d);
-                lcp.resize(lcp.size() + d + 1);
-                rule_delim.resize(rule_delim.size() + len - d + 1);
-
-                for (uint64_t i = old_lcp_size; i < lcp.size(); i++) {
-                    lcp[i] = 0;
-                }
-                for (uint64_t i = old_rule_delim_size; i < rule_delim.size();
-                     i++) {
-                    rule_delim[i] = 0;
-                }
+                // The rule suffix T[pos+d,pos+len-1] is copied after the
+                // naming, when the sizes of all structures are known
+                rules.add(pos, d, len);
 
 #ifdef REPORT
                 total_rule_len += len;
-                total_lcp += d;
-                total_rule_suffix_length += len - d;
-#endif
-
-                // Encode LCP value in unary
-                lcp[lcp.size() - 1] = 1;
-                // Encode rule length in unary
-                rule_delim[rule_delim.size() - 1] = 1;
-                // Copy the symbols into the delimited rule positions
                 for (j = 0; j < len - d && j + pos + d < n; j++) {
-#ifdef REPORT
                     if (j + pos + d - 1 < n &&
                         chr(j + pos + d) == chr(j + pos + d + 1)) {
                         run_length_potential++;
                     }
-#endif
-                    g[level].rule[rule_index] = (uint_t)chr(j + pos + d);
-                    rule_index++;
                 }
+#endif
                 // Insert the fully decode rule length
                 if (level == 0) {
                     // The symbols are terminal L(x) = 1, for every x
@@ -861,7 +283,7 @@ class gcis_dictionary<gcis_eliasfano_codec>
                     // The symbols are not necessarly terminal.
                     uint64_t sum =
                         g[level - 1].fully_decoded_rule_len[chr(pos)];
-                    for (uint64_t i = 1; i + pos < n && !isLMS(pos + i); i++) {
+                    for (int_t i = 1; i < len; i++) {
                         sum +=
                             g[level - 1].fully_decoded_rule_len[chr(pos + i)];
                     }
@@ -869,13 +291,10 @@ class gcis_dictionary<gcis_eliasfano_codec>
                 }
                 name++;
                 prev = pos;
+                prev_len = len;
             }
 #ifdef REPORT
             else {
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
                 discarded_rules_len += len;
                 discarded_rules_n++;
             }
@@ -884,14 +303,30 @@ class gcis_dictionary<gcis_eliasfano_codec>
             SA[n1 + pos] = name;
         }
 
-        sdsl::util::bit_compress(g[level].rule);
-        g[level].lcp.encode(lcp);
-        g[level].rule_suffix_length.encode(rule_delim);
+        // Put a limit on how far Front Coding goes back
+        uint64_t bucket = front_coding_bucket
+                              ? front_coding_bucket
+                              : rules.choose_bucket(front_coding_max_walk);
+        rules.restart_front_coding(bucket);
+        g[level].front_coding_bucket = bucket;
+#ifdef REPORT
+        total_lcp = rules.total_lcp();
+        total_rule_suffix_length = rules.total_suffix_length();
+#endif
+
+        // Encode the rules, with LCP and rule lengths in unary
+        rules.build_rules(g[level].rule, sdsl::bits::hi(K) + 1,
+                          [&](uint64_t i) { return stored_symbol(s, i, level); });
+        {
+            sdsl::bit_vector lcp, rule_delim;
+            rules.build_unary_lcp(lcp);
+            g[level].lcp.encode(lcp);
+            rules.build_unary_suffix_length(rule_delim);
+            g[level].rule_suffix_length.encode(rule_delim);
+        }
+        rules.clear();
         g[level].fully_decoded_rule_len = sdsl::dac_vector_dp<>(fdrlen);
 
-        sdsl::util::clear(lcp);
-        sdsl::util::clear(rule_delim);
-
         for (i = n - 1, j = n - 1; i >= n1; i--) {
             if (SA[i] != EMPTY) {
                 SA[j--] = SA[i];
@@ -904,8 +339,7 @@ class gcis_dictionary<gcis_eliasfano_codec>
         // Copy the first elements (not part of a LMS substring)
         g[level].tail.resize(first);
         for (j = 0; j < first; j++) {
-            g[level].tail[j] =
-                (uint64_t)(cs == sizeof(char) ? ((char *)s)[j] : s[j]);
+            g[level].tail[j] = stored_symbol(s, j, level);
         }
         // Compress the tail
         sdsl::util::bit_compress(g[level].tail);
@@ -935,6 +369,7 @@ class gcis_dictionary<gcis_eliasfano_codec>
         print_report("Average Discarded Rules Length = ",
                      (double)discarded_rules_len / discarded_rules_n, "\n");
         print_report("Average LCP = ", (double)total_lcp / (name + 1), "\n");
+        print_report("Front Coding Bucket = ", bucket, "\n");
         print_report("Average Rule Suffix Length = ",
                      (double)total_rule_suffix_length / (name + 1), "\n");
         print_report(
@@ -960,7 +395,8 @@ class gcis_dictionary<gcis_eliasfano_codec>
         g[level].string_size = n;
         g[level].alphabet_size = K;
         if (name + 1 < n1 && !premature_stop) {
-            gc_is((int_t *)s1, SA1, n1, name + 1, sizeof(int_t), level + 1);
+            gc_is((int_t *)s1, SA1, n1, name + 1,
+                  narrow_reduced_string(s1, n1, name + 1), level + 1);
         } else {
             // generate the suffix array of s1 directly
             if (premature_stop) {
@@ -971,8 +407,7 @@ class gcis_dictionary<gcis_eliasfano_codec>
                 reduced_string.resize(n);
                 for (j = 0; j < n; j++) {
                     // Copy the reduced substring
-                    reduced_string[j] =
-                        (uint64_t)(cs == sizeof(char) ? ((char *)s)[j] : s[j]);
+                    reduced_string[j] = stored_symbol(s, j, level);
                 }
                 // The last level of computation is discarded
                 g.pop_back();
@@ -984,14 +419,8 @@ class gcis_dictionary<gcis_eliasfano_codec>
                 }
             }
             sdsl::util::bit_compress(reduced_string);
-            partial_sum.resize(reduced_string.size());
-            partial_sum[0] = 0;
-            for (uint64_t i = 1; i < reduced_string.size(); i++) {
-                partial_sum[i] =
-                    partial_sum[i - 1] +
-                    g.back().fully_decoded_rule_len[reduced_string[i - 1]];
-                // cout << "Partial sum = " << partial_sum[i] << "\n";
-            }
+            partial_sum.build(reduced_string.size(),
+                              [&](uint64_t i) { return expanded_length(i); });
 
 #ifdef REPORT
             print_report(
@@ -1004,112 +433,30 @@ class gcis_dictionary<gcis_eliasfano_codec>
     }
 
     /**
-     *
-     * @param partial_sum The partial sum data-structure
-     * @param sz the position we want to find
-     * @return the leftmost index rk such that partial_sum[rk]>=sz
+     * @brief Finds the symbol of the reduced string whose expansion covers
+     * position x of the text that follows the tail of the last level.
+     * @param sum receives the position where the expansion of the symbol
+     * starts
      */
-    uint64_t bsearch_upperbound(vector<uint32_t> &partial_sum, uint64_t sz) {
-        if (partial_sum.back() <= sz) {
-            return partial_sum.size() - 1;
-        }
-        int64_t l = 0, r = partial_sum.size() - 1;
-        while (l < r) {
-            int64_t mid = l + (r - l) / 2;
-            if (partial_sum[mid] +
-                    g.back().fully_decoded_rule_len[reduced_string[mid]] >
-                sz) {
-                r = mid;
-            } else {
-                l = mid + 1;
-            }
-        }
-        return l;
+    uint64_t find_symbol(uint64_t x, uint64_t &sum) {
+        return partial_sum.find(
+            x, [&](uint64_t i) { return expanded_length(i); }, sum);
     }
 
-    /**
-     *
-     * @param partial_sum The partial sum data-structure
-     * @param sz the position we want to find
-     * @return the rightmost index lk such that partial_sum[lk]<=sz
-     */
-    uint64_t bsearch_lowerbound(vector<uint32_t> &partial_sum, uint64_t sz) {
-        if (partial_sum[0] >= sz) {
-            return 0;
-        }
-        int64_t l = 0, r = partial_sum.size() - 1;
-        while (l < r) {
-            int64_t mid = l + (r - l + 1) / 2;
-            if (partial_sum[mid] <= sz) {
-                l = mid;
-            } else {
-                r = mid - 1;
-            }
-        }
-        return l;
-    }
-
-    /**
-     *
-     * @param codec The dictionary level we are employing
-     * @param extracted_text The string to be extracted
-     * @param sz The index we want to find
-     * @param text_r The tracked position of the original text representing the
-     * end of extracted_text
-     * @return The leftmost index such that text_l r sum(extracted_text,i) <= sz
-     */
-    uint64_t sequential_upperbound(gcis_eliasfano_codec &codec,
-                                   sdsl::int_vector<> &extracted_text,
-                                   int64_t extracted_text_size, int64_t sz,
-                                   int64_t &text_r) {
-        int64_t index = 0;
-        int64_t rule_length = 0;
-        for (index = extracted_text_size - 1; index >= 0; index--) {
-            rule_length = codec.fully_decoded_rule_len[extracted_text[index]];
-            if (text_r - rule_length <= sz) {
-                break;
-            }
-            text_r -= rule_length;
-        }
-        return index;
-    }
-
-    /**
-     *
-     * @param codec The dictionary level we are employing
-     * @param extracted_text The string to be extracted
-     * @param sz The index we want to found
-     * @param text_l The tracked position of the original text representing the
-     * beggining of extracted_text
-     * @return The rightmost index such that text_l + sum(extracted_text,i) >
-     * sz
-     */
-    uint64_t sequential_lowerbound(gcis_eliasfano_codec &codec,
-                                   sdsl::int_vector<> &extracted_text,
-                                   int64_t extracted_text_size, int64_t sz,
-                                   int64_t &text_l) {
-        int64_t index = 0;
-        int64_t rule_length = 0;
-        for (index = 0; index < extracted_text_size; index++) {
-            rule_length = codec.fully_decoded_rule_len[extracted_text[index]];
-            if (text_l + rule_length > sz) {
-                break;
-            }
-            text_l += rule_length;
-        }
-        return index;
-    }
-        
-    
     void extract(int64_t l, int64_t r, sdsl::int_vector<> &extracted_text,
-                 sdsl::int_vector<> &tmp_text) {
+                 sdsl::int_vector<> &tmp_text,
+                 gcis_bucket_cache *buckets = nullptr) {
         //	  // Stores the interval being tracked in the text
         int64_t text_l;
         int64_t text_r;
         // Stores the interval being tracked in the level
-        uint64_t lk, rk;
+        uint64_t lk, rk, sum;
+        // Rules of the level above whose expansions start and end the
+        // extracted symbols, the last one starting at last_pos
+        uint64_t first_rule = unknown_rule, last_rule = unknown_rule;
+        uint64_t last_pos = 0;
         text_l = 0;
-        text_r = g.size() > 0 ? g[0].string_size : reduced_string.size();
+        text_r = g.size() > 0 ? (uint64_t)g[0].string_size : reduced_string.size();
         uint64_t extracted_idx = 0;
 
         /**
@@ -1117,8 +464,8 @@ class gcis_dictionary<gcis_eliasfano_codec>
          * The extraction is done in a straight-foward fashion
          */
         if (g.size() == 0) {
-            for (uint64_t j = 0; j < reduced_string.size(); j++) {
-                extracted_text[j] = reduced_string[j];
+            for (int64_t j = l; j <= r; j++) {
+                extracted_text[j - l] = reduced_string[j];
             }
             return;
         }
@@ -1127,6 +474,7 @@ class gcis_dictionary<gcis_eliasfano_codec>
          * Else, the extraction should proceed from the reduced string to the
          * decompressed text
          */
+        std::vector<std::shared_ptr<gcis_eliasfano_codec_level>> cached = cached_levels();
 
         if (r < g.back().fully_decoded_tail_len) {
             // The string lies on the tail. Copy all the tail.
@@ -1143,31 +491,33 @@ class gcis_dictionary<gcis_eliasfano_codec>
                 tmp_text[extracted_idx++] = v;
             }
             // Find the leftmost index which covers r
-            rk = bsearch_upperbound(partial_sum,
-                                    r - g.back().fully_decoded_tail_len);
-            text_r = g.back().fully_decoded_tail_len + partial_sum[rk] +
-                     g.back().fully_decoded_rule_len[reduced_string[rk]];
+            rk = find_symbol(r - g.back().fully_decoded_tail_len, sum);
+            text_r =
+                g.back().fully_decoded_tail_len + sum + expanded_length(rk);
             // Decompress the rules located at reduced_string[0..rk];
             for (uint64_t i = 0; i <= rk; i++) {
-                g.back().extract_rule(reduced_string[i], tmp_text,
-                                      extracted_idx);
+                last_pos = extracted_idx;
+                extract_rule(cached, buckets, g.size() - 1,
+                             reduced_string[i], tmp_text, extracted_idx);
             }
+            last_rule = reduced_string[rk];
         } else {
             // The string does not occur in the tail
             // Find the rightmost index which covers l
-            lk = bsearch_lowerbound(partial_sum,
-                                    l - g.back().fully_decoded_tail_len);
-            text_l = g.back().fully_decoded_tail_len + partial_sum[lk];
+            lk = find_symbol(l - g.back().fully_decoded_tail_len, sum);
+            text_l = g.back().fully_decoded_tail_len + sum;
             // Find the leftmost index which covers r
-            rk = bsearch_upperbound(partial_sum,
-                                    r - g.back().fully_decoded_tail_len);
-            text_r = g.back().fully_decoded_tail_len + partial_sum[rk] +
-                     g.back().fully_decoded_rule_len[reduced_string[rk]];
+            rk = find_symbol(r - g.back().fully_decoded_tail_len, sum);
+            text_r =
+                g.back().fully_decoded_tail_len + sum + expanded_length(rk);
             // Decompress the rules located at reduced_string[0..rk];
             for (uint64_t i = lk; i <= rk; i++) {
-                g.back().extract_rule(reduced_string[i], tmp_text,
-                                      extracted_idx);
+                last_pos = extracted_idx;
+                extract_rule(cached, buckets, g.size() - 1,
+                             reduced_string[i], tmp_text, extracted_idx);
             }
+            first_rule = reduced_string[lk];
+            last_rule = reduced_string[rk];
         }
         int64_t level = g.size() - 2;
         // Extract the reduced string part
@@ -1183,6 +533,7 @@ class gcis_dictionary<gcis_eliasfano_codec>
                 for (auto v : g[level].tail) {
                     tmp_text[extracted_idx++] = v;
                 }
+                first_rule = last_rule = unknown_rule;
             } else if (l < g[level].fully_decoded_tail_len) {
                 // A prefix of the string lies on the tail
                 text_l = 0;
@@ -1190,23 +541,29 @@ class gcis_dictionary<gcis_eliasfano_codec>
                 for (auto v : g[level].tail) {
                     tmp_text[extracted_idx++] = v;
                 }
-                rk = sequential_upperbound(g[level], extracted_text,
-                                           extracted_text_len, r, text_r);
+                rk = indexed_upperbound(level, extracted_text, last_rule,
+                                        last_pos, extracted_text_len, r, text_r);
                 for (uint64_t i = 0; i <= rk; i++) {
-                    g[level].extract_rule(extracted_text[i], tmp_text,
-                                          extracted_idx);
+                    last_pos = extracted_idx;
+                    extract_rule(cached, buckets, level, extracted_text[i],
+                                 tmp_text, extracted_idx);
                 }
+                first_rule = unknown_rule;
+                last_rule = extracted_text[rk];
             } else {
                 text_l =
                     std::max<int64_t>(text_l, g[level].fully_decoded_tail_len);
-                lk = sequential_lowerbound(g[level], extracted_text,
-                                           extracted_text_len, l, text_l);
-                rk = sequential_upperbound(g[level], extracted_text,
-                                           extracted_text_len, r, text_r);
+                lk = indexed_lowerbound(level, extracted_text, first_rule, 0,
+                                        extracted_text_len, l, text_l);
+                rk = indexed_upperbound(level, extracted_text, last_rule,
+                                        last_pos, extracted_text_len, r, text_r);
                 for (uint64_t i = lk; i <= rk; i++) {
-                    g[level].extract_rule(extracted_text[i], tmp_text,
-                                          extracted_idx);
+                    last_pos = extracted_idx;
+                    extract_rule(cached, buckets, level, extracted_text[i],
+                                 tmp_text, extracted_idx);
                 }
+                first_rule = extracted_text[lk];
+                last_rule = extracted_text[rk];
             }
             level--;
         }
@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include "eliasfano.hpp"
+#include "gcis_rule_bucket.hpp"
 #include "sdsl/int_vector.hpp"
 #include "sdsl/bit_vectors.hpp"
 #include "sdsl/dac_vector.hpp"
@@ -21,6 +22,12 @@ public:
     eliasfano_codec rule_delim;
 
 public:
+    uint64_t size_in_bytes();
+
+    // Position of rule rule_num in rule and its length
+    uint64_t rule_start(uint64_t rule_num);
+    uint64_t rule_length(uint64_t rule_num);
+
     void expand_rule(uint64_t rule_num, sdsl::int_vector<> &r_string, uint64_t &l);
     void expand_rule(uint64_t rule_num, char* s, uint64_t &l);
 
@@ -54,6 +61,9 @@ public:
     sdsl::dac_vector_dp<> fully_decoded_rule_len;
     // A integer storing the fully decoded tail length
     uint64_t fully_decoded_tail_len;
+    // Rules per front-coding bucket, stored by the dictionary (see
+    // gcis_header)
+    uint64_t front_coding_bucket = FRONT_CODING_BUCKET;
 
 public:
     uint64_t get_lcp(uint64_t i);
@@ -77,6 +87,9 @@ public:
     void extract_rule_suffix(uint64_t rule_num,sdsl::int_vector<>& extracted_text,uint64_t& k);
     void extract_rule(uint64_t rule_num,sdsl::int_vector<>& extracted_text,uint64_t& k);
 
+    // Expands the rules of the bucket starting at rule b.first that are not
+    // in b yet into b, up to rule end-1 or the end of the bucket
+    void decode_bucket(gcis_rule_bucket& b, uint64_t end);
 
 
     void serialize(std::ostream& o);
@@ -18,6 +18,7 @@ public:
     eliasfano_codec rule_delim;
 
 public:
+    uint64_t size_in_bytes();
     void expand_rule(uint64_t rule_num, sdsl::int_vector<> &r_string, uint64_t &l);
     void expand_rule(uint64_t rule_num, char* s, uint64_t &l);
 };
@@ -8,6 +8,7 @@
 #include <iostream>
 #include "gcis.hpp"
 #include "gcis_eliasfano_codec_no_lcp.hpp"
+#include "gcis_partial_sum.hpp"
 
 
 template<>
@@ -19,17 +20,30 @@ public:
 
     void serialize(std::ostream& o) override {
         gcis_abstract::serialize(o);
-        uint32_t n = partial_sum.size();
-        o.write((char*)&n,sizeof(n));
-        o.write((char*)partial_sum.data(),sizeof(uint32_t) * n);
+        partial_sum.serialize(o);
     }
 
     void load(std::istream& i) override {
         gcis_abstract::load(i);
-        uint32_t n;
-        i.read((char*)&n,sizeof(n));
-        partial_sum.resize(n);
-        i.read((char*)partial_sum.data(),sizeof(uint32_t) * n);
+        if(header.version == 0){
+            // legacy files store a 32-bit size and 32-bit partial sums
+            uint32_t n;
+            i.read((char*)&n,sizeof(n));
+            std::vector<uint32_t> legacy(n);
+            i.read((char*)legacy.data(),sizeof(uint32_t) * n);
+            partial_sum.build(legacy);
+        }
+        else if(header.version == 1){
+            // version 1 files store every 64-bit partial sum
+            uint64_t n;
+            i.read((char*)&n,sizeof(n));
+            std::vector<uint64_t> legacy(n);
+            i.read((char*)legacy.data(),sizeof(uint64_t) * n);
+            partial_sum.build(legacy);
+        }
+        else{
+            partial_sum.load(i);
+        }
     }
 
 
@@ -47,6 +61,20 @@ public:
         return extracted_text;
     }
 
+    using gcis_abstract::extract;
+
+    void extract(uint64_t l,uint64_t r,unsigned char* out,extract_context& ctx) override {
+        uint64_t size = g.size() ? 2* (g.back().fully_decoded_tail_len + (r-l+1)) : (r-l+1);
+        if(ctx.text.size() < size){
+            ctx.text.resize(size);
+            ctx.tmp.resize(size);
+        }
+        extract(l,r,ctx.text,ctx.tmp);
+        for(uint64_t i=0;i<=r-l;i++){
+            out[i] = ctx.text[i];
+        }
+    }
+
 
     char* decode() override {
         sdsl::int_vector<> r_string = reduced_string;
@@ -90,18 +118,20 @@ public:
 
 
 private:
-    std::vector<uint32_t> partial_sum;
+    gcis_partial_sum partial_sum;
 
 private:
 
 
 
-    void gc_is(int_t *s,
-               uint_t *SA,
-               int_t n,
-               int_t K,
-               int cs,
+    void gc_is(int_t *s, uint_t *SA, int_t n, int_t K, int cs,
                int level) override {
+        GC_IS_DISPATCH(s, SA, n, K, cs, level);
+    }
+
+    template <class text_t>
+    void gc_is_level(text_t s, uint_t *SA, int_t n, int_t K,
+                     int level) {
         int_t i, j;
 
 #       ifdef MEM_MONITOR
@@ -130,7 +160,7 @@ private:
         size_t first = n - 1;
 
         // sort all the S-substrings
-        get_buckets(s, bkt, n, K, cs, true); // find ends of buckets
+        get_buckets(s, bkt, n, K, true); // find ends of buckets
 
         for (i = 0; i < n; i++) {
             SA[i] = EMPTY;
@@ -146,10 +176,10 @@ private:
         SA[0] = n - 1; // set the single sentinel LMS-substring
 
         //Induce L-Type suffixes by using LMS-Type and L-Type suffixes
-        induceSAl(t, SA, s, bkt, n, K, cs, level);
+        induceSAl(t, SA, s, bkt, n, K, level);
 
         //Induce S-Type suffixes by using L-Type and S-Type suffixes
-        induceSAs(t, SA, s, bkt, n, K, cs, level);
+        induceSAs(t, SA, s, bkt, n, K, level);
 
         delete[] bkt;
 
@@ -165,14 +195,16 @@ private:
 
         // Init the name array buffer
         // SA[0,n1-1] = LMS starting positions
-        // SA[n1,n-1] = Name for each LMS substring
+        // SA[n1,n-1] = Name for each LMS substring (its length until named)
         for (i = n1; i < n; i++) {
             SA[i] = EMPTY;
         }
+        store_lms_lengths(t, SA, n, n1);
 
         // find the lexicographic names of all LMS-substrings by comparing the consecutive ones
         int_t name = -1;
         int_t prev = -1;
+        int_t prev_len = 0;
 
         std::vector<uint64_t> fdrlen;
 
@@ -182,39 +214,19 @@ private:
         //Iterate over all suffixes in the LMS sorted array
         for (i = 0; i < n1; i++) {
             int_t pos = SA[i];
-            bool diff = false;
-            int_t d;
+            // Length of the LMS-substring, replaced by its name below
+            int_t len = SA[n1 + pos / 2];
+            bool diff = true;
             // d equals to the LCP between two consecutive LMS-substrings
-            for (d = 0; d < n; d++) {
-                //If is first suffix in LMS order (sentinel), or one of the suffixes reached the last position of T, or the
-                // characters of T differs or the type os suffixes differ.
-                if (prev == -1 ||  (chr(pos + d) != chr(prev + d) && (d==0 ||(!isLMS(pos+d)  && !isLMS(prev+d)) ))
-                    || ( isLMS(pos+d) ^ (isLMS(prev+d))) )  {
-                    diff = true;
-                    break;
-                }
-                //The comparison has reached the end of at least one LMS-substring
-                if (d > 0 && (isLMS(pos + d) || isLMS(prev + d))) {
-                    break;
-                }
+            int_t d = 0;
+            if (prev != -1) {
+                diff = lms_substrings_differ(s, pos, len, prev, prev_len, n,
+                                             false, d);
             }
 
             // The consecutive LMS-substrings differs
             if (diff) {
 
-                // TODO: can we replace len =1 for len  =d?
-                // Get the length of the current lms-substring
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
-
-                // Get the length of the previous LMS-Substring
-                size_t len2 = 1;
-                if (prev != n - 1)
-                    while (!isLMS(prev + len2))
-                        len2++;
-
                 // Resizes Rule array, LCP array and rule delimiter bitvector
                 uint64_t old_rule_delim_size;
 
@@ -241,7 +253,7 @@ private:
                         run_length_potential++;
                     }
 #endif
-                    g[level].rule[rule_index] = (uint_t) chr(j + pos);
+                    g[level].rule[rule_index] = stored_symbol(s, j + pos, level);
                     rule_index++;
                 }
                 // Insert the fully decode rule length
@@ -252,20 +264,17 @@ private:
                 else{
                     // The symbols are not necessarily terminal.            
                     uint64_t sum = g[level-1].fully_decoded_rule_len[chr(pos)];
-                    for(uint64_t i=1;  i+pos < n && !isLMS(pos+i);i++){
+                    for(int_t i=1; i < len; i++){
                         sum+=g[level-1].fully_decoded_rule_len[chr(pos+i)];
                     }
                     fdrlen.push_back(sum);
                 }
                 name++;
                 prev = pos;
+                prev_len = len;
             }
 #ifdef REPORT
             else{
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
                 discarded_rules_len+=len;
                 discarded_rules_n++;
             }
@@ -293,8 +302,7 @@ private:
         // Copy the first elements (not part of a LMS substring)
         g[level].tail.resize(first);
         for (j = 0; j < first; j++) {
-            g[level].tail[j] = (uint64_t) (cs == sizeof(char) ? ((char*)s)[j] :
-                                           s[j]);
+            g[level].tail[j] = stored_symbol(s, j, level);
         }
         // Compress the tail
         sdsl::util::bit_compress(g[level].tail);
@@ -337,7 +345,8 @@ private:
         g[level].string_size = n;
         g[level].alphabet_size = K;
         if (name+1 < n1 && !premature_stop) {
-            gc_is((int_t *) s1, SA1, n1, name+1, sizeof(int_t), level + 1);
+            gc_is((int_t *)s1, SA1, n1, name + 1,
+                  narrow_reduced_string(s1, n1, name + 1), level + 1);
         }
         else {
             // generate the suffix array of s1 directly
@@ -349,8 +358,7 @@ private:
                 reduced_string.resize(n);
                 for (j = 0; j < n; j++) {
                     // Copy the reduced substring
-                    reduced_string[j] = (uint64_t) (cs == sizeof(char) ? ((char*)s)[j] :
-                                                    s[j]);
+                    reduced_string[j] = stored_symbol(s, j, level);
                 }
                 // The last level of computation is discarded
                 g.pop_back();
@@ -363,12 +371,8 @@ private:
                 }
             }
             sdsl::util::bit_compress(reduced_string);
-            partial_sum.resize(reduced_string.size());
-            partial_sum[0] = 0;
-            for(uint64_t i = 1;i<reduced_string.size();i++){
-                partial_sum[i] = partial_sum[i-1] + g.back().fully_decoded_rule_len[reduced_string[i-1]];
-                // cout << "Partial sum = " << partial_sum[i] << "\n";
-            }
+            partial_sum.build(reduced_string.size(),
+                              [&](uint64_t i) { return expanded_length(i); });
 
 #ifdef REPORT
             print_report("Reduced String Length = ",(int_t) reduced_string.size(),"\n");
@@ -381,49 +385,14 @@ private:
 
 
     /**
-     *
-     * @param partial_sum The partial sum data-structure
-     * @param sz the position we want to find
-     * @return the leftmost index rk such that partial_sum[rk]>=sz
-     */
-    uint64_t bsearch_upperbound(vector<uint32_t>& partial_sum, uint64_t sz) {
-        if(partial_sum.back()<=sz){
-            return partial_sum.size()-1;
-        }
-        int64_t l=0,r=partial_sum.size()-1;
-        while(l<r){
-            int64_t mid = l+ (r-l)/2;
-            if(partial_sum[mid] + g.back().fully_decoded_rule_len[reduced_string[mid]] > sz){
-                r = mid;
-            }
-            else{
-                l = mid+1;
-            }
-        }
-        return l;
-    }
-
-    /**
-     *
-     * @param partial_sum The partial sum data-structure
-     * @param sz the position we want to find
-     * @return the rightmost index lk such that partial_sum[lk]<=sz
+     * @brief Finds the symbol of the reduced string whose expansion covers
+     * position x of the text that follows the tail of the last level.
+     * @param sum receives the position where the expansion of the symbol
+     * starts
      */
-    uint64_t bsearch_lowerbound(vector<uint32_t>& partial_sum, uint64_t sz) {
-        if(partial_sum[0] >= sz){
-            return 0;
-        }
-        int64_t l=0,r=partial_sum.size()-1;
-        while(l<r){
-            int64_t mid = l+ (r-l+1)/2;
-            if(partial_sum[mid] <= sz){
-                l = mid;
-            }
-            else{
-                r = mid-1;
-            }
-        }
-        return l;
+    uint64_t find_symbol(uint64_t x, uint64_t &sum) {
+        return partial_sum.find(
+            x, [&](uint64_t i) { return expanded_length(i); }, sum);
     }
 
     /**
@@ -479,9 +448,9 @@ private:
         int64_t text_l;
         int64_t text_r;
         // Stores the interval being tracked in the level
-        uint64_t lk,rk;
+        uint64_t lk,rk,sum;
         text_l= 0;
-        text_r = g.size()>0 ? g[0].string_size : reduced_string.size();
+        text_r = g.size()>0 ? (uint64_t)g[0].string_size : reduced_string.size();
         uint64_t extracted_idx = 0;
 
         /**
@@ -489,8 +458,8 @@ private:
          * The extraction is done in a straight-foward fashion
          */
         if(g.size()==0){
-            for(uint64_t j=0;j<reduced_string.size();j++){
-                extracted_text[j] = reduced_string[j];
+            for(int64_t j=l;j<=r;j++){
+                extracted_text[j-l] = reduced_string[j];
             }
             return;
         }
@@ -516,8 +485,8 @@ private:
                 tmp_text[extracted_idx++] = v;
             }
             // Find the leftmost index which covers r
-            rk = bsearch_upperbound(partial_sum,r-g.back().fully_decoded_tail_len);
-            text_r = g.back().fully_decoded_tail_len + partial_sum[rk] + g.back().fully_decoded_rule_len[reduced_string[rk]];
+            rk = find_symbol(r-g.back().fully_decoded_tail_len,sum);
+            text_r = g.back().fully_decoded_tail_len + sum + g.back().fully_decoded_rule_len[reduced_string[rk]];
             // Decompress the rules located at reduced_string[0..rk];
             for(uint64_t i=0;i<=rk;i++){
                 g.back().extract_rule(reduced_string[i],tmp_text,extracted_idx);
@@ -526,11 +495,11 @@ private:
         else{
             // The string does not occur in the tail
             // Find the rightmost index which covers l
-            lk = bsearch_lowerbound(partial_sum,l-g.back().fully_decoded_tail_len);
-            text_l = g.back().fully_decoded_tail_len + partial_sum[lk];
+            lk = find_symbol(l-g.back().fully_decoded_tail_len,sum);
+            text_l = g.back().fully_decoded_tail_len + sum;
             // Find the leftmost index which covers r
-            rk = bsearch_upperbound(partial_sum,r-g.back().fully_decoded_tail_len);
-            text_r = g.back().fully_decoded_tail_len + partial_sum[rk] + g.back().fully_decoded_rule_len[reduced_string[rk]];
+            rk = find_symbol(r-g.back().fully_decoded_tail_len,sum);
+            text_r = g.back().fully_decoded_tail_len + sum + g.back().fully_decoded_rule_len[reduced_string[rk]];
             // Decompress the rules located at reduced_string[0..rk];
             for(uint64_t i=lk;i<=rk;i++){
                 g.back().extract_rule(reduced_string[i],tmp_text,extracted_idx);
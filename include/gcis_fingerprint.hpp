@@ -0,0 +1,136 @@
+//
+// Karp-Rabin fingerprints of the rules of a grammar.
+//
+
+#ifndef GC_IS_GCIS_FINGERPRINT_HPP
+#define GC_IS_GCIS_FINGERPRINT_HPP
+
+#include "sdsl/int_vector.hpp"
+#include "util.hpp"
+#include <cstdint>
+#include <vector>
+
+#define FINGERPRINT_SAMPLE 64 // root symbols per sampled prefix fingerprint
+#define FINGERPRINT_SEED 0x5eed5eed5eed5eedULL // default seed of the base
+#define FINGERPRINT_POWER_BITS 11 // bits of the length per power table
+
+/**
+ * @brief Karp-Rabin fingerprints modulo the Mersenne prime 2^61-1. The
+ * fingerprint of s[0,n) is the sum of s[k] * base^(n-1-k), so that of a
+ * concatenation xy is fp(x) * base^|y| + fp(y). Two different strings of
+ * the same length n collide with probability at most n / 2^61 over the
+ * choice of the base.
+ */
+class gcis_karp_rabin {
+  public:
+    static const uint64_t PRIME = (1ULL << 61) - 1;
+
+    gcis_karp_rabin() = default;
+
+    // Draws the base from seed
+    explicit gcis_karp_rabin(uint64_t seed) {
+        // splitmix64
+        uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        m_base = 256 + z % (PRIME - 256);
+
+        const uint64_t digits = 64 / FINGERPRINT_POWER_BITS + 1;
+        const uint64_t radix = 1ULL << FINGERPRINT_POWER_BITS;
+        m_power.resize(digits * radix);
+        uint64_t b = m_base; // base^(radix^d)
+        for (uint64_t d = 0; d < digits; d++) {
+            uint64_t *t = &m_power[d * radix];
+            t[0] = 1;
+            for (uint64_t x = 1; x < radix; x++) {
+                t[x] = mul(t[x - 1], b);
+            }
+            b = mul(t[radix - 1], b);
+        }
+    }
+
+    uint64_t base() const { return m_base; }
+
+    // base^len
+    uint64_t power(uint64_t len) const {
+        const uint64_t radix = 1ULL << FINGERPRINT_POWER_BITS;
+        uint64_t p = 1;
+        for (uint64_t d = 0; len; d++, len >>= FINGERPRINT_POWER_BITS) {
+            uint64_t x = len & (radix - 1);
+            if (x)
+                p = mul(p, m_power[d * radix + x]);
+        }
+        return p;
+    }
+
+    // Fingerprint of xy from h = fp(x), and the length and fingerprint of y
+    uint64_t append(uint64_t h, uint64_t len, uint64_t fp) const {
+        return add(mul(h, power(len)), fp);
+    }
+
+    // Fingerprint of s[l,r) from those of the prefixes s[0,l) and s[0,r)
+    uint64_t substring(uint64_t prefix_l, uint64_t prefix_r,
+                       uint64_t len) const {
+        uint64_t h = mul(prefix_l, power(len));
+        return prefix_r >= h ? prefix_r - h : prefix_r + PRIME - h;
+    }
+
+    static uint64_t mul(uint64_t a, uint64_t b) {
+        unsigned __int128 x = (unsigned __int128)a * b;
+        uint64_t r = ((uint64_t)x & PRIME) + (uint64_t)(x >> 61);
+        return r >= PRIME ? r - PRIME : r;
+    }
+
+    static uint64_t add(uint64_t a, uint64_t b) {
+        uint64_t r = a + b;
+        return r >= PRIME ? r - PRIME : r;
+    }
+
+    uint64_t size_in_bytes() const {
+        return m_power.size() * sizeof(uint64_t);
+    }
+
+  private:
+    uint64_t m_base = 0;
+    // base^(x * radix^d) is m_power[d * radix + x], radix being
+    // 2^FINGERPRINT_POWER_BITS, so a power takes a product per digit
+    std::vector<uint64_t> m_power;
+};
+
+/**
+ * @brief Fingerprints of the expansions of the rules of every level, with
+ * samples of the fingerprints of the text before the symbols of the root
+ * of the grammar (the tails of the levels followed by the reduced
+ * string), used to compute the fingerprint of any prefix of the text.
+ *
+ * They are built from a loaded dictionary and are not stored in its file.
+ */
+struct gcis_fingerprints {
+    gcis_karp_rabin kr;
+    // Fingerprint of the expansion of rule c of level i: rule[i][c]
+    std::vector<sdsl::int_vector<>> rule;
+    // Root symbol where each segment (the tail of each level, then the
+    // reduced string) starts, and the end of the root
+    std::vector<uint64_t> root_begin;
+    // Text position and fingerprint of the text before every
+    // FINGERPRINT_SAMPLE-th root symbol
+    sdsl::int_vector<> sample_pos;
+    sdsl::int_vector<> sample_fp;
+
+    bool empty() const { return root_begin.empty(); }
+
+    void clear() { *this = gcis_fingerprints(); }
+
+    uint64_t size_in_bytes() const {
+        uint64_t bytes = kr.size_in_bytes() + sdsl::size_in_bytes(sample_pos) +
+                         sdsl::size_in_bytes(sample_fp) +
+                         root_begin.size() * sizeof(uint64_t);
+        for (auto &v : rule) {
+            bytes += sdsl::size_in_bytes(v);
+        }
+        return bytes;
+    }
+};
+
+#endif // GC_IS_GCIS_FINGERPRINT_HPP
@@ -0,0 +1,70 @@
+//
+// Header of the GC-IS compressed file format.
+//
+
+#ifndef GC_IS_FORMAT_HPP
+#define GC_IS_FORMAT_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+const uint32_t GCIS_MAGIC = 0x53494347; // "GCIS" (little endian)
+const uint32_t GCIS_BLOCKS_MAGIC = 0x42494347; // "GCIB", see gcis_blocks
+const uint32_t GCIS_MAPPED_MAGIC = 0x4d494347; // "GCIM", see gcis_mapped.hpp
+const uint8_t GCIS_FORMAT_VERSION = 4;
+// Bytes written by gcis_header::serialize
+const uint64_t GCIS_HEADER_SIZE = 6;
+
+/**
+ * @brief Header written at the beginning of every compressed file.
+ *
+ * index_bytes records sizeof(uint_t) of the encoder (4, 5 or 8), since the
+ * codecs serialize some fields with that width. Files written before the
+ * header existed start directly with the reduced string and are loaded as
+ * version 0 with 32-bit indexes. Versions 0 and 1 store every partial sum
+ * of the reduced string, version 2 samples them (see gcis_partial_sum).
+ * Version 3 adds the front-coding bucket size of each level after the
+ * partial sums of the Elias-Fano and gap dictionaries; older files use
+ * FRONT_CODING_BUCKET. Version 4 adds the end of each document of a
+ * collection (see encode_collection) after the levels, an empty array for
+ * other texts. Block containers (gcis_blocks) use GCIS_BLOCKS_MAGIC and
+ * memory-mappable dictionaries GCIS_MAPPED_MAGIC.
+ */
+struct gcis_header {
+    uint32_t magic = GCIS_MAGIC;
+    uint8_t version = GCIS_FORMAT_VERSION;
+    uint8_t index_bytes = 4;
+
+    void serialize(std::ostream &o) const {
+        o.write((char *)&magic, sizeof(magic));
+        o.write((char *)&version, sizeof(version));
+        o.write((char *)&index_bytes, sizeof(index_bytes));
+    }
+
+    /**
+     * @brief Reads the header. On a legacy file the stream is rewound to
+     * its initial position and the header describes a version 0 file.
+     * @return false if the file has no header.
+     */
+    bool load(std::istream &i) {
+        std::streampos start = i.tellg();
+        uint32_t m = 0;
+        i.read((char *)&m, sizeof(m));
+        if (!i || (m != GCIS_MAGIC && m != GCIS_BLOCKS_MAGIC &&
+                   m != GCIS_MAPPED_MAGIC)) {
+            i.clear();
+            i.seekg(start);
+            magic = GCIS_MAGIC;
+            version = 0;
+            index_bytes = 4;
+            return false;
+        }
+        magic = m;
+        i.read((char *)&version, sizeof(version));
+        i.read((char *)&index_bytes, sizeof(index_bytes));
+        return true;
+    }
+};
+
+#endif // GC_IS_FORMAT_HPP
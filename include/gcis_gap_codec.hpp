@@ -9,6 +9,7 @@
 #include "sdsl/int_vector.hpp"
 #include "sdsl/sd_vector.hpp"
 #include "sdsl/rrr_vector.hpp"
+#include "gcis_rule_bucket.hpp"
 #include "util.hpp"
 #include <cstdint>
 
@@ -23,6 +24,12 @@ class gcis_gap_codec_level {
     sdsl::bit_vector::select_1_type rule_delim_sel;
 
   public:
+    uint64_t size_in_bytes();
+
+    // Position of rule rule_num in rule and its length
+    uint64_t rule_start(uint64_t rule_num);
+    uint64_t rule_length(uint64_t rule_num);
+
     void expand_rule(uint64_t rule_num, sdsl::int_vector<> &r_string,
                      uint64_t &l);
     void expand_rule(uint64_t rule_num, char *s, uint64_t &l);
@@ -49,6 +56,9 @@ class gcis_gap_codec {
     sdsl::dac_vector_dp<> fully_decoded_rule_len;
     // A integer storing the fully decoded tail length
     uint64_t fully_decoded_tail_len;
+    // Rules per front-coding bucket, stored by the dictionary (see
+    // gcis_header)
+    uint64_t front_coding_bucket = FRONT_CODING_BUCKET;
 
   public:
     /**
@@ -125,6 +135,15 @@ class gcis_gap_codec {
     void extract_rule_suffix(uint64_t rule_num,
                              sdsl::int_vector<> &extracted_text, uint64_t &k);
 
+    /**
+     * @brief Expands the rules of a front-coding bucket that follow the
+     * ones already in it, up to rule end-1 or the end of the bucket.
+     *
+     * @param b The bucket, whose first rule is b.first.
+     * @param end One past the last rule to expand.
+     */
+    void decode_bucket(gcis_rule_bucket &b, uint64_t end);
+
     /**
      * @brief Serializes the object into a file.
      *
@@ -0,0 +1,124 @@
+//
+// Cache of decompressed grammar levels.
+//
+
+#ifndef GC_IS_GCIS_LEVEL_CACHE_HPP
+#define GC_IS_GCIS_LEVEL_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Keeps the levels returned by decompress() between calls, up to a
+ * budget in bytes, evicting the least recently used ones.
+ *
+ * The cache is disabled (budget 0) by default, in which case every call
+ * rebuilds the level. Levels are handed out as shared pointers, so a level
+ * evicted while in use stays alive until its user releases it.
+ */
+template <class level_t> class gcis_level_cache {
+  public:
+    gcis_level_cache() = default;
+    // The cached levels belong to the dictionary they were built from
+    gcis_level_cache(const gcis_level_cache &rhs) noexcept
+        : m_budget(rhs.m_budget) {}
+    gcis_level_cache &operator=(const gcis_level_cache &rhs) {
+        set_budget(rhs.m_budget);
+        clear();
+        return *this;
+    }
+
+    void set_budget(uint64_t bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_budget = bytes;
+        evict();
+    }
+
+    uint64_t budget() const { return m_budget; }
+
+    /**
+     * @brief Returns level i, calling build() to decompress it on a miss.
+     * The built level is kept if it fits in the budget.
+     */
+    template <class build_f>
+    std::shared_ptr<level_t> get(uint64_t i, build_f build) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (i < m_levels.size() && m_levels[i]) {
+                m_hits++;
+                m_lru.remove(i);
+                m_lru.push_front(i);
+                return m_levels[i];
+            }
+            m_misses++;
+        }
+        std::shared_ptr<level_t> level =
+            std::make_shared<level_t>(build());
+        uint64_t bytes = level->size_in_bytes();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (bytes > m_budget)
+            return level;
+        if (i >= m_levels.size()) {
+            m_levels.resize(i + 1);
+            m_bytes.resize(i + 1, 0);
+        }
+        if (!m_levels[i]) {
+            m_levels[i] = level;
+            m_bytes[i] = bytes;
+            m_size += bytes;
+            m_lru.push_front(i);
+            evict();
+        }
+        return level;
+    }
+
+    // Level i if it is cached, counted as a hit, nullptr otherwise
+    std::shared_ptr<level_t> peek(uint64_t i) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (i >= m_levels.size() || !m_levels[i])
+            return nullptr;
+        m_hits++;
+        return m_levels[i];
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_levels.clear();
+        m_bytes.clear();
+        m_lru.clear();
+        m_size = 0;
+    }
+
+    // Bytes of the cached levels
+    uint64_t size_in_bytes() const { return m_size; }
+    // Calls that found the level cached and that had to build it
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+  private:
+    std::mutex m_mutex;
+    uint64_t m_budget = 0;
+    uint64_t m_size = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    std::vector<std::shared_ptr<level_t>> m_levels;
+    std::vector<uint64_t> m_bytes;
+    // Cached levels, most recently used first
+    std::list<uint64_t> m_lru;
+
+    void evict() {
+        while (m_size > m_budget && !m_lru.empty()) {
+            uint64_t i = m_lru.back();
+            m_lru.pop_back();
+            m_size -= m_bytes[i];
+            m_bytes[i] = 0;
+            m_levels[i].reset();
+        }
+    }
+};
+
+#endif // GC_IS_GCIS_LEVEL_CACHE_HPP
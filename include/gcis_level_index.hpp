@@ -0,0 +1,108 @@
+//
+// In-memory position index of a grammar level.
+//
+
+#ifndef GC_IS_GCIS_LEVEL_INDEX_HPP
+#define GC_IS_GCIS_LEVEL_INDEX_HPP
+
+#include "sdsl/int_vector.hpp"
+#include "util.hpp"
+#include <cstdint>
+#include <vector>
+
+#define LEVEL_INDEX_SAMPLE 16 // rule symbols per sampled position
+
+/**
+ * @brief Finds which symbol of a rule covers a position of the expansion
+ * of the rule, and optionally holds the expansion lengths of the rules in
+ * a plain array.
+ *
+ * For every LEVEL_INDEX_SAMPLE-th symbol of a rule, the position where its
+ * expansion starts inside the expansion of the rule is sampled. A search
+ * is a binary search over the samples of the rule followed by a scan of
+ * less than LEVEL_INDEX_SAMPLE symbols, instead of a scan of the whole
+ * rule. Rules shorter than LEVEL_INDEX_SAMPLE symbols have no samples.
+ *
+ * The expansion lengths copied from the DAC of the level into a bit-packed
+ * array take more space but are read with a single access.
+ *
+ * The index is built from a loaded dictionary and is not stored in its
+ * file.
+ */
+class gcis_level_index {
+  public:
+    /**
+     * @brief Samples the positions inside the rules of a decompressed level.
+     * @param len functor returning the expansion length of a symbol of the
+     * rules
+     */
+    template <class level_t, class len_f>
+    void build_positions(level_t &level, uint64_t n_rules, len_f len) {
+        std::vector<uint64_t> first(n_rules + 1), samples;
+        for (uint64_t c = 0; c < n_rules; c++) {
+            first[c] = samples.size();
+            uint64_t start = level.rule_start(c);
+            uint64_t n = level.rule_length(c);
+            uint64_t sum = 0;
+            for (uint64_t j = 1; j < n; j++) {
+                sum += len(level.rule[start + j - 1]);
+                if (j % LEVEL_INDEX_SAMPLE == 0)
+                    samples.push_back(sum);
+            }
+        }
+        first[n_rules] = samples.size();
+        pack_int_vector(first, m_first);
+        pack_int_vector(samples, m_samples);
+    }
+
+    // Copies the expansion lengths of the n_rules rules, len(c)
+    template <class len_f> void build_lengths(uint64_t n_rules, len_f len) {
+        std::vector<uint64_t> length(n_rules);
+        for (uint64_t c = 0; c < n_rules; c++) {
+            length[c] = len(c);
+        }
+        pack_int_vector(length, m_length);
+        m_plain_lengths = true;
+    }
+
+    bool has_positions() const { return m_first.size() > 0; }
+    bool has_lengths() const { return m_plain_lengths; }
+
+    // Expansion length of rule c (build_lengths must have been called)
+    uint64_t length(uint64_t c) const { return m_length[c]; }
+
+    /**
+     * @brief Finds the last sampled symbol of rule c whose expansion starts
+     * at or before position x of the expansion of the rule.
+     * @param sum receives the position where the expansion of the symbol
+     * starts
+     * @return the index of the symbol in the rule, 0 if no sample precedes x
+     */
+    uint64_t find(uint64_t c, uint64_t x, uint64_t &sum) const {
+        uint64_t lo = m_first[c], hi = m_first[c + 1];
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (m_samples[mid] <= x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        uint64_t k = lo - m_first[c];
+        sum = k ? (uint64_t)m_samples[lo - 1] : 0;
+        return k * LEVEL_INDEX_SAMPLE;
+    }
+
+    uint64_t size_in_bytes() const {
+        return sdsl::size_in_bytes(m_first) + sdsl::size_in_bytes(m_samples) +
+               sdsl::size_in_bytes(m_length);
+    }
+
+  private:
+    // Samples of rule c are m_samples[m_first[c], m_first[c+1])
+    sdsl::int_vector<> m_first;
+    sdsl::int_vector<> m_samples;
+    sdsl::int_vector<> m_length;
+    bool m_plain_lengths = false;
+};
+
+#endif // GC_IS_GCIS_LEVEL_INDEX_HPP
@@ -0,0 +1,199 @@
+//
+// Memory-mappable layout of a GC-IS dictionary.
+//
+
+#ifndef GC_IS_GCIS_MAPPED_HPP
+#define GC_IS_GCIS_MAPPED_HPP
+
+#include "gcis_format.hpp"
+#include "gcis_mapped_file.hpp"
+#include "sdsl/bits.hpp"
+#include "util.hpp"
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Read-only array of fixed-width integers stored in place.
+ *
+ * In the file an array is the number of elements and the width in bits (one
+ * 64-bit word each) followed by the elements, packed into 64-bit words.
+ */
+class gcis_packed_view {
+  public:
+    uint64_t operator[](uint64_t i) const {
+        uint64_t bit = i * m_width;
+        const uint64_t *w = m_words + (bit >> 6);
+        uint64_t offset = bit & 63;
+        uint64_t v = w[0] >> offset;
+        if (offset + m_width > 64) {
+            v |= w[1] << (64 - offset);
+        }
+        return m_width == 64 ? v : v & ((1ULL << m_width) - 1);
+    }
+
+    uint64_t size() const { return m_size; }
+
+    // Points the view to the array stored at p and returns the word that
+    // follows it. Throws if the array does not fit before end.
+    const uint64_t *attach(const uint64_t *p, const uint64_t *end);
+
+    /**
+     * @brief Writes n integers in the packed layout with the smallest width
+     * that fits all of them.
+     * @param get functor returning the i-th integer
+     */
+    template <class get_f>
+    static void write(std::ostream &o, uint64_t n, get_f get) {
+        uint64_t max = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            max |= get(i);
+        }
+        uint64_t width = sdsl::bits::hi(max | 1) + 1;
+        std::vector<uint64_t> words((n * width + 63) / 64, 0);
+        for (uint64_t i = 0; i < n; i++) {
+            uint64_t v = get(i), bit = i * width, offset = bit & 63;
+            words[bit >> 6] |= v << offset;
+            if (offset + width > 64) {
+                words[(bit >> 6) + 1] |= v >> (64 - offset);
+            }
+        }
+        o.write((char *)&n, sizeof(n));
+        o.write((char *)&width, sizeof(width));
+        o.write((char *)words.data(), sizeof(uint64_t) * words.size());
+    }
+
+  private:
+    const uint64_t *m_words = nullptr;
+    uint64_t m_size = 0;
+    uint64_t m_width = 1;
+};
+
+/**
+ * @brief One level of the grammar in the mapped layout. The rules are front
+ * coded as in the Elias-Fano and gap codecs, but every field is a plain
+ * packed array, so no structure has to be built before querying it.
+ */
+class gcis_mapped_level {
+  public:
+    uint64_t string_size;
+    uint64_t alphabet_size;
+    uint64_t fully_decoded_tail_len;
+    // LCP between each rule and the previous one
+    gcis_packed_view lcp;
+    // Start of the suffix of each rule in rule, plus its total length
+    gcis_packed_view rule_pos;
+    // Suffixes of the rules not covered by the LCP, concatenated
+    gcis_packed_view rule;
+    gcis_packed_view tail;
+    gcis_packed_view fully_decoded_rule_len;
+
+    uint64_t get_lcp(uint64_t i) const { return lcp[i]; }
+    uint64_t get_rule_pos(uint64_t i) const { return rule_pos[i]; }
+    uint64_t get_rule_length(uint64_t i) const {
+        return rule_pos[i + 1] - rule_pos[i];
+    }
+
+    // Appends the symbols of rule rule_num to out
+    void extract_rule(uint64_t rule_num, std::vector<uint64_t> &out) const;
+
+    const uint64_t *attach(const uint64_t *p, const uint64_t *end);
+};
+
+/**
+ * @brief Writes a dictionary (Elias-Fano or gap codec) in the layout read
+ * by gcis_mapped_dictionary.
+ */
+template <class codec_t>
+void gcis_serialize_mapped(std::ostream &o, std::vector<codec_t> &g,
+                           const sdsl::int_vector<> &reduced_string) {
+    gcis_header h;
+    h.magic = GCIS_MAPPED_MAGIC;
+    h.index_bytes = sizeof(uint_t);
+    h.serialize(o);
+    // The arrays are read in place as 64-bit words
+    const char padding[8] = {0};
+    o.write(padding, 8 - GCIS_HEADER_SIZE % 8);
+
+    uint64_t n_levels = g.size();
+    o.write((char *)&n_levels, sizeof(n_levels));
+    gcis_packed_view::write(o, reduced_string.size(), [&](uint64_t i) {
+        return (uint64_t)reduced_string[i];
+    });
+    // Every partial sum is stored, so that the searches read them in place
+    std::vector<uint64_t> partial_sum(reduced_string.size(), 0);
+    for (uint64_t i = 1; i < partial_sum.size(); i++) {
+        partial_sum[i] = partial_sum[i - 1] +
+                         (g.empty() ? 1
+                                    : (uint64_t)g.back().fully_decoded_rule_len
+                                          [reduced_string[i - 1]]);
+    }
+    gcis_packed_view::write(o, partial_sum.size(),
+                            [&](uint64_t i) { return partial_sum[i]; });
+    for (codec_t &c : g) {
+        uint64_t v[3] = {(uint64_t)c.string_size, (uint64_t)c.alphabet_size,
+                         c.fully_decoded_tail_len};
+        o.write((char *)v, sizeof(v));
+        uint64_t n_rules = c.fully_decoded_rule_len.size();
+        gcis_packed_view::write(o, n_rules,
+                                [&](uint64_t i) { return c.get_lcp(i); });
+        gcis_packed_view::write(o, n_rules + 1, [&](uint64_t i) {
+            return i < n_rules ? c.get_rule_pos(i) : (uint64_t)c.rule.size();
+        });
+        gcis_packed_view::write(o, c.rule.size(),
+                                [&](uint64_t i) { return (uint64_t)c.rule[i]; });
+        gcis_packed_view::write(o, c.tail.size(),
+                                [&](uint64_t i) { return (uint64_t)c.tail[i]; });
+        gcis_packed_view::write(o, n_rules, [&](uint64_t i) {
+            return (uint64_t)c.fully_decoded_rule_len[i];
+        });
+    }
+}
+
+/**
+ * @brief Dictionary queried directly from a memory-mapped file written by
+ * serialize_mapped.
+ *
+ * Opening it only maps the file and reads the offsets of the arrays, so it
+ * starts in constant time with respect to the grammar size, and processes
+ * mapping the same file share its pages through the page cache. The file
+ * is mapped with MADV_RANDOM, as queries read it out of order, so the
+ * kernel does not read ahead pages they will not use. Only extraction is
+ * supported.
+ */
+class gcis_mapped_dictionary {
+  public:
+    explicit gcis_mapped_dictionary(const char *path);
+
+    gcis_mapped_dictionary(const gcis_mapped_dictionary &) = delete;
+    gcis_mapped_dictionary &operator=(const gcis_mapped_dictionary &) = delete;
+
+    // Length of the encoded text
+    uint64_t text_length() const;
+
+    // Size of the mapped file
+    uint64_t size_in_bytes() const { return m_file.size(); }
+
+    // Extract T[l,r] into out (r-l+1 bytes)
+    void extract(uint64_t l, uint64_t r, unsigned char *out) const;
+
+    /**
+     * @brief Extracts several valid substrings of the form T[l,r]
+     * from the text.
+     *
+     * @param query A vector containing [l,r] pairs.
+     */
+    void extract_batch(const vector<pair<uint64_t, uint64_t>> &query) const;
+
+  private:
+    gcis_mapped_file m_file;
+    std::vector<gcis_mapped_level> g;
+    gcis_packed_view reduced_string;
+    gcis_packed_view partial_sum;
+
+    uint64_t bsearch_upperbound(uint64_t sz) const;
+    uint64_t bsearch_lowerbound(uint64_t sz) const;
+};
+
+#endif // GC_IS_GCIS_MAPPED_HPP
@@ -0,0 +1,85 @@
+//
+// Read-only memory map of an input file.
+//
+
+#ifndef GC_IS_MAPPED_FILE_HPP
+#define GC_IS_MAPPED_FILE_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Maps a file read-only into memory, followed by a NUL byte that the
+ * suffix sorting algorithms use as the sentinel.
+ *
+ * The file is mapped over a zero-filled anonymous region one byte longer,
+ * so data()[size()] == 0 without copying the file or writing to it. The
+ * pages are loaded on demand, so the input does not have to be read into a
+ * separate buffer before compressing it. The access pattern is passed to
+ * madvise: MADV_SEQUENTIAL (the default) suits the scans of the suffix
+ * sorting, MADV_RANDOM the queries of a mapped dictionary.
+ */
+class gcis_mapped_file {
+  public:
+    explicit gcis_mapped_file(const char *path, int advice = MADV_SEQUENTIAL) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            fail(path);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            fail(path);
+        }
+        m_size = st.st_size;
+        uint64_t page = sysconf(_SC_PAGESIZE);
+        m_map_size = (m_size + 1 + page - 1) / page * page;
+
+        void *p = mmap(nullptr, m_map_size, PROT_READ,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            fail(path);
+        }
+        // The bytes after the end of the file in its last page are zero
+        if (m_size > 0 && mmap(p, m_size, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                               fd, 0) == MAP_FAILED) {
+            munmap(p, m_map_size);
+            close(fd);
+            fail(path);
+        }
+        close(fd);
+        madvise(p, m_map_size, advice);
+        m_data = (const char *)p;
+    }
+
+    ~gcis_mapped_file() {
+        if (m_data)
+            munmap((void *)m_data, m_map_size);
+    }
+
+    gcis_mapped_file(const gcis_mapped_file &) = delete;
+    gcis_mapped_file &operator=(const gcis_mapped_file &) = delete;
+
+    // Contents of the file, followed by a NUL byte
+    const char *data() const { return m_data; }
+    // Length of the file, without the NUL byte
+    uint64_t size() const { return m_size; }
+
+  private:
+    const char *m_data = nullptr;
+    uint64_t m_size = 0;
+    uint64_t m_map_size = 0;
+
+    static void fail(const char *path) {
+        throw std::runtime_error(std::string(path) + ": " + strerror(errno));
+    }
+};
+
+#endif // GC_IS_MAPPED_FILE_HPP
@@ -0,0 +1,139 @@
+//
+// Sampled partial sums of the expansion lengths of the reduced string.
+//
+
+#ifndef GC_IS_GCIS_PARTIAL_SUM_HPP
+#define GC_IS_GCIS_PARTIAL_SUM_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#define PARTIAL_SUM_SAMPLE 32 // reduced string symbols per sampled partial sum
+
+/**
+ * @brief Position in the text where the expansion of each symbol of the
+ * reduced string starts, answering which symbol covers a text position.
+ *
+ * Only the partial sum of every PARTIAL_SUM_SAMPLE-th symbol is stored, as
+ * a 64-bit integer. The samples are kept in Eytzinger (breadth-first)
+ * order, so the first steps of a search touch the same few cache lines and
+ * the next nodes can be prefetched. The search then adds the expansion
+ * lengths of at most PARTIAL_SUM_SAMPLE-1 symbols, given by a functor
+ * len(i), to reach the symbol.
+ *
+ * In the file the structure is the number of symbols and the number of
+ * samples followed by the samples in increasing order.
+ */
+class gcis_partial_sum {
+  public:
+    /**
+     * @brief Samples the partial sums of n symbols.
+     * @param len functor returning the expansion length of symbol i
+     */
+    template <class len_f> void build(uint64_t n, len_f len) {
+        std::vector<uint64_t> samples((n + PARTIAL_SUM_SAMPLE - 1) /
+                                      PARTIAL_SUM_SAMPLE);
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            if (i % PARTIAL_SUM_SAMPLE == 0)
+                samples[i / PARTIAL_SUM_SAMPLE] = sum;
+            sum += len(i);
+        }
+        m_size = n;
+        set_samples(samples);
+    }
+
+    // Samples the partial sums of a legacy file, which stores all of them
+    template <class sum_t> void build(const std::vector<sum_t> &sums) {
+        std::vector<uint64_t> samples;
+        for (uint64_t i = 0; i < sums.size(); i += PARTIAL_SUM_SAMPLE) {
+            samples.push_back(sums[i]);
+        }
+        m_size = sums.size();
+        set_samples(samples);
+    }
+
+    // Number of symbols
+    uint64_t size() const { return m_size; }
+
+    /**
+     * @brief Finds the symbol whose expansion covers the text position x,
+     * the rightmost symbol i such that sum(i) <= x.
+     * @param sum receives the partial sum of the symbol
+     */
+    template <class len_f>
+    uint64_t find(uint64_t x, len_f len, uint64_t &sum) const {
+        sum = 0;
+        if (m_size == 0)
+            return 0;
+        uint64_t n = m_tree.size() - 1, k = 1, best = 1;
+        while (k <= n) {
+            __builtin_prefetch(m_tree.data() + 16 * k);
+            if (m_tree[k] <= x)
+                best = k;
+            k = 2 * k + (m_tree[k] <= x);
+        }
+        sum = m_tree[best];
+        uint64_t i = m_rank[best] * PARTIAL_SUM_SAMPLE;
+        for (; i + 1 < m_size; i++) {
+            uint64_t l = len(i);
+            if (sum + l > x)
+                break;
+            sum += l;
+        }
+        return i;
+    }
+
+    uint64_t size_in_bytes() const {
+        return sizeof(m_size) +
+               (m_tree.size() + m_rank.size()) * sizeof(uint64_t);
+    }
+
+    void serialize(std::ostream &o) const {
+        std::vector<uint64_t> samples(m_tree.size() - 1);
+        for (uint64_t k = 1; k < m_tree.size(); k++) {
+            samples[m_rank[k]] = m_tree[k];
+        }
+        uint64_t n_samples = samples.size();
+        o.write((char *)&m_size, sizeof(m_size));
+        o.write((char *)&n_samples, sizeof(n_samples));
+        o.write((char *)samples.data(), sizeof(uint64_t) * n_samples);
+    }
+
+    void load(std::istream &i) {
+        uint64_t n_samples;
+        i.read((char *)&m_size, sizeof(m_size));
+        i.read((char *)&n_samples, sizeof(n_samples));
+        std::vector<uint64_t> samples(n_samples);
+        i.read((char *)samples.data(), sizeof(uint64_t) * n_samples);
+        set_samples(samples);
+    }
+
+  private:
+    uint64_t m_size = 0;
+    // Samples in Eytzinger order (from index 1) and the index of each one
+    // in increasing order
+    std::vector<uint64_t> m_tree = {0};
+    std::vector<uint64_t> m_rank = {0};
+
+    void set_samples(const std::vector<uint64_t> &samples) {
+        m_tree.assign(samples.size() + 1, 0);
+        m_rank.assign(samples.size() + 1, 0);
+        uint64_t j = 0;
+        place(samples, j, 1);
+    }
+
+    // Writes the samples from j on into the subtree rooted at node k
+    void place(const std::vector<uint64_t> &samples, uint64_t &j, uint64_t k) {
+        if (k < m_tree.size()) {
+            place(samples, j, 2 * k);
+            m_tree[k] = samples[j];
+            m_rank[k] = j++;
+            place(samples, j, 2 * k + 1);
+        }
+    }
+};
+
+#endif // GC_IS_GCIS_PARTIAL_SUM_HPP
@@ -0,0 +1,205 @@
+//
+// Decoded front-coding buckets of the rules of a level.
+//
+
+#ifndef GC_IS_GCIS_RULE_BUCKET_HPP
+#define GC_IS_GCIS_RULE_BUCKET_HPP
+
+#include "sdsl/int_vector.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Default rules per front-coding bucket. The first rule of a bucket shares
+// no prefix with the previous rule, so a bucket is decoded on its own.
+#define FRONT_CODING_BUCKET 32
+// Largest bucket size considered by gcis_rule_builder::choose_bucket
+#define FRONT_CODING_MAX_BUCKET 1024
+// Default average number of previous rules read to expand a rule when the
+// bucket size is chosen per level
+#define FRONT_CODING_MAX_WALK 4.0
+#define BUCKET_CACHE_SLOTS 4096 // decoded buckets kept per level by extract
+// expand_rule stops decoding the buckets of a level, once it has read
+// BUCKET_CACHE_WARMUP of its rules, if it decoded more than
+// BUCKET_CACHE_DECODED_PER_HIT rules per rule read from a decoded bucket
+#define BUCKET_CACHE_WARMUP 4096
+#define BUCKET_CACHE_DECODED_PER_HIT 16
+
+// The encoders restart the front coding at every rule i with
+// i % bucket == 1, and rule 0 joins the first bucket
+inline uint64_t bucket_first_rule(uint64_t rule_num, uint64_t bucket) {
+    return rule_num ? rule_num - (rule_num - 1) % bucket : 0;
+}
+
+// One past the last rule of the bucket starting at rule first
+inline uint64_t bucket_end_rule(uint64_t first, uint64_t bucket) {
+    return first + bucket + (first == 0);
+}
+
+/**
+ * @brief The rules of a front-coding bucket expanded into plain symbols.
+ */
+struct gcis_rule_bucket {
+    // Level the bucket was decoded from and its first rule
+    const void *owner = nullptr;
+    uint64_t first = 0;
+    // Last bucket that missed this slot without being decoded
+    const void *missed_owner = nullptr;
+    uint64_t missed_first = 0;
+    std::vector<uint64_t> symbol;
+    // Rule first+j is symbol[start[j], start[j+1])
+    std::vector<uint64_t> start;
+
+    // Rules decoded so far, the first ones of the bucket
+    uint64_t rules() const { return start.empty() ? 0 : start.size() - 1; }
+
+    void clear(const void *o, uint64_t f) {
+        owner = o;
+        first = f;
+        symbol.clear();
+        start.assign(1, 0);
+    }
+
+    /**
+     * @brief Appends a rule that shares its first lcp symbols with the
+     * previous rule of the bucket and ends with suffix_len symbols read by
+     * suffix(i).
+     */
+    template <class suffix_f>
+    void add(uint64_t lcp, uint64_t suffix_len, suffix_f suffix) {
+        uint64_t prev = start.size() > 1 ? start[start.size() - 2] : 0;
+        for (uint64_t i = 0; i < lcp; i++) {
+            symbol.push_back(symbol[prev + i]);
+        }
+        for (uint64_t i = 0; i < suffix_len; i++) {
+            symbol.push_back(suffix(i));
+        }
+        start.push_back(symbol.size());
+    }
+};
+
+/**
+ * @brief Direct-mapped cache of decoded buckets, BUCKET_CACHE_SLOTS per
+ * level, used by the extraction of a thread instead of walking the front
+ * coding of every rule it copies.
+ *
+ * Each slot remembers the level it was decoded from, so a cache may be
+ * shared by the dictionaries of a block container, but it must not be
+ * used after the dictionary it was filled from is modified.
+ *
+ * A bucket is decoded only up to the rule asked for, and extended when a
+ * later rule of it is. Even so, decoding costs more than walking the front
+ * coding of the single rule asked for, which is a loss when the bucket is
+ * not read again, as happens with most buckets of a text with few
+ * repetitions. expand_rule therefore decodes a bucket only on its second
+ * miss in a row on its slot, and walks all the rules of a level whose
+ * decoded buckets are rarely read, without reading its slots.
+ */
+class gcis_bucket_cache {
+  public:
+    /**
+     * @brief Appends rule rule_num of level level, whose codec is codec, to
+     * out[k..], from its decoded bucket if the cache pays off for the level.
+     * Otherwise the rule is copied with codec.extract_rule.
+     */
+    template <class codec_t>
+    void expand_rule(uint64_t level, codec_t &codec, uint64_t rule_num,
+                     sdsl::int_vector<> &out, uint64_t &k) {
+        if (level >= m_slots.size()) {
+            m_slots.resize(level + 1);
+        }
+        level_slots &l = m_slots[level];
+        // The first reads of a level find most of its slots empty, so they
+        // do not decide
+        l.reads++;
+        if (l.reads >= BUCKET_CACHE_WARMUP &&
+            l.decoded > l.hits * BUCKET_CACHE_DECODED_PER_HIT) {
+            codec.extract_rule(rule_num, out, k);
+            return;
+        }
+        uint64_t first = bucket_first_rule(rule_num, codec.front_coding_bucket);
+        gcis_rule_bucket &b = slot(level, codec, first);
+        uint64_t j = rule_num - first;
+        if (holds(b, &codec, first)) {
+            l.hits++;
+        } else if (b.missed_owner != &codec || b.missed_first != first) {
+            b.missed_owner = &codec;
+            b.missed_first = first;
+            codec.extract_rule(rule_num, out, k);
+            return;
+        } else {
+            b.clear(&codec, first);
+        }
+        if (j >= b.rules()) {
+            l.decoded += j + 1 - b.rules();
+            codec.decode_bucket(b, rule_num + 1);
+        }
+        for (uint64_t i = b.start[j]; i < b.start[j + 1]; i++) {
+            out[k++] = b.symbol[i];
+        }
+    }
+
+    /**
+     * @brief Symbols of rule rule_num of level level in its bucket, which
+     * is decoded whole, as the rules are read in order by the fingerprint
+     * construction. They stay valid until another bucket of the level is
+     * decoded.
+     * @param n receives the number of symbols of the rule
+     */
+    template <class codec_t>
+    const uint64_t *rule(uint64_t level, codec_t &codec, uint64_t rule_num,
+                         uint64_t &n) {
+        uint64_t first = bucket_first_rule(rule_num, codec.front_coding_bucket);
+        gcis_rule_bucket &b = slot(level, codec, first);
+        uint64_t j = rule_num - first;
+        if (!holds(b, &codec, first)) {
+            b.clear(&codec, first);
+        }
+        if (j >= b.rules()) {
+            codec.decode_bucket(b, bucket_end_rule(first, codec.front_coding_bucket));
+        }
+        n = b.start[j + 1] - b.start[j];
+        return b.symbol.data() + b.start[j];
+    }
+
+    // Slots of level level
+    uint64_t slots(uint64_t level) const {
+        return level < m_slots.size() ? m_slots[level].slot.size() : 0;
+    }
+
+  private:
+    struct level_slots {
+        std::vector<gcis_rule_bucket> slot;
+        // Rules read by expand_rule, rules it decoded and rules it found
+        // decoded
+        uint64_t reads = 0, decoded = 0, hits = 0;
+    };
+    std::vector<level_slots> m_slots;
+
+    static bool holds(const gcis_rule_bucket &b, const void *codec,
+                      uint64_t first) {
+        return b.owner == codec && b.first == first && !b.start.empty();
+    }
+
+    // Slot of the bucket starting at rule first of a level
+    template <class codec_t>
+    gcis_rule_bucket &slot(uint64_t level, codec_t &codec, uint64_t first) {
+        uint64_t bucket = codec.front_coding_bucket;
+        if (level >= m_slots.size()) {
+            m_slots.resize(level + 1);
+        }
+        std::vector<gcis_rule_bucket> &slots = m_slots[level].slot;
+        // The level has the slots of the codec with the most buckets seen.
+        // Growing them moves the decoded buckets, which are dropped.
+        uint64_t n_slots = std::min<uint64_t>(
+            codec.fully_decoded_rule_len.size() / bucket + 1,
+            BUCKET_CACHE_SLOTS);
+        if (slots.size() < n_slots) {
+            slots.clear();
+            slots.resize(n_slots);
+        }
+        return slots[first / bucket % slots.size()];
+    }
+};
+
+#endif // GC_IS_GCIS_RULE_BUCKET_HPP
@@ -0,0 +1,112 @@
+#ifndef GC_IS_GCIS_RULE_BUILDER_HPP
+#define GC_IS_GCIS_RULE_BUILDER_HPP
+
+#include "gcis_rule_bucket.hpp"
+#include "sdsl/bit_vectors.hpp"
+#include "sdsl/int_vector.hpp"
+#include "util.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Collects the front-coded rules of one level during the naming
+ * step and builds the rule, LCP and suffix length structures once all
+ * their sizes are known.
+ *
+ * Each rule is recorded as the text position of its suffix (the symbols
+ * not shared with the previous rule), its LCP with the previous rule and
+ * the suffix length, so no bit-packed vector is resized while naming.
+ * The rules are counted before naming and the buffers allocated once.
+ */
+class gcis_rule_builder {
+  public:
+    // Allocates the buffers of the given number of rules, counted before
+    // the naming step (see gcis_dictionary::count_rules)
+    void reserve(uint64_t rules) {
+        m_suffix_pos.reserve(rules);
+        m_lcp.reserve(rules);
+        m_suffix_len.reserve(rules);
+    }
+
+    // Records a rule of length len starting at text position pos whose
+    // first lcp symbols are shared with the previous rule
+    void add(uint64_t pos, uint64_t lcp, uint64_t len) {
+        m_suffix_pos.push_back(pos + lcp);
+        m_lcp.push_back(lcp);
+        m_suffix_len.push_back(len - lcp);
+        m_total_lcp += lcp;
+        m_total_suffix_len += len - lcp;
+    }
+
+    uint64_t size() const { return m_lcp.size(); }
+    uint64_t lcp(uint64_t i) const { return m_lcp[i]; }
+    uint64_t suffix_length(uint64_t i) const { return m_suffix_len[i]; }
+    uint64_t total_lcp() const { return m_total_lcp; }
+    uint64_t total_suffix_length() const { return m_total_suffix_len; }
+
+    /**
+     * @brief Cost model of the front-coding bucket size of the level.
+     *
+     * Expanding a rule reads the previous rules back to the last one with
+     * no LCP, either a rule whose first symbol differs from the previous
+     * rule or the first rule of its bucket. Larger buckets store fewer
+     * LCPs as explicit symbols but make that walk longer.
+     *
+     * @return the largest power of two up to FRONT_CODING_MAX_BUCKET for
+     * which the average walk over the recorded rules is at most max_walk
+     * rules
+     */
+    uint64_t choose_bucket(double max_walk) const;
+
+    // Sets to 0 the LCP of the first rule of every bucket of the given size
+    // (see bucket_first_rule). Must be called once, after the last add.
+    void restart_front_coding(uint64_t bucket);
+
+    /**
+     * @brief Copies the rule suffixes into rule, which is allocated once
+     * and bit-compressed at the end.
+     * @param width bits per symbol while copying (enough for the alphabet)
+     * @param symbol functor returning the text symbol at a given position
+     */
+    template <class symbol_f>
+    void build_rules(sdsl::int_vector<> &rule, uint8_t width,
+                     symbol_f symbol) const {
+        rule = sdsl::int_vector<>(m_total_suffix_len, 0, width);
+        uint64_t k = 0;
+        for (uint64_t r = 0; r < size(); r++) {
+            for (uint64_t j = 0; j < m_suffix_len[r]; j++) {
+                rule[k++] = symbol(m_suffix_pos[r] + j);
+            }
+        }
+        sdsl::util::bit_compress(rule);
+    }
+
+    // LCP of each rule in unary (lcp 0-bits followed by a 1-bit)
+    void build_unary_lcp(sdsl::bit_vector &bv) const;
+    // Suffix length of each rule in unary
+    void build_unary_suffix_length(sdsl::bit_vector &bv) const;
+    // Prefix sums of the LCPs, one entry per rule
+    void build_cumulative_lcp(std::vector<uint64_t> &v) const;
+    // Prefix sums of the suffix lengths, one entry per rule
+    void build_cumulative_suffix_length(std::vector<uint64_t> &v) const;
+
+    void clear();
+
+  private:
+    // Text positions and lengths, which fit the index width of the text
+    std::vector<uint_t> m_suffix_pos;
+    std::vector<uint_t> m_lcp;
+    std::vector<uint_t> m_suffix_len;
+    uint64_t m_total_lcp = 0;
+    uint64_t m_total_suffix_len = 0;
+
+    // Average number of previous rules read to expand a rule
+    double average_walk(uint64_t bucket) const;
+
+    static void build_unary(const std::vector<uint_t> &v, uint64_t total,
+                            sdsl::bit_vector &bv);
+    static void build_cumulative(const std::vector<uint_t> &v,
+                                 std::vector<uint64_t> &out);
+};
+
+#endif // GC_IS_GCIS_RULE_BUILDER_HPP
@@ -6,6 +6,7 @@
 #define GC_IS_GCIS_S8B_HPP
 
 #include "gcis.hpp"
+#include "gcis_rule_builder.hpp"
 #include "gcis_s8b_codec.hpp"
 #include "util.hpp"
 template <>
@@ -49,34 +50,41 @@ char *decode() override {
         char *str = 0;
         for (int64_t i = g.size() - 1; i >= 0; i--) {
             sdsl::int_vector<> next_r_string;
-            gcis_s8b_pointers_codec_level gd = std::move(g[i].decompress());
+            std::shared_ptr<gcis_s8b_pointers_codec_level> gd =
+                decompressed_level(i);
             next_r_string.width(sdsl::bits::hi(g[i].alphabet_size - 1) + 1);
             next_r_string.resize(g[i].string_size);
-            uint64_t l = 0;
             if (i == 0) {
                 // Convert the reduced string in the original text
                 str = new char[g[i].string_size];
-                for (auto t : g[i].tail) {
-                    str[l++] = (char)t;
-                }
-                for (uint64_t j = 0; j < r_string.size(); j++) {
-                    gd.expand_rule(r_string[j], str, l);
-                }
+                expand_level(*gd, g[i].tail, r_string, str);
             } else {
                 // Convert the reduced string in the previous reduced string
-                for (uint64_t j = 0; j < g[i].tail.size(); j++) {
-                    next_r_string[l++] = g[i].tail[j];
-                }
-                for (uint64_t j = 0; j < r_string.size(); j++) {
-                    gd.expand_rule(r_string[j], next_r_string, l);
-                }
+                expand_level(*gd, g[i].tail, r_string, next_r_string);
                 r_string = std::move(next_r_string);
             }
         }
+        if (g.size() == 0) {
+            // the text was stored as the reduced string
+            str = new char[reduced_string.size()];
+            for (uint64_t i = 0; i < reduced_string.size(); i++) {
+                str[i] = reduced_string[i];
+            }
+        }
         return str;
     }
+
+    void decode_to(int fd) override { decoder()->write_to(fd); }
+
   private:
-    void gc_is(int_t *s, uint_t *SA, int_t n, int_t K, int cs, int level) {
+    void gc_is(int_t *s, uint_t *SA, int_t n, int_t K, int cs,
+               int level) override {
+        GC_IS_DISPATCH(s, SA, n, K, cs, level);
+    }
+
+    template <class text_t>
+    void gc_is_level(text_t s, uint_t *SA, int_t n, int_t K,
+                     int level) {
         int_t i, j;
 
 #ifdef MEM_MONITOR
@@ -110,7 +118,7 @@ char *decode() override {
         size_t first = n - 1;
 
         // sort all the S-substrings
-        get_buckets(s, bkt, n, K, cs, true); // find ends of buckets
+        get_buckets(s, bkt, n, K, true); // find ends of buckets
 
         for (i = 0; i < n; i++) {
             SA[i] = EMPTY;
@@ -126,10 +134,10 @@ char *decode() override {
         SA[0] = n - 1; // set the single sentinel LMS-substring
 
         // Induce L-Type suffixes by using LMS-Type and L-Type suffixes
-        induceSAl(t, SA, s, bkt, n, K, cs, level);
+        induceSAl(t, SA, s, bkt, n, K, level);
 
         // Induce S-Type suffixes by using L-Type and S-Type suffixes
-        induceSAs(t, SA, s, bkt, n, K, cs, level);
+        induceSAs(t, SA, s, bkt, n, K, level);
 
         delete[] bkt;
 
@@ -145,86 +153,59 @@ char *decode() override {
 
         // Init the name array buffer
         // SA[0,n1-1] = LMS starting positions
-        // SA[n1,n-1] = Name for each LMS substring
+        // SA[n1,n-1] = Name for each LMS substring (its length until named)
         for (i = n1; i < n; i++) {
             SA[i] = EMPTY;
         }
+        store_lms_lengths(t, SA, n, n1);
 
         // find the lexicographic names of all LMS-substrings by comparing the
         // consecutive ones
         int_t name = -1;
         int_t prev = -1;
+        int_t prev_len = 0;
 
         int_t last_set_lcp_bit = -1;
-        uint_t rule_index = 0;
+        gcis_rule_builder rules;
+        rules.reserve(count_rules(s, SA, n, n1, true));
         g.push_back(gcis_s8b_codec());
         // Iterate over all suffixes in the LMS sorted array
         for (i = 0; i < n1; i++) {
             int_t pos = SA[i];
-            bool diff = false;
-            int_t d;
+            // Length of the LMS-substring, replaced by its name below
+            int_t len = SA[n1 + pos / 2];
+            bool diff = true;
             // d equals to the LCP between two consecutive LMS-substrings
-            for (d = 0; d < n; d++) {
-                // If is first suffix in LMS order (sentinel), or one of the
-                // suffixes reached the last position of T, or the
-                // characters of T differs or the type os suffixes differ.
-                if (prev == -1 || pos + d == n - 1 || prev + d == n - 1 ||
-                    chr(pos + d) != chr(prev + d) ||
-                    (isLMS(pos + d) ^ (isLMS(prev + d)))) {
-                    diff = true;
-                    break;
-                }
-                // The comparison has reached the end of at least one
-                // LMS-substring
-                if (d > 0 && (isLMS(pos + d) || isLMS(prev + d))) {
-                    break;
-                }
+            int_t d = 0;
+            if (prev != -1) {
+                diff = lms_substrings_differ(s, pos, len, prev, prev_len, n,
+                                             true, d);
             }
 
             // The consecutive LMS-substrings differs
             if (diff) {
 
-                // Get the length of the current lms-substring
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
-
-                // Get the length of the previous LMS-Substring
-                size_t len2 = 1;
-                if (prev != n - 1)
-                    while (!isLMS(prev + len2))
-                        len2++;
-
-                g[level].lcp.encode(d);
-                g[level].rule_suffix_length.encode(len - d);
-                g[level].rule.resize(g[level].rule.size() + len - d);
+                // The rule suffix T[pos+d,pos+len-1] is copied after the
+                // naming, when the sizes of all structures are known
+                rules.add(pos, d, len);
 
 #ifdef REPORT
                 total_rule_len += len;
                 total_lcp += d;
                 total_rule_suffix_length += len - d;
-#endif
-
                 for (j = 0; j < len - d && j + pos + d < n; j++) {
-#ifdef REPORT
                     if (j + pos + d + 1 < n &&
                         chr(j + pos + d) == chr(j + pos + d + 1)) {
                         run_length_potential++;
                     }
-#endif
-                    g[level].rule[rule_index] = (uint_t)chr(j + pos + d);
-                    rule_index++;
                 }
+#endif
                 name++;
                 prev = pos;
+                prev_len = len;
             }
 #ifdef REPORT
             else {
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
                 discarded_rules_len += len;
                 discarded_rules_n++;
             }
@@ -233,7 +214,14 @@ char *decode() override {
             SA[n1 + pos] = name;
         }
 
-        sdsl::util::bit_compress(g[level].rule);
+        // Encode the rules, LCPs and rule suffix lengths
+        rules.build_rules(g[level].rule, sdsl::bits::hi(K) + 1,
+                          [&](uint64_t i) { return stored_symbol(s, i, level); });
+        for (uint64_t r = 0; r < rules.size(); r++) {
+            g[level].lcp.encode(rules.lcp(r));
+            g[level].rule_suffix_length.encode(rules.suffix_length(r));
+        }
+        rules.clear();
         g[level].lcp.encode();
         g[level].rule_suffix_length.encode();
 
@@ -249,8 +237,7 @@ char *decode() override {
         // Copy the first elements (not part of a LMS substring)
         g[level].tail.resize(first);
         for (j = 0; j < first; j++) {
-            g[level].tail[j] =
-                (uint64_t)(cs == sizeof(char) ? ((char *)s)[j] : s[j]);
+            g[level].tail[j] = stored_symbol(s, j, level);
         }
         sdsl::util::bit_compress(g[level].tail);
 
@@ -291,7 +278,8 @@ char *decode() override {
         if (name + 1 < n1 && !premature_stop) {
             g[level].string_size = n;
             g[level].alphabet_size = K;
-            gc_is((int_t *)s1, SA1, n1, name + 1, sizeof(int_t), level + 1);
+            gc_is((int_t *)s1, SA1, n1, name + 1,
+                  narrow_reduced_string(s1, n1, name + 1), level + 1);
         } else { // generate the suffix array of s1 directly
             if (premature_stop) {
 #ifdef REPORT
@@ -300,7 +288,7 @@ char *decode() override {
                 reduced_string.resize(n);
                 for (j = 0; j < n; j++) {
                     // Copy the reduced substring
-                    reduced_string[j] = s[j];
+                    reduced_string[j] = stored_symbol(s, j, level);
                 }
                 g.pop_back();
             } else {
@@ -330,27 +318,17 @@ class gcis_s8b_pointers : public gcis_dictionary<gcis_s8b_codec> {
         char *str = 0;
         for (int64_t i = g.size() - 1; i >= 0; i--) {
             sdsl::int_vector<> next_r_string;
-            gcis_s8b_pointers_codec_level gd = std::move(g[i].decompress());
+            std::shared_ptr<gcis_s8b_pointers_codec_level> gd =
+                decompressed_level(i);
             next_r_string.width(sdsl::bits::hi(g[i].alphabet_size - 1) + 1);
             next_r_string.resize(g[i].string_size);
-            uint64_t l = 0;
             if (i == 0) {
                 // Convert the reduced string in the original text
                 str = new char[g[i].string_size];
-                for (auto t : g[i].tail) {
-                    str[l++] = (char)t;
-                }
-                for (uint64_t j = 0; j < r_string.size(); j++) {
-                    gd.expand_rule(r_string[j], str, l);
-                }
+                expand_level(*gd, g[i].tail, r_string, str);
             } else {
                 // Convert the reduced string in the previous reduced string
-                for (uint64_t j = 0; j < g[i].tail.size(); j++) {
-                    next_r_string[l++] = g[i].tail[j];
-                }
-                for (uint64_t j = 0; j < r_string.size(); j++) {
-                    gd.expand_rule(r_string[j], next_r_string, l);
-                }
+                expand_level(*gd, g[i].tail, r_string, next_r_string);
                 r_string = std::move(next_r_string);
             }
         }
@@ -39,6 +39,12 @@ class gcis_s8b_pointers_codec_level {
     vector<uint_t> rule_pos;
 
   public:
+  uint64_t size_in_bytes();
+
+  // Position of rule rule_num in rule and its length
+  uint64_t rule_start(uint64_t rule_num);
+  uint64_t rule_length(uint64_t rule_num);
+
   void expand_rule(uint64_t rule_num, sdsl::int_vector<>& r_string, uint64_t& l);
   void expand_rule(uint64_t rule_num,char* s, uint64_t& l);
 };
@@ -0,0 +1,404 @@
+//
+// Building blocks of the semi-external decode_saca_external and decode_bwt.
+//
+
+#ifndef GC_IS_GCIS_SACA_EXTERNAL_HPP
+#define GC_IS_GCIS_SACA_EXTERNAL_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define BUCKET_FILE_MIN_CHUNK 1024 // fewest entries spilled to disk at once
+#define EXTERNAL_WRITE_BUFFER 65536 // entries written at once to the output
+
+/**
+ * @brief Layouts of the LCP array written by decode_saca_external, after
+ * the number m of suffixes (without the sentinel) as a size_t.
+ */
+enum gcis_lcp_format {
+    // One int_t per suffix
+    GCIS_LCP_INT,
+    // One byte per suffix, 255 for the values of 255 or more, which are
+    // listed in a separate file as (entry, value) pairs of a uint_t and an
+    // int_t, entry counting from 0 after the sentinel
+    GCIS_LCP_BYTE,
+    // The PLCP bitvector: 2m bits, as 64-bit words, with bit 2i+PLCP[i] set
+    // for every text position i, PLCP[i] being the LCP of the suffix i
+    GCIS_LCP_PLCP
+};
+
+/**
+ * @brief Thrown by saca_external when its memory budget is too small for
+ * an array it needs.
+ */
+class gcis_memory_error : public std::runtime_error {
+  public:
+    gcis_memory_error(const std::string &what, uint64_t bytes, uint64_t left)
+        : std::runtime_error(what + ": " + std::to_string(bytes) +
+                             " bytes needed, " + std::to_string(left) +
+                             " bytes of the memory budget left") {}
+};
+
+/**
+ * @brief Bytes of memory in use out of a budget, counted by the caller as
+ * it allocates and frees its arrays. take() throws gcis_memory_error
+ * instead of going over the budget.
+ */
+class gcis_memory_budget {
+  public:
+    explicit gcis_memory_budget(uint64_t budget) : m_budget(budget) {}
+
+    void take(uint64_t bytes, const std::string &what) {
+        if (bytes > left())
+            throw gcis_memory_error(what, bytes, left());
+        m_used += bytes;
+    }
+
+    void give(uint64_t bytes) { m_used -= bytes; }
+
+    uint64_t left() const { return m_budget - m_used; }
+
+  private:
+    uint64_t m_budget;
+    uint64_t m_used = 0;
+};
+
+// Writes n bytes to the file descriptor fd. Throws std::runtime_error if a
+// write fails.
+inline void write_fd(int fd, const char *p, uint64_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w < 0)
+            throw std::runtime_error(std::string("write: ") + strerror(errno));
+        p += w;
+        n -= w;
+    }
+}
+
+/**
+ * @brief K lists that grow at their end, such as the buckets of a suffix
+ * array being induced, kept in a temporary file.
+ *
+ * Each list buffers up to chunk entries in memory and appends the buffer to
+ * the file when it is full, so the file holds whole chunks of the lists.
+ * Reading a list forward or backward with at() reads each of its chunks
+ * once. The file is created in a given directory and unlinked at once, so
+ * it is gone when the object is destroyed or the program ends.
+ */
+template <class entry_t> class gcis_bucket_file {
+  public:
+    gcis_bucket_file(uint64_t K, uint64_t chunk, const std::string &dir)
+        : m_lists(K), m_chunk(chunk) {
+        std::string path = (dir.empty() ? "." : dir) + "/gcis-XXXXXX";
+        std::vector<char> name(path.begin(), path.end());
+        name.push_back(0);
+        m_fd = mkstemp(name.data());
+        if (m_fd < 0)
+            throw std::runtime_error(path + ": " + strerror(errno));
+        unlink(name.data());
+    }
+
+    ~gcis_bucket_file() { close(m_fd); }
+
+    gcis_bucket_file(const gcis_bucket_file &) = delete;
+    gcis_bucket_file &operator=(const gcis_bucket_file &) = delete;
+
+    void push(uint64_t c, const entry_t &e) {
+        list &l = m_lists[c];
+        if (l.buf.size() == m_chunk) {
+            uint64_t bytes = m_chunk * sizeof(entry_t);
+            io(true, (char *)l.buf.data(), bytes, m_file_size);
+            l.chunks.push_back(m_file_size);
+            m_file_size += bytes;
+            l.buf.clear();
+        } else if (l.buf.capacity() == 0) {
+            l.buf.reserve(m_chunk);
+        }
+        l.buf.push_back(e);
+    }
+
+    uint64_t size(uint64_t c) const {
+        return m_lists[c].chunks.size() * m_chunk + m_lists[c].buf.size();
+    }
+
+    // Entry k of list c, k < size(c)
+    entry_t at(uint64_t c, uint64_t k) {
+        const list &l = m_lists[c];
+        uint64_t i = k / m_chunk;
+        if (i == l.chunks.size())
+            return l.buf[k % m_chunk];
+        if (c != m_read_list || i != m_read_chunk) {
+            m_read.resize(m_chunk);
+            io(false, (char *)m_read.data(), m_chunk * sizeof(entry_t),
+               l.chunks[i]);
+            m_read_list = c;
+            m_read_chunk = i;
+        }
+        return m_read[k % m_chunk];
+    }
+
+  private:
+    struct list {
+        // Last entries, and the file offset of each chunk before them
+        std::vector<entry_t> buf;
+        std::vector<uint64_t> chunks;
+    };
+
+    std::vector<list> m_lists;
+    uint64_t m_chunk;
+    int m_fd;
+    uint64_t m_file_size = 0;
+    // The chunk last read by at()
+    std::vector<entry_t> m_read;
+    uint64_t m_read_list = UINT64_MAX, m_read_chunk = UINT64_MAX;
+
+    void io(bool write, char *p, uint64_t n, uint64_t offset) {
+        while (n > 0) {
+            ssize_t r = write ? pwrite(m_fd, p, n, offset)
+                              : pread(m_fd, p, n, offset);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0) {
+                throw std::runtime_error(
+                    std::string(write ? "pwrite: " : "pread: ") +
+                    (r < 0 ? strerror(errno) : "unexpected end of file"));
+            }
+            p += r;
+            n -= r;
+            offset += r;
+        }
+    }
+};
+
+/**
+ * @brief Consecutive ranges of the symbols of a string, its buckets, which
+ * induce_level_external sorts one range at a time. A range is a single
+ * symbol, or at most cap symbols that start at most cap suffixes in all,
+ * so that their suffixes are sorted in memory.
+ *
+ * The symbols are counted by bins of consecutive symbols, about 64 bins
+ * per cap suffixes, and only the bins of more than cap suffixes are
+ * counted again symbol by symbol.
+ */
+class gcis_symbol_groups {
+  public:
+    template <class string_t>
+    gcis_symbol_groups(const string_t &s, uint64_t K, uint64_t cap) {
+        uint64_t n = s.size(), nb = bins(n, K, cap), w = (K + nb - 1) / nb;
+        std::vector<uint64_t> bin(nb, 0);
+        for (uint64_t i = 0; i < n; i++) {
+            bin[s[i] / w]++;
+        }
+        // First counter of each bin counted by symbol
+        std::vector<uint64_t> large(nb, UINT64_MAX), count;
+        for (uint64_t b = 0; b < nb; b++) {
+            if (bin[b] > cap && w > 1) {
+                large[b] = count.size();
+                count.resize(count.size() + w, 0);
+            }
+        }
+        if (!count.empty()) {
+            for (uint64_t i = 0; i < n; i++) {
+                uint64_t b = s[i] / w;
+                if (large[b] != UINT64_MAX)
+                    count[large[b] + s[i] % w]++;
+            }
+        }
+        m_begin.assign(1, 0);
+        m_count.assign(1, 0);
+        // Adds the symbols [a, b), which start m suffixes, to the last range
+        // or to a new one
+        auto add = [&](uint64_t a, uint64_t b, uint64_t m) {
+            if (a > m_begin.back() &&
+                (m_count.back() + m > cap || b - m_begin.back() > cap)) {
+                m_begin.push_back(a);
+                m_count.push_back(0);
+            }
+            m_count.back() += m;
+        };
+        for (uint64_t b = 0; b < nb; b++) {
+            uint64_t a = b * w, e = std::min(a + w, K);
+            if (large[b] == UINT64_MAX) {
+                add(a, e, bin[b]);
+                continue;
+            }
+            for (uint64_t c = a; c < e; c++) {
+                add(c, c + 1, count[large[b] + c - a]);
+            }
+        }
+        m_begin.push_back(K);
+    }
+
+    // Upper bound of the bytes used while the ranges are built and after
+    static uint64_t bytes(uint64_t n, uint64_t K, uint64_t cap) {
+        uint64_t nb = bins(n, K, cap), w = (K + nb - 1) / nb;
+        return 2 * nb * sizeof(uint64_t) + n / cap * w * sizeof(uint64_t) +
+               2 * (2 * (n + K) / cap + 3) * sizeof(uint64_t);
+    }
+
+    uint64_t size() const { return m_count.size(); }
+
+    // Symbols [begin(r), end(r)) of range r
+    uint64_t begin(uint64_t r) const { return m_begin[r]; }
+    uint64_t end(uint64_t r) const { return m_begin[r + 1]; }
+
+    // Suffixes starting with a symbol of range r
+    uint64_t count(uint64_t r) const { return m_count[r]; }
+
+    // Range of symbol c
+    uint64_t of(uint64_t c) const {
+        return std::upper_bound(m_begin.begin(), m_begin.end(), c) -
+               m_begin.begin() - 1;
+    }
+
+  private:
+    std::vector<uint64_t> m_begin, m_count;
+
+    static uint64_t bins(uint64_t n, uint64_t K, uint64_t cap) {
+        return std::max<uint64_t>(std::min<uint64_t>(K, 64 * (n / cap + 1)), 1);
+    }
+};
+
+/**
+ * @brief The suffixes of a range of buckets (see gcis_symbol_groups)
+ * sorted in memory by induce_level_external: those induced into the range
+ * before the scan reached it, stably sorted by bucket, followed in each
+ * bucket by those the range induces into itself.
+ */
+template <class entry_t> class gcis_group_buckets {
+  public:
+    /**
+     * @brief Loads the suffixes of list r of f, which start with the
+     * symbols [a, b) of s, with room for count suffixes in all.
+     */
+    template <class string_t>
+    void load(const string_t &s, uint64_t a, uint64_t b,
+              gcis_bucket_file<entry_t> &f, uint64_t r, uint64_t count) {
+        uint64_t m = f.size(r);
+        m_a = a;
+        m_start.assign(b - a + 1, 0);
+        for (uint64_t k = 0; k < m; k++) {
+            m_start[s[f.at(r, k)] - a + 1]++;
+        }
+        for (uint64_t c = 0; c < b - a; c++) {
+            m_start[c + 1] += m_start[c];
+        }
+        m_sorted.resize(m);
+        m_head.assign(m_start.begin(), m_start.end() - 1);
+        for (uint64_t k = 0; k < m; k++) {
+            entry_t v = f.at(r, k);
+            m_sorted[m_head[s[v] - a]++] = v;
+        }
+        m_head.assign(b - a, UINT64_MAX);
+        m_tail.assign(b - a, UINT64_MAX);
+        m_entry.clear();
+        m_next.clear();
+        m_entry.reserve(count - m);
+        m_next.reserve(count - m);
+    }
+
+    // Bytes used by a range of up to cap symbols and cap suffixes
+    static uint64_t bytes(uint64_t cap) {
+        return cap * (2 * sizeof(entry_t) + 4 * sizeof(uint64_t)) +
+               sizeof(uint64_t);
+    }
+
+    // Appends v to bucket c
+    void push(uint64_t c, entry_t v) {
+        uint64_t i = m_entry.size();
+        m_entry.push_back(v);
+        m_next.push_back(UINT64_MAX);
+        if (m_head[c - m_a] == UINT64_MAX)
+            m_head[c - m_a] = i;
+        else
+            m_next[m_tail[c - m_a]] = i;
+        m_tail[c - m_a] = i;
+    }
+
+    // Calls f(v) for the suffixes of bucket c in order, including those
+    // appended by f
+    template <class f_t> void scan(uint64_t c, f_t f) {
+        for (uint64_t i = m_start[c - m_a]; i < m_start[c - m_a + 1]; i++) {
+            f(m_sorted[i]);
+        }
+        for (uint64_t i = m_head[c - m_a]; i != UINT64_MAX; i = m_next[i]) {
+            f(m_entry[i]);
+        }
+    }
+
+  private:
+    uint64_t m_a = 0;
+    // Loaded suffixes of bucket m_a+c: m_sorted[m_start[c], m_start[c+1])
+    std::vector<uint64_t> m_start;
+    std::vector<entry_t> m_sorted;
+    // Appended suffixes, linked by bucket
+    std::vector<uint64_t> m_head, m_tail, m_next;
+    std::vector<entry_t> m_entry;
+};
+
+/**
+ * @brief Minimum of the LCP values of a suffix array scan from a given
+ * entry to the last one, used to induce the LCP of the suffixes placed by
+ * the scan.
+ *
+ * Only the entries whose LCP is smaller than that of every later entry are
+ * kept, so the minimum from entry idx on is the LCP of the first entry kept
+ * at or after idx. compact() drops the entries that none of the pending
+ * queries can return, bounding the stack by the number of buckets.
+ */
+class gcis_lcp_stack {
+  public:
+    void push(uint64_t idx, int64_t lcp) {
+        while (!m_stack.empty() && m_stack.back().lcp >= lcp)
+            m_stack.pop_back();
+        m_stack.push_back({idx, lcp});
+    }
+
+    // Minimum LCP of the entries pushed from index idx on, which must not
+    // be past the last one
+    int64_t min_from(uint64_t idx) const { return find(idx)->lcp; }
+
+    uint64_t size() const { return m_stack.size(); }
+
+    void clear() { m_stack.clear(); }
+
+    // Keeps the entries returned by min_from(idx) for each idx in from,
+    // where UINT64_MAX stands for no query
+    void compact(const std::vector<uint64_t> &from) {
+        std::vector<uint64_t> keep;
+        for (uint64_t idx : from) {
+            if (idx != UINT64_MAX && find(idx) != m_stack.end())
+                keep.push_back(find(idx) - m_stack.begin());
+        }
+        std::sort(keep.begin(), keep.end());
+        keep.erase(std::unique(keep.begin(), keep.end()), keep.end());
+        for (uint64_t k = 0; k < keep.size(); k++) {
+            m_stack[k] = m_stack[keep[k]];
+        }
+        m_stack.resize(keep.size());
+    }
+
+  private:
+    struct entry {
+        uint64_t idx;
+        int64_t lcp;
+    };
+    std::vector<entry> m_stack;
+
+    std::vector<entry>::const_iterator find(uint64_t idx) const {
+        return std::lower_bound(
+            m_stack.begin(), m_stack.end(), idx,
+            [](const entry &e, uint64_t i) { return e.idx < i; });
+    }
+};
+
+#endif // GC_IS_GCIS_SACA_EXTERNAL_HPP
@@ -0,0 +1,647 @@
+//
+// Self-index answering count and locate queries on the GC-IS grammar.
+//
+
+#ifndef GC_IS_GCIS_SEARCH_INDEX_HPP
+#define GC_IS_GCIS_SEARCH_INDEX_HPP
+
+#include "sdsl/bit_vectors.hpp"
+#include "sdsl/int_vector.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Wavelet matrix over a sequence of integers, reporting the
+ * positions of a range whose values lie in a given range.
+ */
+class gcis_wavelet_matrix {
+  public:
+    gcis_wavelet_matrix() = default;
+    gcis_wavelet_matrix(const gcis_wavelet_matrix &) = delete;
+    gcis_wavelet_matrix &operator=(const gcis_wavelet_matrix &) = delete;
+    gcis_wavelet_matrix(gcis_wavelet_matrix &&) = default;
+    gcis_wavelet_matrix &operator=(gcis_wavelet_matrix &&) = default;
+
+    void build(const std::vector<uint64_t> &v) {
+        uint64_t n = v.size();
+        uint64_t max_value = 0;
+        for (uint64_t x : v) {
+            max_value = std::max<uint64_t>(max_value, x);
+        }
+        m_levels = max_value ? sdsl::bits::hi(max_value) + 1 : 1;
+        m_bits.assign(m_levels, sdsl::bit_vector(n, 0));
+        m_zeros.assign(m_levels, 0);
+        // Original position of each entry in the order of the current level
+        std::vector<uint64_t> order(n), next(n);
+        for (uint64_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+        for (uint64_t l = 0; l < m_levels; l++) {
+            uint64_t bit = m_levels - 1 - l;
+            for (uint64_t i = 0; i < n; i++) {
+                m_bits[l][i] = (v[order[i]] >> bit) & 1;
+            }
+            uint64_t k = 0;
+            for (uint64_t i = 0; i < n; i++) {
+                if (!m_bits[l][i])
+                    next[k++] = order[i];
+            }
+            m_zeros[l] = k;
+            for (uint64_t i = 0; i < n; i++) {
+                if (m_bits[l][i])
+                    next[k++] = order[i];
+            }
+            order.swap(next);
+        }
+        m_rank.clear();
+        for (uint64_t l = 0; l < m_levels; l++) {
+            m_rank.emplace_back(&m_bits[l]);
+        }
+        m_position = sdsl::int_vector<>(n);
+        for (uint64_t i = 0; i < n; i++) {
+            m_position[i] = order[i];
+        }
+        sdsl::util::bit_compress(m_position);
+    }
+
+    // Calls report(i) for every i in [l, r) with a <= v[i] < b
+    template <class report_f>
+    void report(uint64_t l, uint64_t r, uint64_t a, uint64_t b,
+                report_f report) const {
+        if (l < r && a < b)
+            report_level(0, l, r, 0, a, b, report);
+    }
+
+    uint64_t size_in_bytes() const {
+        uint64_t bytes = sdsl::size_in_bytes(m_position);
+        for (uint64_t l = 0; l < m_levels; l++) {
+            bytes += sdsl::size_in_bytes(m_bits[l]) +
+                     sdsl::size_in_bytes(m_rank[l]);
+        }
+        return bytes;
+    }
+
+  private:
+    uint64_t m_levels = 0;
+    std::vector<sdsl::bit_vector> m_bits;
+    std::vector<sdsl::bit_vector::rank_1_type> m_rank;
+    // Entries with a 0 bit at each level, which come first at the next one
+    std::vector<uint64_t> m_zeros;
+    // Original position of each entry in the order below the last level
+    sdsl::int_vector<> m_position;
+
+    // [l, r) at level level holds the values starting with the bits prefix
+    template <class report_f>
+    void report_level(uint64_t level, uint64_t l, uint64_t r, uint64_t prefix,
+                      uint64_t a, uint64_t b, report_f &report) const {
+        uint64_t width = m_levels - level;
+        uint64_t lo = prefix << width;
+        uint64_t hi = lo + (1ULL << width);
+        if (hi <= a || lo >= b)
+            return;
+        if (level == m_levels) {
+            for (uint64_t i = l; i < r; i++) {
+                report(m_position[i]);
+            }
+            return;
+        }
+        uint64_t l1 = m_rank[level](l), r1 = m_rank[level](r);
+        if (l - l1 < r - r1) {
+            report_level(level + 1, l - l1, r - r1, prefix << 1, a, b, report);
+        }
+        if (l1 < r1) {
+            uint64_t z = m_zeros[level];
+            report_level(level + 1, z + l1, z + r1, (prefix << 1) | 1, a, b,
+                         report);
+        }
+    }
+};
+
+/**
+ * @brief Grammar self-index answering count and locate queries on the
+ * rules of a GC-IS dictionary, without decoding the text.
+ *
+ * The grammar is seen as a tree whose root has as children the tails of
+ * the levels followed by the reduced string, and whose inner nodes are the
+ * rules. The first boundary between two children of a node that an
+ * occurrence of a pattern P crosses, in the deepest node covering it, is
+ * its primary occurrence. A rule ends at an LMS position of the text, so
+ * P is split only at offset 1 (rules of terminals) and at the positions
+ * that are LMS in the text at any occurrence of P, which are known from P
+ * alone. For each split, the boundaries whose left child ends with the
+ * first part and whose right children start with the second one are found
+ * by two binary searches and a range query on a wavelet matrix. The other
+ * occurrences of the node are reached through the rules that contain it.
+ *
+ * The index is built from a loaded dictionary with levels whose rules can
+ * be read with rule_start and rule_length (Elias-Fano, gap and simple8b
+ * codecs), holds its own copy of the rules and is not stored in the file.
+ */
+class gcis_search_index {
+  public:
+    gcis_search_index() = default;
+    gcis_search_index(const gcis_search_index &) = delete;
+    gcis_search_index &operator=(const gcis_search_index &) = delete;
+    gcis_search_index(gcis_search_index &&) = default;
+    gcis_search_index &operator=(gcis_search_index &&) = default;
+
+    template <class dict_t> void build(dict_t &d) {
+        std::vector<uint64_t> rhs, start(1, 0);
+        collect_rules(d.g, d.reduced_string, rhs, start);
+        build(rhs, start);
+    }
+
+    // Length of the indexed text
+    uint64_t text_length() const { return length(root()); }
+
+    // Number of occurrences of pattern in the text (0 for an empty pattern)
+    uint64_t count(const std::string &pattern) const {
+        uint64_t total = 0;
+        if (pattern.size() == 1)
+            return m_char_occ[(unsigned char)pattern[0]];
+        primary_occurrences(pattern, [&](uint64_t x, uint64_t) {
+            total += m_occ[x - FIRST_RULE];
+        });
+        return total;
+    }
+
+    // Positions of the occurrences of pattern in the text, sorted
+    std::vector<uint64_t> locate(const std::string &pattern) const {
+        std::vector<uint64_t> occ;
+        if (pattern.size() == 1) {
+            locate_char((unsigned char)pattern[0], occ);
+        } else {
+            primary_occurrences(pattern, [&](uint64_t x, uint64_t offset) {
+                report(x, offset, occ);
+            });
+        }
+        std::sort(occ.begin(), occ.end());
+        return occ;
+    }
+
+    uint64_t size_in_bytes() const {
+        return sdsl::size_in_bytes(m_rhs) + sdsl::size_in_bytes(m_start) +
+               sdsl::size_in_bytes(m_length) + sdsl::size_in_bytes(m_occ) +
+               sdsl::size_in_bytes(m_parent_start) +
+               sdsl::size_in_bytes(m_parent) +
+               sdsl::size_in_bytes(m_parent_offset) +
+               sdsl::size_in_bytes(m_left) +
+               sdsl::size_in_bytes(m_point_pos) +
+               sdsl::size_in_bytes(m_point_offset) + m_grid.size_in_bytes() +
+               m_char_occ.size() * sizeof(uint64_t);
+    }
+
+  private:
+    // Symbols below FIRST_RULE are bytes of the text, the others rules
+    static const uint64_t FIRST_RULE = 256;
+
+    // Right-hand sides of the rules, the last one being the root
+    sdsl::int_vector<> m_rhs;
+    // Rule x is m_rhs[m_start[x - FIRST_RULE], m_start[x - FIRST_RULE + 1])
+    sdsl::int_vector<> m_start;
+    // Expansion length and number of occurrences in the tree of each rule
+    sdsl::int_vector<> m_length;
+    sdsl::int_vector<> m_occ;
+    std::vector<uint64_t> m_char_occ;
+    // Rules whose right-hand side ends with terminals, except the root
+    uint64_t m_terminal_rules_end = FIRST_RULE;
+    // Rule x occurs in the rules m_parent[k], at offset m_parent_offset[k]
+    // of their expansions, for k in m_parent_start[x - FIRST_RULE, +1)
+    sdsl::int_vector<> m_parent_start;
+    sdsl::int_vector<> m_parent;
+    sdsl::int_vector<> m_parent_offset;
+    // Symbols left of a boundary, sorted by their reversed expansions
+    sdsl::int_vector<> m_left;
+    // Boundaries sorted by the expansion of the symbols right of them: the
+    // position in m_rhs of the first one and its offset in its rule
+    sdsl::int_vector<> m_point_pos;
+    sdsl::int_vector<> m_point_offset;
+    // Rank in m_left of the symbol left of each boundary
+    gcis_wavelet_matrix m_grid;
+
+    uint64_t root() const { return FIRST_RULE + m_start.size() - 2; }
+
+    uint64_t length(uint64_t x) const {
+        return x < FIRST_RULE ? 1 : (uint64_t)m_length[x - FIRST_RULE];
+    }
+
+    // Rule whose right-hand side holds m_rhs[pos]
+    uint64_t rule_at(uint64_t pos) const {
+        return FIRST_RULE + (std::upper_bound(m_start.begin(), m_start.end(),
+                                              pos) -
+                             m_start.begin() - 1);
+    }
+
+    /**
+     * @brief Lists the rules with global symbols: bytes below FIRST_RULE,
+     * then the rules of level 0, 1, ... and the root, whose right-hand
+     * side is the tail of every level and the reduced string without the
+     * sentinel. Rule r is rhs[start[r], start[r + 1]).
+     */
+    template <class codec_t>
+    static void collect_rules(std::vector<codec_t> &g,
+                              const sdsl::int_vector<> &reduced_string,
+                              std::vector<uint64_t> &rhs,
+                              std::vector<uint64_t> &start) {
+        // base[i] is the symbol of rule 0 of level i - 1
+        std::vector<uint64_t> base(g.size() + 1, 0);
+        base[0] = 0;
+        uint64_t next = FIRST_RULE;
+        for (uint64_t i = 0; i < g.size(); i++) {
+            uint64_t n_rules = 0;
+            if (i + 1 < g.size()) {
+                n_rules = (uint64_t)g[i + 1].alphabet_size;
+            } else {
+                for (uint64_t c : reduced_string) {
+                    n_rules = std::max<uint64_t>(n_rules, c + 1);
+                }
+            }
+            base[i + 1] = next;
+            auto level = g[i].decompress();
+            for (uint64_t r = 0; r < n_rules; r++) {
+                uint64_t from = level.rule_start(r);
+                uint64_t len = level.rule_length(r);
+                for (uint64_t k = 0; k < len; k++) {
+                    rhs.push_back(base[i] + level.rule[from + k]);
+                }
+                start.push_back(rhs.size());
+            }
+            next += n_rules;
+        }
+        for (uint64_t i = 0; i < g.size(); i++) {
+            for (uint64_t c : g[i].tail) {
+                rhs.push_back(base[i] + c);
+            }
+        }
+        // the last symbol expands to the sentinel
+        for (uint64_t k = 0; k + 1 < reduced_string.size(); k++) {
+            rhs.push_back(base[g.size()] + reduced_string[k]);
+        }
+        start.push_back(rhs.size());
+    }
+
+    void build(std::vector<uint64_t> &rhs, const std::vector<uint64_t> &start) {
+        uint64_t n_rules = start.size() - 1;
+        uint64_t root_rule = n_rules - 1;
+        pack_int_vector(rhs, m_rhs);
+        pack_int_vector(start, m_start);
+
+        m_terminal_rules_end = FIRST_RULE;
+        while (m_terminal_rules_end - FIRST_RULE < root_rule &&
+               rhs[start[m_terminal_rules_end - FIRST_RULE]] < FIRST_RULE) {
+            m_terminal_rules_end++;
+        }
+
+        // Rules only refer to rules listed before them
+        std::vector<uint64_t> len(n_rules, 0);
+        for (uint64_t r = 0; r < n_rules; r++) {
+            for (uint64_t k = start[r]; k < start[r + 1]; k++) {
+                uint64_t x = rhs[k];
+                len[r] += x < FIRST_RULE ? 1 : len[x - FIRST_RULE];
+            }
+        }
+        pack_int_vector(len, m_length);
+
+        std::vector<uint64_t> occ(n_rules, 0);
+        m_char_occ.assign(FIRST_RULE, 0);
+        occ[root_rule] = 1;
+        for (uint64_t r = n_rules; r-- > 0;) {
+            for (uint64_t k = start[r]; k < start[r + 1]; k++) {
+                uint64_t x = rhs[k];
+                if (x < FIRST_RULE)
+                    m_char_occ[x] += occ[r];
+                else
+                    occ[x - FIRST_RULE] += occ[r];
+            }
+        }
+        pack_int_vector(occ, m_occ);
+
+        std::vector<uint64_t> parent_start(n_rules + 1, 0);
+        for (uint64_t x : rhs) {
+            if (x >= FIRST_RULE)
+                parent_start[x - FIRST_RULE + 1]++;
+        }
+        for (uint64_t r = 0; r < n_rules; r++) {
+            parent_start[r + 1] += parent_start[r];
+        }
+        std::vector<uint64_t> parent(parent_start[n_rules]);
+        std::vector<uint64_t> parent_offset(parent_start[n_rules]);
+        std::vector<uint64_t> fill(parent_start.begin(), parent_start.end() - 1);
+        for (uint64_t r = 0; r < n_rules; r++) {
+            uint64_t offset = 0;
+            for (uint64_t k = start[r]; k < start[r + 1]; k++) {
+                uint64_t x = rhs[k];
+                if (x >= FIRST_RULE) {
+                    uint64_t k = fill[x - FIRST_RULE]++;
+                    parent[k] = FIRST_RULE + r;
+                    parent_offset[k] = offset;
+                }
+                offset += x < FIRST_RULE ? 1 : len[x - FIRST_RULE];
+            }
+        }
+        pack_int_vector(parent_start, m_parent_start);
+        pack_int_vector(parent, m_parent);
+        pack_int_vector(parent_offset, m_parent_offset);
+        parent.clear();
+        parent.shrink_to_fit();
+        parent_offset.clear();
+        parent_offset.shrink_to_fit();
+
+        // Boundaries between consecutive children, and the symbols left of
+        // them
+        struct point {
+            uint64_t pos, end, offset;
+        };
+        std::vector<point> points;
+        std::vector<uint64_t> left;
+        for (uint64_t r = 0; r < n_rules; r++) {
+            uint64_t offset = 0;
+            for (uint64_t k = start[r] + 1; k < start[r + 1]; k++) {
+                uint64_t x = rhs[k - 1];
+                offset += x < FIRST_RULE ? 1 : len[x - FIRST_RULE];
+                points.push_back({k, start[r + 1], offset});
+                left.push_back(x);
+            }
+        }
+        rhs.clear();
+        rhs.shrink_to_fit();
+        // Lengths of the runs of equal symbols of m_rhs ending at each
+        // position, then of those starting at it, which the comparisons
+        // skip at once
+        sdsl::int_vector<> run(m_rhs.size(), 1,
+                               sdsl::bits::hi(m_rhs.size()) + 1);
+        for (uint64_t k = 1; k < m_rhs.size(); k++) {
+            if (m_rhs[k] == m_rhs[k - 1])
+                run[k] = run[k - 1] + 1;
+        }
+        std::sort(left.begin(), left.end());
+        left.erase(std::unique(left.begin(), left.end()), left.end());
+        std::sort(left.begin(), left.end(), [&](uint64_t a, uint64_t b) {
+            return compare_keys(cursor(*this, a, false),
+                                cursor(*this, b, false), run) < 0;
+        });
+        pack_int_vector(left, m_left);
+        std::vector<uint64_t> left_rank(FIRST_RULE + n_rules);
+        for (uint64_t k = 0; k < left.size(); k++) {
+            left_rank[left[k]] = k;
+        }
+
+        for (uint64_t k = m_rhs.size(); k-- > 0;) {
+            bool same = k + 1 < m_rhs.size() && m_rhs[k] == m_rhs[k + 1];
+            run[k] = same ? run[k + 1] + 1 : 1;
+        }
+        std::sort(points.begin(), points.end(),
+                  [&](const point &a, const point &b) {
+                      return compare_keys(cursor(*this, a.pos, a.end, true),
+                                          cursor(*this, b.pos, b.end, true),
+                                          run) < 0;
+                  });
+        std::vector<uint64_t> values(points.size()), pos(points.size()),
+            offset(points.size());
+        for (uint64_t k = 0; k < points.size(); k++) {
+            values[k] = left_rank[m_rhs[points[k].pos - 1]];
+            pos[k] = points[k].pos;
+            offset[k] = points[k].offset;
+        }
+        pack_int_vector(pos, m_point_pos);
+        pack_int_vector(offset, m_point_offset);
+        m_grid.build(values);
+    }
+
+    /**
+     * @brief Reads the expansion of a sequence of symbols forward or
+     * backward, expanding the rules only when their symbols are needed.
+     */
+    class cursor {
+      public:
+        // The expansion of m_rhs[from, to)
+        cursor(const gcis_search_index &index, uint64_t from, uint64_t to,
+               bool forward)
+            : m_index(index), m_forward(forward) {
+            if (from < to)
+                m_frames.push_back({from, to});
+        }
+
+        // The expansion of the symbol x
+        cursor(const gcis_search_index &index, uint64_t x, bool forward)
+            : m_index(index), m_forward(forward), m_head(x) {}
+
+        bool empty() const { return m_head == NONE && m_frames.empty(); }
+
+        uint64_t peek() const {
+            if (m_head != NONE)
+                return m_head;
+            const frame &f = m_frames.back();
+            return m_index.m_rhs[m_forward ? f.from : f.to - 1];
+        }
+
+        // Skips the next n symbols, n > 1 only within a right-hand side
+        void skip(uint64_t n = 1) {
+            if (m_head != NONE) {
+                m_head = NONE;
+                return;
+            }
+            frame &f = m_frames.back();
+            if (m_forward)
+                f.from += n;
+            else
+                f.to -= n;
+            if (f.from == f.to)
+                m_frames.pop_back();
+        }
+
+        // Copies of the next symbol in a row, from the lengths of the runs
+        // of m_rhs in the direction read (see build)
+        uint64_t repeats(const sdsl::int_vector<> &run) const {
+            if (m_head != NONE)
+                return 1;
+            const frame &f = m_frames.back();
+            return std::min<uint64_t>(run[m_forward ? f.from : f.to - 1],
+                                      f.to - f.from);
+        }
+
+        // Replaces the next symbol, a rule, by its right-hand side
+        void expand() {
+            uint64_t r = peek() - FIRST_RULE;
+            skip();
+            m_frames.push_back({m_index.m_start[r], m_index.m_start[r + 1]});
+        }
+
+        // Next byte of the expansion
+        uint64_t next() {
+            while (peek() >= FIRST_RULE) {
+                expand();
+            }
+            uint64_t c = peek();
+            skip();
+            return c;
+        }
+
+      private:
+        static const uint64_t NONE = ~0ULL;
+        struct frame {
+            uint64_t from, to;
+        };
+        const gcis_search_index &m_index;
+        bool m_forward;
+        uint64_t m_head = NONE;
+        std::vector<frame> m_frames;
+    };
+
+    // Compares two expansions, skipping the symbols they share a run at a
+    // time, so that long runs do not make the sorts of build quadratic
+    int compare_keys(cursor a, cursor b, const sdsl::int_vector<> &run) const {
+        while (!a.empty() && !b.empty()) {
+            uint64_t x = a.peek(), y = b.peek();
+            if (x == y) {
+                uint64_t n = std::min(a.repeats(run), b.repeats(run));
+                a.skip(n);
+                b.skip(n);
+            } else if (x < FIRST_RULE && y < FIRST_RULE) {
+                return x < y ? -1 : 1;
+            } else if (y < FIRST_RULE ||
+                       (x >= FIRST_RULE && length(x) >= length(y))) {
+                a.expand();
+            } else {
+                b.expand();
+            }
+        }
+        return a.empty() ? (b.empty() ? 0 : -1) : 1;
+    }
+
+    // Compares p[0], p[step], ... (n bytes) with the expansion read by key:
+    // 0 if they are a prefix of it, else the sign of their difference
+    static int compare_prefix(const unsigned char *p, uint64_t n,
+                              int64_t step, cursor key) {
+        for (uint64_t k = 0; k < n; k++) {
+            if (key.empty())
+                return 1;
+            uint64_t c = key.next();
+            uint64_t q = p[(int64_t)k * step];
+            if (q != c)
+                return q < c ? -1 : 1;
+        }
+        return 0;
+    }
+
+    // [first, last) of the sorted keys having a given prefix, where
+    // compare(k) compares the prefix with key k
+    template <class compare_f>
+    static std::pair<uint64_t, uint64_t> prefix_range(uint64_t n,
+                                                      compare_f compare) {
+        uint64_t lo = 0, hi = n;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (compare(mid) > 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        uint64_t first = lo;
+        hi = n;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (compare(mid) >= 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return {first, lo};
+    }
+
+    /**
+     * @brief Offsets of the pattern that can be the first boundary crossed
+     * by an occurrence in its deepest node: 1, where a byte is followed by
+     * another symbol, and the positions that are LMS in the text at every
+     * occurrence. The types of the bytes before the last run of equal
+     * bytes of the pattern do not depend on the text after it.
+     */
+    static std::vector<uint64_t> split_offsets(const std::string &pattern) {
+        const unsigned char *p = (const unsigned char *)pattern.data();
+        uint64_t m = pattern.size();
+        uint64_t run = m - 1;
+        while (run > 0 && p[run - 1] == p[run]) {
+            run--;
+        }
+        std::vector<uint64_t> offsets(1, 1);
+        // S-type of p[i], for i < run
+        std::vector<bool> s_type(run + 1, false);
+        for (uint64_t i = run; i-- > 0;) {
+            s_type[i] = p[i] < p[i + 1] || (p[i] == p[i + 1] && s_type[i + 1]);
+        }
+        for (uint64_t i = 2; i < run; i++) {
+            if (s_type[i] && !s_type[i - 1])
+                offsets.push_back(i);
+        }
+        if (run >= 2 && p[run - 1] > p[run])
+            offsets.push_back(run);
+        return offsets;
+    }
+
+    // Calls found(x, offset) for each occurrence of the pattern crossing a
+    // boundary of rule x, starting at offset of its expansion
+    template <class found_f>
+    void primary_occurrences(const std::string &pattern, found_f found) const {
+        uint64_t m = pattern.size();
+        if (m < 2)
+            return;
+        const unsigned char *p = (const unsigned char *)pattern.data();
+        for (uint64_t q : split_offsets(pattern)) {
+            // Left symbols ending with p[0, q), read backward
+            std::pair<uint64_t, uint64_t> left =
+                prefix_range(m_left.size(), [&](uint64_t k) {
+                    return compare_prefix(p + q - 1, q, -1,
+                                          cursor(*this, m_left[k], false));
+                });
+            if (left.first == left.second)
+                continue;
+            // Boundaries followed by p[q, m)
+            std::pair<uint64_t, uint64_t> right =
+                prefix_range(m_point_pos.size(), [&](uint64_t k) {
+                    uint64_t pos = m_point_pos[k];
+                    uint64_t end = m_start[rule_at(pos) - FIRST_RULE + 1];
+                    return compare_prefix(p + q, m - q, 1,
+                                          cursor(*this, pos, end, true));
+                });
+            m_grid.report(right.first, right.second, left.first, left.second,
+                          [&](uint64_t k) {
+                              found(rule_at(m_point_pos[k]),
+                                    m_point_offset[k] - q);
+                          });
+        }
+    }
+
+    // Appends the text positions of offset of the expansion of rule x
+    void report(uint64_t x, uint64_t offset, std::vector<uint64_t> &occ) const {
+        if (x == root()) {
+            occ.push_back(offset);
+            return;
+        }
+        uint64_t r = x - FIRST_RULE;
+        for (uint64_t k = m_parent_start[r]; k < m_parent_start[r + 1]; k++) {
+            report(m_parent[k], m_parent_offset[k] + offset, occ);
+        }
+    }
+
+    // Occurrences of the byte c, in the rules of bytes and the root
+    void locate_char(uint64_t c, std::vector<uint64_t> &occ) const {
+        for (uint64_t x = FIRST_RULE; x <= root(); x++) {
+            if (x == m_terminal_rules_end)
+                x = root();
+            uint64_t r = x - FIRST_RULE;
+            uint64_t offset = 0;
+            for (uint64_t k = m_start[r]; k < m_start[r + 1]; k++) {
+                uint64_t y = m_rhs[k];
+                if (y == c)
+                    report(x, offset, occ);
+                offset += length(y);
+            }
+        }
+    }
+};
+
+#endif // GC_IS_GCIS_SEARCH_INDEX_HPP
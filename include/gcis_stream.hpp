@@ -0,0 +1,212 @@
+//
+// Streaming decoder of a GC-IS dictionary.
+//
+
+#ifndef GC_IS_GCIS_STREAM_HPP
+#define GC_IS_GCIS_STREAM_HPP
+
+#include "sdsl/int_vector.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define STREAM_CHUNK 4096 // symbols buffered by each level of the decoder
+
+/**
+ * @brief Decodes the text of a dictionary front to back without
+ * materializing it or the reduced strings of the intermediate levels.
+ *
+ * The string of level i is its tail followed by the expansion, by the rules
+ * of level i, of the string of level i+1 (the reduced string for the last
+ * level). Each level pulls the symbols of the level above in chunks of
+ * STREAM_CHUNK and copies the rule they name, so besides the decompressed
+ * levels the decoder keeps one chunk per level and its memory does not
+ * depend on the text length.
+ *
+ * The decoder reads the tails and the reduced string of the dictionary it
+ * was created from, which must outlive it and must not be modified.
+ */
+template <class level_t> class gcis_decoder {
+  public:
+    /**
+     * @param levels decompressed levels of the grammar, bottom first
+     * @param tails tail of each level
+     * @param reduced_string reduced string of the last level
+     * @param length number of symbols of the text to decode
+     */
+    gcis_decoder(std::vector<std::shared_ptr<level_t>> levels,
+                 std::vector<const sdsl::int_vector<> *> tails,
+                 const sdsl::int_vector<> &reduced_string, uint64_t length)
+        : m_levels(std::move(levels)), m_tails(std::move(tails)),
+          m_reduced_string(reduced_string), m_length(length),
+          m_state(m_levels.size()) {}
+
+    gcis_decoder(const gcis_decoder &) = delete;
+    gcis_decoder &operator=(const gcis_decoder &) = delete;
+
+    // Length of the text
+    uint64_t size() const { return m_length; }
+    // Number of symbols already consumed
+    uint64_t position() const { return m_position - (m_out_size - m_out_pos); }
+
+    /**
+     * @brief Copies the next symbols of the text into buf.
+     * @return the number of symbols copied, less than n only at the end
+     */
+    uint64_t read(char *buf, uint64_t n) {
+        uint64_t k = 0;
+        while (k < n && m_out_pos < m_out_size) {
+            buf[k++] = m_out[m_out_pos++];
+        }
+        if (k < n) {
+            uint64_t len = std::min<uint64_t>(n - k, m_length - m_position);
+            len = fill(0, buf + k, len);
+            m_position += len;
+            k += len;
+        }
+        return k;
+    }
+
+    /**
+     * @brief Writes the rest of the text to the file descriptor fd.
+     * Throws std::runtime_error if a write fails.
+     */
+    void write_to(int fd) {
+        std::vector<char> buf(1 << 20);
+        uint64_t n;
+        while ((n = read(buf.data(), buf.size())) > 0) {
+            const char *p = buf.data();
+            while (n > 0) {
+                ssize_t w = ::write(fd, p, n);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w < 0) {
+                    throw std::runtime_error(std::string("write: ") +
+                                             strerror(errno));
+                }
+                p += w;
+                n -= w;
+            }
+        }
+    }
+
+    /**
+     * @brief Single-pass iterator over the symbols of the text. All the
+     * iterators of a decoder share its position, so incrementing one
+     * advances the others.
+     */
+    class iterator {
+      public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef char value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const char *pointer;
+        typedef const char &reference;
+
+        explicit iterator(gcis_decoder *d = nullptr)
+            : m_d(d && d->peek() ? d : nullptr) {}
+
+        reference operator*() const { return m_d->m_out[m_d->m_out_pos]; }
+        iterator &operator++() {
+            m_d->m_out_pos++;
+            if (!m_d->peek())
+                m_d = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator &rhs) const { return m_d == rhs.m_d; }
+        bool operator!=(const iterator &rhs) const { return m_d != rhs.m_d; }
+
+      private:
+        gcis_decoder *m_d;
+    };
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+  private:
+    // Decoding state of a level
+    struct level_state {
+        uint64_t tail_pos = 0;
+        // Rest of the rule being copied
+        uint64_t rule_pos = 0, rule_end = 0;
+        // Chunk of symbols of the level above
+        std::vector<uint64_t> in;
+        uint64_t in_pos = 0;
+    };
+
+    std::vector<std::shared_ptr<level_t>> m_levels;
+    std::vector<const sdsl::int_vector<> *> m_tails;
+    const sdsl::int_vector<> &m_reduced_string;
+    uint64_t m_length;
+    std::vector<level_state> m_state;
+    // Symbols of the reduced string already consumed
+    uint64_t m_top_pos = 0;
+    // Symbols of the text produced by fill
+    uint64_t m_position = 0;
+    // Chunk of the text read by the iterators
+    std::vector<char> m_out;
+    uint64_t m_out_pos = 0, m_out_size = 0;
+
+    // Refills the chunk of the iterators if it is exhausted. Returns false
+    // at the end of the text.
+    bool peek() {
+        if (m_out_pos == m_out_size) {
+            m_out.resize(STREAM_CHUNK);
+            m_out_pos = m_out_size = 0;
+            m_out_size = read(m_out.data(), STREAM_CHUNK);
+        }
+        return m_out_pos < m_out_size;
+    }
+
+    /**
+     * @brief Writes the next (at most n) symbols of the string of level i
+     * into out.
+     * @return the number of symbols written, less than n only at the end of
+     * the string
+     */
+    template <class out_t> uint64_t fill(uint64_t i, out_t *out, uint64_t n) {
+        if (i == m_levels.size()) {
+            uint64_t k = 0;
+            for (; k < n && m_top_pos < m_reduced_string.size(); k++) {
+                out[k] = m_reduced_string[m_top_pos++];
+            }
+            return k;
+        }
+
+        level_t &gd = *m_levels[i];
+        const sdsl::int_vector<> &tail = *m_tails[i];
+        level_state &st = m_state[i];
+        uint64_t k = 0;
+        for (; k < n && st.tail_pos < tail.size(); k++) {
+            out[k] = tail[st.tail_pos++];
+        }
+        while (k < n) {
+            if (st.rule_pos == st.rule_end) {
+                if (st.in_pos == st.in.size()) {
+                    st.in.resize(STREAM_CHUNK);
+                    st.in.resize(fill(i + 1, st.in.data(), STREAM_CHUNK));
+                    st.in_pos = 0;
+                    if (st.in.empty())
+                        break;
+                }
+                uint64_t rule = st.in[st.in_pos++];
+                st.rule_pos = gd.rule_start(rule);
+                st.rule_end = st.rule_pos + gd.rule_length(rule);
+            }
+            for (; k < n && st.rule_pos < st.rule_end; k++) {
+                out[k] = gd.rule[st.rule_pos++];
+            }
+        }
+        return k;
+    }
+};
+
+#endif // GC_IS_GCIS_STREAM_HPP
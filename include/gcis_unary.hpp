@@ -22,16 +22,8 @@ public:
         return total_bytes;
     }
 
-    void encode(char* s){
-        int_t n = strlen(s)+1;
-        uint_t* SA = new uint_t[n];
-        int_t K = 256;
-        int cs = sizeof(char);
-        int level = 0;
-
-        gc_is((int_t*) s, SA,n,K,cs,level);
-        delete[] SA;
-    }
+    using gcis_abstract<gcis_unary_codec>::encode;
+    using gcis_abstract<gcis_unary_codec>::text_length;
 
     char* decode_inline(){
         int level=0;
@@ -83,25 +75,6 @@ public:
     }
 
 
-    void serialize(std::ostream &o) {
-        reduced_string.serialize(o);
-        uint64_t size = g.size();
-        o.write((char*) &size,sizeof(uint64_t));
-        for(uint64_t i=0;i<g.size();i++){
-            g[i].serialize(o);
-        }
-    }
-
-    void load(std::istream &i) {
-        uint64_t size;
-        reduced_string.load(i);
-        i.read((char*) &size,sizeof(uint64_t));
-        g.resize(size);
-        for(uint64_t j=0;j<size;j++){
-            g[j].load(i);
-        }
-    }
-
 private:
 
     bool evaluate_premature_stop(int_t n0,int_t alphabet_size_s0,
@@ -124,12 +97,14 @@ private:
     //! \param cs Symbol Length
     //! \param level current level of recursion.
 
-    void gc_is(int_t *s,
-               uint_t *SA,
-               int_t n,
-               int_t K,
-               int cs,
-               int level) override{
+    void gc_is(int_t *s, uint_t *SA, int_t n, int_t K, int cs,
+               int level) override {
+        GC_IS_DISPATCH(s, SA, n, K, cs, level);
+    }
+
+    template <class text_t>
+    void gc_is_level(text_t s, uint_t *SA, int_t n, int_t K,
+                     int level) {
         int_t i, j;
 
 #ifdef MEM_MONITOR
@@ -159,7 +134,7 @@ private:
         size_t first = n - 1;
 
         // sort all the S-substrings
-        getBuckets(s, bkt, n, K, cs, true); // find ends of buckets
+        getBuckets(s, bkt, n, K, true); // find ends of buckets
 
         for (i = 0; i < n; i++) {
             SA[i] = EMPTY;
@@ -175,10 +150,10 @@ private:
         SA[0] = n - 1; // set the single sentinel LMS-substring
 
         //Induce L-Type suffixes by using LMS-Type and L-Type suffixes
-        induceSAl(t, SA, s, bkt, n, K, cs, level);
+        induceSAl(t, SA, s, bkt, n, K, level);
 
         //Induce S-Type suffixes by using L-Type and S-Type suffixes
-        induceSAs(t, SA, s, bkt, n, K, cs, level);
+        induceSAs(t, SA, s, bkt, n, K, level);
 
         delete[] bkt;
 
@@ -194,14 +169,16 @@ private:
 
         // Init the name array buffer
         // SA[0,n1-1] = LMS starting positions
-        // SA[n1,n-1] = Name for each LMS substring
+        // SA[n1,n-1] = Name for each LMS substring (its length until named)
         for (i = n1; i < n; i++) {
             SA[i] = EMPTY;
         }
+        store_lms_lengths(t, SA, n, n1);
 
         // find the lexicographic names of all LMS-substrings by comparing the consecutive ones
         int_t name = -1;
         int_t prev = -1;
+        int_t prev_len = 0;
 
         int_t last_set_lcp_bit = -1;
         uint_t rule_index = 0;
@@ -209,38 +186,19 @@ private:
         //Iterate over all suffixes in the LMS sorted array
         for (i = 0; i < n1; i++) {
             int_t pos = SA[i];
-            bool diff = false;
-            int_t d;
+            // Length of the LMS-substring, replaced by its name below
+            int_t len = SA[n1 + pos / 2];
+            bool diff = true;
             // d equals to the LCP between two consecutive LMS-substrings
-            for (d = 0; d < n; d++) {
-                //If is first suffix in LMS order (sentinel), or one of the suffixes reached the last position of T, or the
-                // characters of T differs or the type os suffixes differ.
-                if (prev == -1 || pos + d == n - 1 || prev + d == n - 1 ||  chr(pos + d) != chr(prev + d)
-                    || ( isLMS(pos+d) ^ (isLMS(prev+d))) )  {
-                    diff = true;
-                    break;
-                }
-                //The comparison has reached the end of at least one LMS-substring
-                if (d > 0 && (isLMS(pos + d) || isLMS(prev + d))) {
-                    break;
-                }
+            int_t d = 0;
+            if (prev != -1) {
+                diff = lms_substrings_differ(s, pos, len, prev, prev_len, n,
+                                             true, d);
             }
 
             // The consecutive LMS-substrings differs
             if (diff) {
 
-                // Get the length of the current lms-substring
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
-
-                // Get the length of the previous LMS-Substring
-                size_t len2 = 1;
-                if (prev != n - 1)
-                    while (!isLMS(prev + len2))
-                        len2++;
-
                 // Resizes Rule array, LCP array and rule delimiter bitvector
                 uint64_t old_lcp_size, old_rule_delim_size;
 
@@ -275,20 +233,17 @@ private:
                         run_length_potential++;
                     }
 #endif
-                    g[level].rule[rule_index] = (uint_t) chr(j + pos + d);
+                    g[level].rule[rule_index] = stored_symbol(s, j + pos + d, level);
                     rule_index++;
                 }
                 // Since the adjacent LMS substrings differ, we must assign
                 // a new name
                 name++;
                 prev = pos;
+                prev_len = len;
             }
 #ifdef REPORT
             else{
-                size_t len = 1;
-                if (pos != n - 1)
-                    while (!isLMS(pos + len))
-                        len++;
                 discarded_rules_len+=len;
                 discarded_rules_n++;
             }
@@ -318,8 +273,7 @@ private:
         // Copy the first elements (not part of a LMS substring)
         g[level].tail.resize(first);
         for (j = 0; j < first; j++) {
-            g[level].tail[j] = (uint64_t) (cs == sizeof(char) ? ((char*)s)[j] :
-                                           s[j]);
+            g[level].tail[j] = stored_symbol(s, j, level);
         }
         sdsl::util::bit_compress(g[level].tail);
 
@@ -350,7 +304,8 @@ private:
         if (name+1 < n1 && !premature_stop) {
             g[level].string_size = n;
             g[level].alphabet_size = K;
-            gc_is((int_t *) s1, SA1, n1, name+1, sizeof(int_t), level + 1);
+            gc_is((int_t *)s1, SA1, n1, name + 1,
+                  narrow_reduced_string(s1, n1, name + 1), level + 1);
         } else { // generate the suffix array of s1 directly
             if(premature_stop){
 #ifdef REPORT
@@ -359,7 +314,7 @@ private:
                 reduced_string.resize(n);
                 for (j = 0; j < n; j++) {
                     // Copy the reduced substring
-                    reduced_string[j] = s[j];
+                    reduced_string[j] = stored_symbol(s, j, level);
                 }
                 // Discard the last computed level
                 g.pop_back();
@@ -420,16 +375,16 @@ private:
 
 
     // compute SA for the S-Type suffixes by inducing the L-Type suffixes and the S-Type suffixes
+    template <class text_t>
     void induceSAs(unsigned char *t,
                    uint_t *SA,
-                   int_t *s,
+                   text_t s,
                    int_t *bkt,
                    int_t n,
                    int_t K,
-                   int cs,
                    int level) {
         int_t i, j;
-        getBuckets(s, bkt, n, K, cs, true); // find ends of buckets
+        getBuckets(s, bkt, n, K, true); // find ends of buckets
         for (i = n - 1; i >= 0; i--) {
             if (SA[i] != EMPTY) {
                 j = SA[i] - 1;
@@ -441,17 +396,17 @@ private:
     }
 
     // compute SA for the L-Type suffixes by inducing the LMS-Suffixes and the L-Suffixes
+    template <class text_t>
     void induceSAl(unsigned char *t,
                    uint_t *SA,
-                   int_t *s,
+                   text_t s,
                    int_t *bkt,
                    int_t n,
                    int_t K,
-                   int cs,
                    int level) {
         int_t i, j;
         // find heads of buckets
-        getBuckets(s, bkt, n, K, cs, false);
+        getBuckets(s, bkt, n, K, false);
         //  if(level==0) bkt[0]++;
         for (i = 0; i < n; i++) {
             if (SA[i] != EMPTY) {
@@ -465,11 +420,11 @@ private:
 
 
 // compute the head or end of each bucket
-    void getBuckets(int_t *s,
+    template <class text_t>
+    void getBuckets(text_t s,
                     int_t *bkt,
                     int_t n,
                     int_t K,
-                    int cs,
                     int end) {
         int_t i, sum = 0;
 
@@ -0,0 +1,99 @@
+//
+// Packed 40-bit integers used as int_t/uint_t when compiling with -Dm40.
+//
+
+#ifndef GC_IS_INT40_HPP
+#define GC_IS_INT40_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief 40-bit integer stored in 5 bytes (alignment 1).
+ *
+ * Arrays of these types take 5n bytes, which allows texts up to 2^39
+ * symbols while spending 3n bytes less than 64-bit arrays. Values are
+ * converted to int64_t (signed) or uint64_t (unsigned) for arithmetic and
+ * truncated back to 40 bits on assignment, mirroring the wrap-around of the
+ * native integer types.
+ */
+template <bool is_signed> class packed_int40 {
+  public:
+    typedef typename std::conditional<is_signed, int64_t, uint64_t>::type
+        value_type;
+
+  private:
+    uint8_t b[5];
+
+    void set(uint64_t v) {
+        b[0] = v;
+        b[1] = v >> 8;
+        b[2] = v >> 16;
+        b[3] = v >> 24;
+        b[4] = v >> 32;
+    }
+
+    value_type get() const {
+        uint64_t v = (uint64_t)b[0] | ((uint64_t)b[1] << 8) |
+                     ((uint64_t)b[2] << 16) | ((uint64_t)b[3] << 24) |
+                     ((uint64_t)b[4] << 32);
+        if (is_signed && (v & 0x8000000000ULL))
+            v |= 0xffffff0000000000ULL;
+        return (value_type)v;
+    }
+
+  public:
+    packed_int40() = default;
+
+    template <class T, class = typename std::enable_if<
+                           std::is_convertible<T, value_type>::value>::type>
+    packed_int40(T v) {
+        set((uint64_t)(value_type)v);
+    }
+
+    operator value_type() const { return get(); }
+
+    packed_int40 &operator++() {
+        set(get() + 1);
+        return *this;
+    }
+    packed_int40 &operator--() {
+        set(get() - 1);
+        return *this;
+    }
+    packed_int40 operator++(int) {
+        packed_int40 old = *this;
+        set(get() + 1);
+        return old;
+    }
+    packed_int40 operator--(int) {
+        packed_int40 old = *this;
+        set(get() - 1);
+        return old;
+    }
+    template <class T> packed_int40 &operator+=(T v) {
+        set(get() + v);
+        return *this;
+    }
+    template <class T> packed_int40 &operator-=(T v) {
+        set(get() - v);
+        return *this;
+    }
+    template <class T> packed_int40 &operator*=(T v) {
+        set(get() * v);
+        return *this;
+    }
+    template <class T> packed_int40 &operator/=(T v) {
+        set(get() / v);
+        return *this;
+    }
+};
+
+typedef packed_int40<true> int40_t;
+typedef packed_int40<false> uint40_t;
+
+static_assert(sizeof(int40_t) == 5, "int40_t must be packed in 5 bytes");
+static_assert(sizeof(uint40_t) == 5, "uint40_t must be packed in 5 bytes");
+
+#endif // GC_IS_INT40_HPP
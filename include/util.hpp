@@ -21,6 +21,14 @@ using namespace std;
     #define U_MAX    UINT64_MAX
     #define I_MAX    INT64_MAX
     #define I_MIN    INT64_MIN
+#elif defined(m40)
+    #include "int40.hpp"
+    typedef int40_t  int_t;
+    typedef uint40_t uint_t;
+    #define PRIdN    PRId64
+    #define U_MAX    0xffffffffffULL
+    #define I_MAX    0x7fffffffffLL
+    #define I_MIN    (-0x8000000000LL)
 #else
     typedef int32_t  int_t;
     typedef uint32_t uint_t;
@@ -106,6 +114,17 @@ ostream& operator<<(ostream& os,const std::vector<T>& v){
 #endif //MY_DEBUGs
 
 
+// Copies v into out with the fewest bits per entry that hold its values
+inline void pack_int_vector(const std::vector<uint64_t> &v,
+                            sdsl::int_vector<> &out) {
+    out = sdsl::int_vector<>(v.size());
+    for (uint64_t i = 0; i < v.size(); i++) {
+        out[i] = v[i];
+    }
+    sdsl::util::bit_compress(out);
+}
+
+
 // For static asserts
 template<class T>
 struct false_predicate : std::false_type
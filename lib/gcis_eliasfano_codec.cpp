@@ -91,6 +91,18 @@ gcis_eliasfano_codec_level gcis_eliasfano_codec::decompress() {
     return gd;
 }
 
+uint64_t gcis_eliasfano_codec_level::size_in_bytes() {
+    return sdsl::size_in_bytes(rule) + rule_delim.size_in_bytes();
+}
+
+uint64_t gcis_eliasfano_codec_level::rule_start(uint64_t rule_num) {
+    return rule_delim.pos(rule_num);
+}
+
+uint64_t gcis_eliasfano_codec_level::rule_length(uint64_t rule_num) {
+    return rule_delim.pos(rule_num + 1) - rule_delim.pos(rule_num);
+}
+
 void gcis_eliasfano_codec_level::expand_rule(uint64_t rule_num,
                                              sdsl::int_vector<> &r_string,
                                              uint64_t &l) {
@@ -280,3 +292,25 @@ void gcis_eliasfano_codec::extract_rule_suffix(
         extracted_text[k++] = rule[rule_pos + i];
     }
 }
+
+// The LCPs and suffix lengths of consecutive rules are the gaps between
+// consecutive 1-bits of their unary codes, so each rule takes one select
+// in each of them.
+void gcis_eliasfano_codec::decode_bucket(gcis_rule_bucket &b, uint64_t end) {
+    uint64_t last = std::min<uint64_t>(
+        {end, bucket_end_rule(b.first, front_coding_bucket),
+         fully_decoded_rule_len.size()});
+    uint64_t from = b.first + b.rules();
+    int64_t prev_lcp = from ? lcp.pos(from - 1) : -1;
+    int64_t prev_suffix = from ? rule_suffix_length.pos(from - 1) : -1;
+    for (uint64_t i = from; i < last; i++) {
+        int64_t cur_lcp = lcp.pos(i);
+        int64_t cur_suffix = rule_suffix_length.pos(i);
+        // get_rule_pos(i)
+        uint64_t rule_pos = prev_suffix + 1 - i;
+        b.add(cur_lcp - prev_lcp - 1, cur_suffix - prev_suffix - 1,
+              [&](uint64_t j) { return rule[rule_pos + j]; });
+        prev_lcp = cur_lcp;
+        prev_suffix = cur_suffix;
+    }
+}
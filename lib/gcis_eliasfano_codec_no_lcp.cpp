@@ -83,6 +83,10 @@ gcis_eliasfano_codec_no_lcp_level gcis_eliasfano_codec_no_lcp::decompress(){
 
 
 
+uint64_t gcis_eliasfano_codec_no_lcp_level::size_in_bytes() {
+    return sdsl::size_in_bytes(rule) + rule_delim.size_in_bytes();
+}
+
 void gcis_eliasfano_codec_no_lcp_level::expand_rule(uint64_t rule_num, sdsl::int_vector<> &r_string, uint64_t &l) {
     uint64_t rule_start = rule_delim.pos(rule_num);
     uint64_t rule_length = rule_delim.pos(rule_num+1) - rule_start;
@@ -123,6 +123,24 @@ gcis_gap_codec_level gcis_gap_codec::decompress() {
     return gd;
 }
 
+uint64_t gcis_gap_codec_level::size_in_bytes() {
+    return sdsl::size_in_bytes(rule) + sdsl::size_in_bytes(rule_delim) +
+           sdsl::size_in_bytes(rule_delim_sel);
+}
+
+uint64_t gcis_gap_codec_level::rule_start(uint64_t rule_num) {
+    return rule_delim_sel(rule_num + 1);
+}
+
+uint64_t gcis_gap_codec_level::rule_length(uint64_t rule_num) {
+    uint64_t rule_start = rule_delim_sel(rule_num + 1);
+    uint64_t rule_length;
+    for (rule_length = 1; rule_delim[rule_start + rule_length] == 0;
+         rule_length++)
+        ;
+    return rule_length;
+}
+
 void gcis_gap_codec_level::expand_rule(uint64_t rule_num,
                                        sdsl::int_vector<> &r_string,
                                        uint64_t &l) {
@@ -293,6 +311,50 @@ void gcis_gap_codec::extract_rule(uint64_t rule_num,
     extract_rule_suffix(rule_num, extracted_text, k);
 }
 
+/**
+ * @brief Appends the values v[l,r) of a gap encoded vector to out, decoding
+ * each sampled block once.
+ */
+static void decode_range(sdsl::enc_vector<sdsl::coder::elias_delta> &v,
+                         uint64_t l, uint64_t r, vector<uint64_t> &out) {
+    uint64_t dens = v.get_sample_dens();
+    vector<uint64_t> buffer(dens);
+    while (l < r) {
+        uint64_t block = l / dens;
+        v.get_inter_sampled_values(block, buffer.data());
+        uint64_t sample = v.sample(block);
+        for (; l < r && l / dens == block; l++) {
+            out.push_back(sample + buffer[l % dens]);
+        }
+    }
+}
+
+void gcis_gap_codec::decode_bucket(gcis_rule_bucket &b, uint64_t end) {
+    uint64_t last = std::min<uint64_t>(
+        {end, bucket_end_rule(b.first, front_coding_bucket),
+         fully_decoded_rule_len.size()});
+    uint64_t next = b.first + b.rules();
+    if (next >= last) {
+        return;
+    }
+    // Cumulative LCPs and rule positions of the rules next-1..last-1
+    vector<uint64_t> lcp_values, pos_values;
+    uint64_t from = next ? next - 1 : 0;
+    decode_range(lcp, from, last, lcp_values);
+    decode_range(rule_pos, from, last, pos_values);
+    for (uint64_t i = next; i < last; i++) {
+        uint64_t j = i - from;
+        if (i == 0) {
+            // Rule 0 is the single symbol rule[0]
+            b.add(0, 1, [&](uint64_t) { return rule[0]; });
+            continue;
+        }
+        uint64_t pos = pos_values[j - 1];
+        b.add(lcp_values[j] - lcp_values[j - 1], pos_values[j] - pos,
+              [&](uint64_t s) { return rule[pos + s]; });
+    }
+}
+
 void gcis_gap_codec::serialize(std::ostream &o) {
     o.write((char *)&alphabet_size, sizeof(alphabet_size));
     o.write((char *)&string_size, sizeof(string_size));
@@ -0,0 +1,218 @@
+#include "gcis_mapped.hpp"
+#include <chrono>
+
+const uint64_t *gcis_packed_view::attach(const uint64_t *p,
+                                         const uint64_t *end) {
+    if (end - p < 2) {
+        throw std::runtime_error("truncated mapped dictionary");
+    }
+    m_size = p[0];
+    m_width = p[1];
+    if (m_width == 0 || m_width > 64) {
+        throw std::runtime_error("corrupted mapped dictionary");
+    }
+    uint64_t n_words = (m_size * m_width + 63) / 64;
+    if ((uint64_t)(end - p - 2) < n_words) {
+        throw std::runtime_error("truncated mapped dictionary");
+    }
+    m_words = p + 2;
+    return m_words + n_words;
+}
+
+const uint64_t *gcis_mapped_level::attach(const uint64_t *p,
+                                          const uint64_t *end) {
+    if (end - p < 3) {
+        throw std::runtime_error("truncated mapped dictionary");
+    }
+    string_size = p[0];
+    alphabet_size = p[1];
+    fully_decoded_tail_len = p[2];
+    p = lcp.attach(p + 3, end);
+    p = rule_pos.attach(p, end);
+    p = rule.attach(p, end);
+    p = tail.attach(p, end);
+    return fully_decoded_rule_len.attach(p, end);
+}
+
+void gcis_mapped_level::extract_rule(uint64_t rule_num,
+                                     std::vector<uint64_t> &out) const {
+    uint64_t k = out.size();
+    uint64_t lcp_len = get_lcp(rule_num);
+    uint64_t suffix_len = get_rule_length(rule_num);
+    out.resize(k + lcp_len + suffix_len);
+
+    // The LCP part is copied backwards from the suffixes of the previous
+    // rules, each one covering the symbols beyond its own LCP
+    uint64_t cur_lcp_len = lcp_len;
+    uint64_t prev_rule = rule_num - 1;
+    while (cur_lcp_len > 0) {
+        uint64_t prev_lcp_len = get_lcp(prev_rule);
+        if (prev_lcp_len < cur_lcp_len) {
+            uint64_t prev_rule_pos = get_rule_pos(prev_rule);
+            for (uint64_t i = prev_lcp_len; i < cur_lcp_len; i++) {
+                out[k + i] = rule[prev_rule_pos + i - prev_lcp_len];
+            }
+            cur_lcp_len = prev_lcp_len;
+        }
+        prev_rule--;
+    }
+
+    uint64_t rule_pos = get_rule_pos(rule_num);
+    for (uint64_t i = 0; i < suffix_len; i++) {
+        out[k + lcp_len + i] = rule[rule_pos + i];
+    }
+}
+
+gcis_mapped_dictionary::gcis_mapped_dictionary(const char *path)
+    : m_file(path, MADV_RANDOM) {
+    const uint64_t header_words = (GCIS_HEADER_SIZE + 7) / 8;
+    if (m_file.size() < 8 * (header_words + 1)) {
+        throw std::runtime_error(std::string(path) +
+                                 ": not a mapped dictionary");
+    }
+    uint32_t magic;
+    memcpy(&magic, m_file.data(), sizeof(magic));
+    if (magic != GCIS_MAPPED_MAGIC) {
+        throw std::runtime_error(std::string(path) +
+                                 ": not a mapped dictionary");
+    }
+    // The mapping is page aligned, so the words are read in place
+    const uint64_t *p = (const uint64_t *)m_file.data() + header_words;
+    const uint64_t *end = (const uint64_t *)m_file.data() + m_file.size() / 8;
+    uint64_t n_levels = *p++;
+    p = reduced_string.attach(p, end);
+    p = partial_sum.attach(p, end);
+    g.resize(n_levels);
+    for (auto &level : g) {
+        p = level.attach(p, end);
+    }
+}
+
+uint64_t gcis_mapped_dictionary::text_length() const {
+    if (g.empty())
+        return reduced_string.size() - 1;
+    return g[0].string_size - 1;
+}
+
+// Leftmost index rk such that the expansion of reduced_string[rk] covers sz
+uint64_t gcis_mapped_dictionary::bsearch_upperbound(uint64_t sz) const {
+    int64_t l = 0, r = partial_sum.size() - 1;
+    while (l < r) {
+        int64_t mid = l + (r - l) / 2;
+        if (partial_sum[mid] +
+                g.back().fully_decoded_rule_len[reduced_string[mid]] >
+            sz) {
+            r = mid;
+        } else {
+            l = mid + 1;
+        }
+    }
+    return l;
+}
+
+// Rightmost index lk such that partial_sum[lk] <= sz
+uint64_t gcis_mapped_dictionary::bsearch_lowerbound(uint64_t sz) const {
+    int64_t l = 0, r = partial_sum.size() - 1;
+    while (l < r) {
+        int64_t mid = l + (r - l + 1) / 2;
+        if (partial_sum[mid] <= sz) {
+            l = mid;
+        } else {
+            r = mid - 1;
+        }
+    }
+    return l;
+}
+
+void gcis_mapped_dictionary::extract(uint64_t l, uint64_t r,
+                                     unsigned char *out) const {
+    if (g.empty()) {
+        for (uint64_t i = l; i <= r; i++) {
+            out[i - l] = reduced_string[i];
+        }
+        return;
+    }
+
+    // Symbols of the current level covering the text interval
+    // [text_l, text_r), which contains T[l,r]
+    std::vector<uint64_t> cur, next;
+    uint64_t text_l = 0, text_r;
+    const gcis_mapped_level &top = g.back();
+    uint64_t lk = 0, rk;
+    if (r < top.fully_decoded_tail_len) {
+        text_r = top.fully_decoded_tail_len;
+        for (uint64_t i = 0; i < top.tail.size(); i++) {
+            next.push_back(top.tail[i]);
+        }
+    } else {
+        if (l < top.fully_decoded_tail_len) {
+            for (uint64_t i = 0; i < top.tail.size(); i++) {
+                next.push_back(top.tail[i]);
+            }
+        } else {
+            lk = bsearch_lowerbound(l - top.fully_decoded_tail_len);
+            text_l = top.fully_decoded_tail_len + partial_sum[lk];
+        }
+        rk = bsearch_upperbound(r - top.fully_decoded_tail_len);
+        text_r = top.fully_decoded_tail_len + partial_sum[rk] +
+                 top.fully_decoded_rule_len[reduced_string[rk]];
+        for (uint64_t i = lk; i <= rk; i++) {
+            top.extract_rule(reduced_string[i], next);
+        }
+    }
+
+    for (int64_t level = g.size() - 2; level >= 0; level--) {
+        const gcis_mapped_level &lv = g[level];
+        std::swap(cur, next);
+        next.clear();
+        if (r < lv.fully_decoded_tail_len) {
+            text_l = 0;
+            text_r = lv.fully_decoded_tail_len;
+            for (uint64_t i = 0; i < lv.tail.size(); i++) {
+                next.push_back(lv.tail[i]);
+            }
+            continue;
+        }
+        // Drop the symbols of cur whose expansion ends before l or starts
+        // after r
+        uint64_t first = 0, last = cur.size();
+        if (l < lv.fully_decoded_tail_len) {
+            text_l = 0;
+            for (uint64_t i = 0; i < lv.tail.size(); i++) {
+                next.push_back(lv.tail[i]);
+            }
+        } else {
+            text_l = std::max(text_l, lv.fully_decoded_tail_len);
+            while (first < last &&
+                   text_l + lv.fully_decoded_rule_len[cur[first]] <= l) {
+                text_l += lv.fully_decoded_rule_len[cur[first++]];
+            }
+        }
+        while (last > first &&
+               text_r - lv.fully_decoded_rule_len[cur[last - 1]] > r) {
+            text_r -= lv.fully_decoded_rule_len[cur[--last]];
+        }
+        for (uint64_t i = first; i < last; i++) {
+            lv.extract_rule(cur[i], next);
+        }
+    }
+
+    for (uint64_t i = 0; i < r - l + 1; i++) {
+        out[i] = next[i + l - text_l];
+    }
+}
+
+void gcis_mapped_dictionary::extract_batch(
+    const vector<pair<uint64_t, uint64_t>> &query) const {
+    std::string text;
+    std::chrono::duration<double> elapsed(0);
+    for (auto p : query) {
+        text.resize(p.second - p.first + 1);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        extract(p.first, p.second, (unsigned char *)&text[0]);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        elapsed += t1 - t0;
+        cout << text << endl;
+    }
+    cout << "Batch Extraction Total time(s): " << elapsed.count() << endl;
+}
@@ -0,0 +1,80 @@
+#include "gcis_rule_builder.hpp"
+
+void gcis_rule_builder::build_unary(const std::vector<uint_t> &v,
+                                    uint64_t total, sdsl::bit_vector &bv) {
+    bv = sdsl::bit_vector(total + v.size(), 0);
+    uint64_t k = 0;
+    for (uint64_t x : v) {
+        k += x;
+        bv[k++] = 1;
+    }
+}
+
+void gcis_rule_builder::build_cumulative(const std::vector<uint_t> &v,
+                                         std::vector<uint64_t> &out) {
+    out.resize(v.size());
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < v.size(); i++) {
+        sum += v[i];
+        out[i] = sum;
+    }
+}
+
+void gcis_rule_builder::build_unary_lcp(sdsl::bit_vector &bv) const {
+    build_unary(m_lcp, m_total_lcp, bv);
+}
+
+void gcis_rule_builder::build_unary_suffix_length(sdsl::bit_vector &bv) const {
+    build_unary(m_suffix_len, m_total_suffix_len, bv);
+}
+
+void gcis_rule_builder::build_cumulative_lcp(std::vector<uint64_t> &v) const {
+    build_cumulative(m_lcp, v);
+}
+
+void gcis_rule_builder::build_cumulative_suffix_length(
+    std::vector<uint64_t> &v) const {
+    build_cumulative(m_suffix_len, v);
+}
+
+double gcis_rule_builder::average_walk(uint64_t bucket) const {
+    if (size() == 0)
+        return 0;
+    uint64_t walk = 0, last_zero = 0;
+    for (uint64_t i = 1; i < size(); i++) {
+        uint64_t first = bucket_first_rule(i, bucket);
+        if (m_lcp[i] == 0) {
+            last_zero = i;
+        } else if (i != first) {
+            walk += i - std::max<uint64_t>(last_zero, first);
+        }
+    }
+    return (double)walk / size();
+}
+
+uint64_t gcis_rule_builder::choose_bucket(double max_walk) const {
+    uint64_t bucket = 1;
+    while (bucket < FRONT_CODING_MAX_BUCKET &&
+           average_walk(2 * bucket) <= max_walk) {
+        bucket *= 2;
+    }
+    return bucket;
+}
+
+void gcis_rule_builder::restart_front_coding(uint64_t bucket) {
+    for (uint64_t i = 1; i < size(); i += bucket) {
+        m_suffix_pos[i] -= m_lcp[i];
+        m_suffix_len[i] += m_lcp[i];
+        m_total_suffix_len += m_lcp[i];
+        m_total_lcp -= m_lcp[i];
+        m_lcp[i] = 0;
+    }
+}
+
+void gcis_rule_builder::clear() {
+    std::vector<uint_t>().swap(m_suffix_pos);
+    std::vector<uint_t>().swap(m_lcp);
+    std::vector<uint_t>().swap(m_suffix_len);
+    m_total_lcp = 0;
+    m_total_suffix_len = 0;
+}
@@ -167,6 +167,18 @@ void gcis_s8b_codec_level::expand_rule(uint64_t rule_num, char *s,
     }
 }
 
+uint64_t gcis_s8b_pointers_codec_level::size_in_bytes() {
+    return sdsl::size_in_bytes(rule) + rule_pos.size() * sizeof(uint_t);
+}
+
+uint64_t gcis_s8b_pointers_codec_level::rule_start(uint64_t rule_num) {
+    return rule_pos[rule_num];
+}
+
+uint64_t gcis_s8b_pointers_codec_level::rule_length(uint64_t rule_num) {
+    return rule_pos[rule_num + 1] - rule_pos[rule_num];
+}
+
 void gcis_s8b_pointers_codec_level::expand_rule(uint64_t rule_num,
                                                 sdsl::int_vector<> &r_string,
                                                 uint64_t &l) {
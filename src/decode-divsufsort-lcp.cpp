@@ -30,11 +30,11 @@ int main(int argc, char *argv[]) {
 
     start = timer::now();
     cout << "Computing the Suffix Array + LCP with Divsufsort" << endl;
-    size_t n = strlen(str);
+    size_t n = d.text_length();
     saidx_t* SA = new saidx_t[n];
     saidx_t* LCP = new saidx_t[n];
     divsuflcpsort((sauchar_t*)str,SA,LCP,n);
-    cout << "input:\t" << strlen(str) << " bytes" << endl;
+    cout << "input:\t" << d.text_length() << " bytes" << endl;
     stop = timer::now();
 
     cout << "Suffix Array + LCP Construction Time: " << (double)duration_cast<milliseconds>(stop - start).count()/1000.0
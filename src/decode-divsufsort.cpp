@@ -29,11 +29,11 @@ int main(int argc, char *argv[]) {
 
     start = timer::now();
     cout << "Computing the Suffix Array with Divsufsort" << endl;
-    size_t n = strlen(str);
+    size_t n = d.text_length();
     saidx_t* SA = new saidx_t[n];
     divsufsort((sauchar_t*)str,SA,n);
 
-    cout << "input:\t" << strlen(str) << " bytes" << endl;
+    cout << "input:\t" << d.text_length() << " bytes" << endl;
 
     stop = timer::now();
 
@@ -32,11 +32,11 @@ int main(int argc, char *argv[]) {
 
     start = timer::now();
     cout << "Computing the Suffix Array with SAIS-YUTA" << endl;
-    size_t n = strlen(str) + 1;
+    size_t n = d.text_length() + 1;
     int *SA = new int[n];
     int *LCP = new int[n];
     sais_lcp((unsigned char *)str, SA, LCP, n);
-    cout << "input:\t" << strlen(str) << " bytes" << endl;
+    cout << "input:\t" << d.text_length() << " bytes" << endl;
     stop = timer::now();
 
     cout << "Suffix Array + LCP Construction Time: "
@@ -34,7 +34,7 @@ int main(int argc, char *argv[]) {
 
     // Compute the Suffix Array
     start = timer::now();
-    size_t n = strlen(str) + 1;
+    size_t n = d.text_length() + 1;
     cout << "Computing the Suffix Array with SAIS-NONG" << endl;
     int32_t *SA = new int32_t[n];
     SA_IS((unsigned char *)str, SA, n, 255, sizeof(char), 0);
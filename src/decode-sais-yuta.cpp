@@ -30,11 +30,11 @@ int main(int argc, char *argv[]) {
 
     start = timer::now();
     cout << "Computing the Suffix Array with SAIS-YUTA" << endl;
-    size_t n = strlen(str) + 1;
+    size_t n = d.text_length() + 1;
     sa_int32_t *SA = new sa_int32_t[n];
     sa_int32_t k = 256;
     sais_u8((sa_uint8_t *)str, SA, n, k);
-    cout << "input:\t" << strlen(str) << " bytes" << endl;
+    cout << "input:\t" << d.text_length() << " bytes" << endl;
     stop = timer::now();
 
     cout << "Suffix Array Construction Time: "
@@ -3,24 +3,13 @@
 #include <fstream>
 #include <iostream>
 #include "divsufsort.h"
+#include "gcis_mapped_file.hpp"
 
 using namespace std;
 
 using namespace std::chrono;
 using timer = std::chrono::high_resolution_clock;
 
-void load_string_from_file(char *&str, char *filename) {
-    std::ifstream f(filename, std::ios::binary);
-    f.seekg(0, std::ios::end);
-    uint64_t size = f.tellg();
-    f.seekg(0, std::ios::beg);
-    str = new char[size + 1];
-    f.read(str, size);
-    str[size] = 0;
-    f.close();
-};
-
-
 int main(int argc, char *argv[]) {
 
     if (argc != 3) {
@@ -29,9 +18,9 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
     auto start = timer::now();
-    char *str;
-    load_string_from_file(str, argv[1]);
-    size_t n = strlen(str);
+    gcis_mapped_file text(argv[1]);
+    const char *str = text.data();
+    size_t n = text.size();
     saidx_t *SA = new saidx_t[n];
 
 
@@ -0,0 +1,87 @@
+// Front-end of gc-is-codec: chooses the index width (32, 40 or 64 bits)
+// from the input size or from the header of the compressed file and runs
+// the gc-is-codec-<width> binary installed alongside it.
+
+#include "gcis_format.hpp"
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// int_t is signed, so a width supports texts (plus the sentinel) up to its
+// largest positive value.
+int index_bits_for_text(uint64_t n) {
+    if (n + 1 <= INT32_MAX)
+        return 32;
+    if (n + 1 <= 0x7fffffffffULL)
+        return 40;
+    return 64;
+}
+
+int index_bits_for_file(const char *path) {
+    std::ifstream f(path, std::ios::binary);
+    gcis_header h;
+    h.load(f);
+    return 8 * h.index_bytes;
+}
+
+std::string codec_path(const char *argv0, int bits) {
+    char buf[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    std::string self = len > 0 ? std::string(buf, len) : std::string(argv0);
+    size_t slash = self.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : self.substr(0, slash);
+    return dir + "/gc-is-codec-" + std::to_string(bits);
+}
+
+int main(int argc, char *argv[]) {
+    int bits = 0;
+    uint64_t block_size = 0;
+    std::vector<char *> args(argv, argv + argc);
+
+    // -w <bits> forces the index width, -b <MiB> bounds the text length
+    // handled by each grammar
+    for (size_t k = 5; k + 1 < args.size(); k++) {
+        if (strcmp(args[k], "-w") == 0) {
+            bits = atoi(args[k + 1]);
+            if (bits != 32 && bits != 40 && bits != 64) {
+                std::cerr << "Invalid index width, use 32, 40 or 64" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(args[k], "-b") == 0) {
+            block_size = strtoull(args[k + 1], NULL, 10) << 20;
+        }
+    }
+
+    if (bits == 0 && argc >= 5) {
+        if (strcmp(argv[1], "-c") == 0) {
+            struct stat st;
+            if (stat(argv[2], &st) != 0) {
+                perror(argv[2]);
+                exit(EXIT_FAILURE);
+            }
+            uint64_t n = st.st_size;
+            if (block_size > 0 && block_size < n)
+                n = block_size;
+            bits = index_bits_for_text(n);
+        } else {
+            bits = index_bits_for_file(argv[2]);
+        }
+    }
+    if (bits == 0)
+        bits = 32;
+
+    std::string path = codec_path(argv[0], bits);
+    args[0] = (char *)path.c_str();
+    args.push_back(nullptr);
+    execv(path.c_str(), args.data());
+    perror(path.c_str());
+    return EXIT_FAILURE;
+}
@@ -1,29 +1,45 @@
 #include "../external/malloc_count/malloc_count.h"
 #include "gcis.hpp"
+#include "gcis_blocks.hpp"
 #include "gcis_eliasfano.hpp"
 #include "gcis_eliasfano_no_lcp.hpp"
 #include "gcis_gap.hpp"
+#include "gcis_mapped.hpp"
+#include "gcis_mapped_file.hpp"
 #include "gcis_s8b.hpp"
+#include "gcis_search_index.hpp"
 #include "gcis_unary.hpp"
-#include "sais.h"
 #include <cassert>
 #include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <unistd.h>
 
 using namespace std::chrono;
 using timer = std::chrono::high_resolution_clock;
 
-void load_string_from_file(char *&str, char *filename) {
-    std::ifstream f(filename, std::ios::binary);
-    f.seekg(0, std::ios::end);
-    uint64_t size = f.tellg();
-    f.seekg(0, std::ios::beg);
-    str = new char[size + 1];
-    f.read(str, size);
-    str[size] = 0;
-    f.close();
-};
+// Opens a file for writing, truncating it
+static int create_output(const string &path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Cannot open " << path << ": " << strerror(errno) << endl;
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+// Directory of a path, where the temporary files of -M are created
+static string directory_of(const string &path) {
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? "." : path.substr(0, slash + 1);
+}
+
+// Reports a -M budget that cannot hold the arrays of -s, -l or -bwt
+static void too_little_memory(const gcis_memory_error &e) {
+    cerr << "The -M budget is too small: " << e.what() << endl;
+    exit(EXIT_FAILURE);
+}
 
 int main(int argc, char *argv[]) {
 
@@ -31,14 +47,106 @@ int main(int argc, char *argv[]) {
     mm.event("GC-IS Init");
 #endif
 
-    if (argc != 5) {
+    if (argc < 5) {
         std::cerr << "Usage: \n"
-                  << "./gc-is-codec -c <file_to_be_encoded> <output> <codec flag>\n"
-                  << "./gc-is-codec -d <file_to_be_decoded> <output> <codec flag>\n"
-                  << "./gc-is-codec -s <file_to_be_decoded> <output> <codec flag>\n"
-                  << "./gc-is-codec -l <file_to_be_decoded> <output> <codec flag>\n"
-                  << "./gc-is-codec -e <encoded_file> <query file> <codec flag>\n";
+                  << "./gc-is-codec -c <file_to_be_encoded> <output> <codec flag> [options]\n"
+                  << "./gc-is-codec -d <file_to_be_decoded> <output or -> <codec flag> [options]\n"
+                  << "./gc-is-codec -s <file_to_be_decoded> <output> <codec flag> [options]\n"
+                  << "./gc-is-codec -l <file_to_be_decoded> <output> <codec flag> [options]\n"
+                  << "./gc-is-codec -bwt <file_to_be_decoded> <output> <codec flag> [options]\n"
+                  << "./gc-is-codec -e <encoded_file> <query file> <codec flag> [options]\n"
+                  << "./gc-is-codec -count <encoded_file> <pattern file> <codec flag> [options]\n"
+                  << "./gc-is-codec -locate <encoded_file> <pattern file> <codec flag> [options]\n"
+                  << "./gc-is-codec -lce <encoded_file> <query file> <codec flag> [options]\n"
+                  << "./gc-is-codec -m <encoded_file> <mapped_file> <codec flag> [options]\n"
+                  << "Options:\n"
+                  << "  -t <threads>  number of threads (0 = all cores)\n"
+                  << "  -b <MiB>      compress independent blocks of the given size in parallel\n"
+                  << "  -w <bits>     index width: 32, 40 or 64 (default: chosen from the input)\n"
+                  << "  -f <rules>    rules per front-coding bucket (0 = chosen per level, default: 32)\n"
+                  << "  -M <MiB>      with -s, -l and -bwt, induce the suffixes of the text on disk within\n"
+                  << "                this memory, failing if the sorting of the upper levels needs more\n"
+                  << "  -r            with -bwt, also write the start of each run to <output>.runs\n"
+                  << "  -L <format>   with -l, LCP layout: int (default), byte or plcp\n"
+                  << "  -D <byte>     with -c, the text is a collection of documents ending with this\n"
+                  << "                byte (e.g. 10 for lines); -s then also writes <output>.da\n";
+
+        exit(EXIT_FAILURE);
+    }
+
+    int threads = 1;
+    uint64_t block_size = 0;
+    uint64_t front_coding = FRONT_CODING_BUCKET;
+    uint64_t saca_memory = 0;
+    bool bwt_runs = false;
+    gcis_lcp_format lcp_format = GCIS_LCP_INT;
+    int separator = -1;
+    for (int k = 5; k < argc; k++) {
+        if (strcmp(argv[k], "-t") == 0 && k + 1 < argc) {
+            threads = atoi(argv[++k]);
+        } else if (strcmp(argv[k], "-b") == 0 && k + 1 < argc) {
+            block_size = strtoull(argv[++k], NULL, 10) << 20;
+            if (block_size == 0) {
+                cerr << "Invalid block size" << endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[k], "-f") == 0 && k + 1 < argc) {
+            front_coding = strtoull(argv[++k], NULL, 10);
+        } else if (strcmp(argv[k], "-L") == 0 && k + 1 < argc) {
+            k++;
+            if (strcmp(argv[k], "int") == 0) {
+                lcp_format = GCIS_LCP_INT;
+            } else if (strcmp(argv[k], "byte") == 0) {
+                lcp_format = GCIS_LCP_BYTE;
+            } else if (strcmp(argv[k], "plcp") == 0) {
+                lcp_format = GCIS_LCP_PLCP;
+            } else {
+                cerr << "Invalid LCP format, use int, byte or plcp" << endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[k], "-D") == 0 && k + 1 < argc) {
+            separator = strtol(argv[++k], NULL, 0);
+            if (separator < 1 || separator > 255) {
+                cerr << "Invalid document separator, use a byte from 1 to 255"
+                     << endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[k], "-r") == 0) {
+            bwt_runs = true;
+        } else if (strcmp(argv[k], "-M") == 0 && k + 1 < argc) {
+            saca_memory = strtoull(argv[++k], NULL, 10) << 20;
+            if (saca_memory == 0) {
+                cerr << "Invalid memory budget" << endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[k], "-w") == 0 && k + 1 < argc) {
+            // the width is chosen by the gc-is-codec front-end
+            if (atoi(argv[++k]) != 8 * (int)sizeof(uint_t)) {
+                cerr << "This binary uses " << 8 * sizeof(uint_t)
+                     << "-bit indexes" << endl;
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            cerr << "Invalid option " << argv[k] << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    char *mode = argv[1];
 
+    // Block containers are chosen by -b when compressing and by the file
+    // header otherwise
+    bool blocks = block_size > 0;
+    bool mapped = false;
+    if (strcmp(mode, "-c") != 0) {
+        std::ifstream input(argv[2], std::ios::binary);
+        gcis_header h;
+        bool has_header = h.load(input);
+        blocks = has_header && h.magic == GCIS_BLOCKS_MAGIC;
+        mapped = has_header && h.magic == GCIS_MAPPED_MAGIC;
+    }
+    if (mapped && strcmp(mode, "-e") != 0) {
+        cerr << "Mapped dictionaries only support extraction (-e)" << endl;
         exit(EXIT_FAILURE);
     }
 
@@ -46,22 +154,27 @@ int main(int argc, char *argv[]) {
     string codec_flag(argv[4]);
     gcis_interface* d;
     if(codec_flag == "-s8b"){
-        d = new gcis_dictionary<gcis_s8b_codec>();
+        if (blocks)
+            d = new gcis_blocks<gcis_s8b_codec>(block_size);
+        else
+            d = new gcis_dictionary<gcis_s8b_codec>();
     }
     else if(codec_flag == "-ef"){
-        d = new gcis_dictionary<gcis_eliasfano_codec>();
+        if (blocks)
+            d = new gcis_blocks<gcis_eliasfano_codec>(block_size);
+        else
+            d = new gcis_dictionary<gcis_eliasfano_codec>();
     }
     else{
         cerr << "Invalid CODEC." << endl;
         cerr << "Use -s8b for Simple8b or -ef for Elias-Fano" << endl;
         return 0;
     }
-
-    char *mode = argv[1];
+    d->set_threads(threads);
+    d->set_front_coding(front_coding);
     
     if (strcmp(mode, "-c") == 0) {
-        char *str;
-        load_string_from_file(str, argv[2]);
+        gcis_mapped_file text(argv[2]);
         std::ofstream output(argv[3], std::ios::binary);
 
 #ifdef MEM_MONITOR
@@ -69,24 +182,37 @@ int main(int argc, char *argv[]) {
 #endif
 
         auto start = timer::now();
-        d->encode(str);
+        if (separator >= 0)
+            d->encode_collection(text.data(), text.size(), (char)separator);
+        else
+            d->encode(text.data(), text.size());
         auto stop = timer::now();
 
 #ifdef MEM_MONITOR
         mm.event("GC-IS Save");
 #endif
 
-        cout << "input:\t" << strlen(str) << " bytes" << endl;
+        cout << "input:\t" << text.size() << " bytes" << endl;
         cout << "output:\t" << d->size_in_bytes() << " bytes" << endl;
+        if (separator >= 0)
+            cout << "documents:\t" << d->document_count() << endl;
         cout << "time: " << (double)duration_cast<seconds>(stop - start).count()
              << " seconds" << endl;
 
         d->serialize(output);
         output.close();
-        delete[] str;
     } else if (strcmp(mode, "-d") == 0) {
         std::ifstream input(argv[2]);
-        std::ofstream output(argv[3], std::ios::binary);
+        // "-" writes the text to the standard output, and the report to
+        // the standard error
+        bool to_stdout = strcmp(argv[3], "-") == 0;
+        std::ostream &report = to_stdout ? cerr : cout;
+        int fd = to_stdout ? STDOUT_FILENO
+                           : open(argv[3], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(argv[3]);
+            exit(EXIT_FAILURE);
+        }
 
 #ifdef MEM_MONITOR
         mm.event("GC-IS Load");
@@ -98,27 +224,43 @@ int main(int argc, char *argv[]) {
         mm.event("GC-IS Decompress");
 #endif
 
+        // A single thread streams the text to the output as it is decoded.
+        // Several threads expand each level in parallel, which needs the
+        // whole text in memory.
         auto start = timer::now();
-        char *str = d->decode();
+        if (threads == 1) {
+            d->decode_to(fd);
+        } else {
+            char *str = d->decode();
+            uint64_t n = d->text_length();
+            for (uint64_t k = 0; k < n;) {
+                ssize_t w = write(fd, str + k, n - k);
+                if (w < 0) {
+                    perror(argv[3]);
+                    exit(EXIT_FAILURE);
+                }
+                k += w;
+            }
+            delete[] str;
+        }
         auto stop = timer::now();
 
-        cout << "input:\t" << d->size_in_bytes() << " bytes" << endl;
-        cout << "output:\t" << strlen(str) << " bytes" << endl;
-        cout << "time: "
-             << (double)duration_cast<milliseconds>(stop - start).count() /
-                    1000.0
-             << setprecision(2) << fixed << " seconds" << endl;
+        report << "input:\t" << d->size_in_bytes() << " bytes" << endl;
+        report << "output:\t" << d->text_length() << " bytes" << endl;
+        report << "time: "
+               << (double)duration_cast<milliseconds>(stop - start).count() /
+                      1000.0
+               << setprecision(2) << fixed << " seconds" << endl;
 
-        output.write(str, strlen(str));
         input.close();
-        output.close();
+        if (!to_stdout)
+            close(fd);
     } else if (strcmp(mode, "-s") == 0) {
 
         std::ifstream input(argv[2]);
         string outfile1 = argv[3];
         string outfile2 = outfile1 + ".sa";
         std::ofstream output1(outfile1, std::ios::binary);
-        std::ofstream output2(outfile2, std::ios::binary);
 
 #ifdef MEM_MONITOR
         mm.event("GC-IS/SACA Load");
@@ -130,19 +272,45 @@ int main(int argc, char *argv[]) {
         mm.event("GC-IS/SACA Decompress");
 #endif
 
-        uint_t *SA;
+        // Collections also get their document array
+        bool documents = d->document_count() > 0;
+        string outfile3 = outfile1 + ".da";
+
+        uint_t *SA = NULL;
+        uint_t *DA = NULL;
+        unsigned char *str = NULL;
         std::cout << "Building SA under decoding." << std::endl;
         auto start = timer::now();
-        unsigned char *str = d->decode_saca(&SA);
+        try {
+            if (saca_memory && documents) {
+                int fd = create_output(outfile2);
+                int da_fd = create_output(outfile3);
+                str = d->decode_saca_da_external(fd, da_fd, saca_memory,
+                                                 directory_of(outfile2));
+                close(fd);
+                close(da_fd);
+            } else if (saca_memory) {
+                int fd = create_output(outfile2);
+                str = d->decode_saca_external(fd, -1, saca_memory,
+                                              directory_of(outfile2));
+                close(fd);
+            } else if (documents) {
+                str = d->decode_saca_da(&SA, &DA);
+            } else {
+                str = d->decode_saca(&SA);
+            }
+        } catch (const gcis_memory_error &e) {
+            too_little_memory(e);
+        }
         auto stop = timer::now();
 
-        size_t n = strlen((char *)str) + 1;
+        size_t n = d->text_length() + 1;
 
 #if CHECK
-        if (!d->suffix_array_check(SA, (unsigned char *)str, (uint_t)n,
-                                  sizeof(char), 0))
+        if (SA && !d->suffix_array_check(SA, (unsigned char *)str, (uint_t)n,
+                                        sizeof(char), 0))
             std::cout << "isNotSorted!!\n";
-        else
+        else if (SA)
             std::cout << "isSorted!!\n";
 #endif
 
@@ -156,12 +324,22 @@ int main(int argc, char *argv[]) {
         size_t real_n = n - 1;
         output1.write((const char *)&real_n, sizeof(real_n));
         output1.write((const char *)str, (real_n) * sizeof(char));
-        output2.write((const char *)&real_n, sizeof(real_n));
-        output2.write((const char *)&SA[1], sizeof(sa_int32_t) * real_n);
         output1.close();
-        output2.close();
+        if (SA) {
+            std::ofstream output2(outfile2, std::ios::binary);
+            output2.write((const char *)&real_n, sizeof(real_n));
+            output2.write((const char *)&SA[1], sizeof(uint_t) * real_n);
+            output2.close();
+        }
+        if (DA) {
+            std::ofstream output3(outfile3, std::ios::binary);
+            output3.write((const char *)&real_n, sizeof(real_n));
+            output3.write((const char *)&DA[1], sizeof(uint_t) * real_n);
+            output3.close();
+        }
         // input.close();
         delete[] SA;
+        delete[] DA;
     } else if (strcmp(mode, "-l") == 0) {
 
         std::ifstream input(argv[2]);
@@ -176,84 +354,250 @@ int main(int argc, char *argv[]) {
         mm.event("GC-IS/SACA_LCP Decompress");
 #endif
 
-        uint_t *SA;
-        int_t *LCP;
+        string ouf_basename(argv[3]);
+        string outfile1(ouf_basename + ".txt");
+        string outfile2 = ouf_basename + ".sa";
+        string outfile3 = ouf_basename + ".lcp";
+        if (lcp_format == GCIS_LCP_BYTE)
+            outfile3 = ouf_basename + ".lcp8";
+        else if (lcp_format == GCIS_LCP_PLCP)
+            outfile3 = ouf_basename + ".plcp";
+
+        uint_t *SA = NULL;
+        int_t *LCP = NULL;
+        unsigned char *str = NULL;
+        // Bytes of the LCP layout, the overflow table of -L byte included
+        uint64_t lcp_bytes = (d->text_length() + 1) * sizeof(int_t);
+        if (lcp_format == GCIS_LCP_PLCP)
+            lcp_bytes = (2 * d->text_length() + 63) / 64 * 8;
         std::cout << "Building SA+LCP under decoding." << std::endl;
         auto start = timer::now();
-        unsigned char *str = d->decode_saca_lcp(&SA, &LCP);
+        if (saca_memory || lcp_format != GCIS_LCP_INT) {
+            // The compact layouts are written as the suffixes are induced,
+            // with no budget if -M is not given
+            int sa_fd = create_output(outfile2);
+            int lcp_fd = create_output(outfile3);
+            int overflow_fd = lcp_format == GCIS_LCP_BYTE
+                                  ? create_output(outfile3 + ".big")
+                                  : -1;
+            try {
+                str = d->decode_saca_external(sa_fd, lcp_fd, saca_memory,
+                                              directory_of(outfile2),
+                                              lcp_format, overflow_fd);
+            } catch (const gcis_memory_error &e) {
+                too_little_memory(e);
+            }
+            close(sa_fd);
+            close(lcp_fd);
+            if (overflow_fd >= 0) {
+                lcp_bytes = d->text_length() + lseek(overflow_fd, 0, SEEK_END);
+                close(overflow_fd);
+            }
+        } else {
+            str = d->decode_saca_lcp(&SA, &LCP);
+        }
         auto stop = timer::now();
 
-        size_t n = strlen((char *)str) + 1;
+        size_t n = d->text_length() + 1;
 
 #if CHECK
-        if (!d->suffix_array_check(SA, (unsigned char *)str, (uint_t)n,
-                                  sizeof(char), 0))
-            std::cout << "isNotSorted!!\n";
-        else
-            std::cout << "isSorted!!\n";
-        if (!d->lcp_array_check(SA, LCP, (unsigned char *)str, (uint_t)n,
-                               sizeof(char), 0))
-            std::cout << "isNotLCP!!\n";
-        else
-            std::cout << "isLCP!!\n";
+        if (SA) {
+            if (!d->suffix_array_check(SA, (unsigned char *)str, (uint_t)n,
+                                      sizeof(char), 0))
+                std::cout << "isNotSorted!!\n";
+            else
+                std::cout << "isSorted!!\n";
+            if (!d->lcp_array_check(SA, LCP, (unsigned char *)str, (uint_t)n,
+                                   sizeof(char), 0))
+                std::cout << "isNotLCP!!\n";
+            else
+                std::cout << "isLCP!!\n";
+        }
 #endif
 
         cout << "input:\t" << d->size_in_bytes() << " bytes" << endl;
         cout << "output:\t" << n - 1 << " bytes" << endl;
         cout << "SA:\t" << n * sizeof(uint_t) << " bytes" << endl;
-        cout << "LCP:\t" << n * sizeof(uint_t) << " bytes" << endl;
+        cout << "LCP:\t" << lcp_bytes << " bytes" << endl;
         std::cout << "time: "
                   << (double)duration_cast<seconds>(stop - start).count()
                   << " seconds" << endl;
 
-        string ouf_basename(argv[3]);
-        string outfile1(ouf_basename + ".txt");
-        string outfile2 = ouf_basename + ".sa";
-        string outfile3 = ouf_basename + ".lcp";
         std::ofstream output1(outfile1, std::ios::binary);
-        std::ofstream output2(outfile2, std::ios::binary);
-        std::ofstream output3(outfile3, std::ios::binary);
 
         n--;
         output1.write((const char *)str, (n) * sizeof(char));
-        output2.write((const char *)&n, sizeof(n));
-        output2.write((const char *)&SA[1], sizeof(uint_t) * n);
-        output3.write((const char *)&n, sizeof(n));
-        output3.write((const char *)&LCP[1], sizeof(int_t) * n);
-
         output1.close();
-        output2.close();
-        output3.close();
+        if (SA) {
+            std::ofstream output2(outfile2, std::ios::binary);
+            std::ofstream output3(outfile3, std::ios::binary);
+            output2.write((const char *)&n, sizeof(n));
+            output2.write((const char *)&SA[1], sizeof(uint_t) * n);
+            output3.write((const char *)&n, sizeof(n));
+            output3.write((const char *)&LCP[1], sizeof(int_t) * n);
+            output2.close();
+            output3.close();
+        }
         input.close();
         delete[] SA;
         delete[] LCP;
-    } 
+    } else if (strcmp(mode, "-bwt") == 0) {
+        std::ifstream input(argv[2]);
+        d->load(input);
+
+        string outfile = argv[3];
+        int bwt_fd = create_output(outfile);
+        int runs_fd = bwt_runs ? create_output(outfile + ".runs") : -1;
+        std::cout << "Building BWT under decoding." << std::endl;
+        auto start = timer::now();
+        // Without -M, the suffixes are induced in memory and only the BWT
+        // is written
+        uint64_t memory = saca_memory ? saca_memory : UINT64_MAX;
+        unsigned char *str = NULL;
+        try {
+            str = d->decode_bwt(bwt_fd, runs_fd, memory, directory_of(outfile));
+        } catch (const gcis_memory_error &e) {
+            too_little_memory(e);
+        }
+        auto stop = timer::now();
+        close(bwt_fd);
+        if (runs_fd >= 0)
+            close(runs_fd);
+        delete[] str;
+
+        cout << "input:\t" << d->size_in_bytes() << " bytes" << endl;
+        cout << "output:\t" << d->text_length() + 1 << " bytes" << endl;
+        std::cout << "time: "
+                  << (double)duration_cast<seconds>(stop - start).count()
+                  << " seconds" << endl;
+    }
     else if (strcmp(mode, "-e") == 0) {
-        std::ifstream input(argv[2], std::ios::binary);
         std::ifstream query(argv[3]);
+        vector<pair<uint64_t, uint64_t>> v_query;
+        uint64_t l, r;
+        while (query >> l >> r) {
+            v_query.push_back(make_pair(l, r));
+        }
+
+        if (mapped) {
+            // Queried in place, without loading the dictionary
+            gcis_mapped_dictionary m(argv[2]);
+            m.extract_batch(v_query);
+        } else {
+            std::ifstream input(argv[2], std::ios::binary);
 
 #ifdef MEM_MONITOR
-        mm.event("GC-IS Load");
+            mm.event("GC-IS Load");
 #endif
 
+            d->load(input);
+
+#ifdef MEM_MONITOR
+            mm.event("GC-IS Extract");
+#endif
+            d->extract_batch(v_query);
+        }
+    } else if (strcmp(mode, "-count") == 0 || strcmp(mode, "-locate") == 0) {
+        bool locate = strcmp(mode, "-locate") == 0;
+        std::ifstream query(argv[3]);
+        vector<string> patterns;
+        string pattern;
+        while (std::getline(query, pattern)) {
+            patterns.push_back(pattern);
+        }
+
+        std::ifstream input(argv[2], std::ios::binary);
         d->load(input);
 
 #ifdef MEM_MONITOR
-        mm.event("GC-IS Extract");
+        mm.event("GC-IS Search Index");
 #endif
-        vector<pair<int, int>> v_query;
-        uint64_t l, r;
-        while (query >> l >> r) {
-            v_query.push_back(make_pair(l, r));
+
+        gcis_search_index index;
+        if (auto *ef = dynamic_cast<gcis_dictionary<gcis_eliasfano_codec> *>(d)) {
+            index.build(*ef);
+        } else if (auto *s8b =
+                       dynamic_cast<gcis_dictionary<gcis_s8b_codec> *>(d)) {
+            index.build(*s8b);
+        } else {
+            cerr << "Search is not available for block containers" << endl;
+            exit(EXIT_FAILURE);
+        }
+        cout << "index:\t" << index.size_in_bytes() << " bytes" << endl;
+
+#ifdef MEM_MONITOR
+        mm.event("GC-IS Search");
+#endif
+
+        auto start = timer::now();
+        for (const string &p : patterns) {
+            if (locate) {
+                vector<uint64_t> occ = index.locate(p);
+                cout << occ.size();
+                for (uint64_t x : occ) {
+                    cout << " " << x;
+                }
+                cout << endl;
+            } else {
+                cout << index.count(p) << endl;
+            }
+        }
+        auto stop = timer::now();
+        std::chrono::duration<double> elapsed = stop - start;
+        cout << "Search Total time(s): " << elapsed.count() << endl;
+    } else if (strcmp(mode, "-lce") == 0) {
+        std::ifstream query(argv[3]);
+        vector<pair<uint64_t, uint64_t>> v_query;
+        uint64_t i, j;
+        while (query >> i >> j) {
+            v_query.push_back(make_pair(i, j));
         }
-        d->extract_batch(v_query);
+
+        std::ifstream input(argv[2], std::ios::binary);
+        d->load(input);
+
+#ifdef MEM_MONITOR
+        mm.event("GC-IS Fingerprints");
+#endif
+
+        try {
+            d->build_fingerprints();
+        } catch (const NotImplementedException &e) {
+            cerr << "LCE queries need an Elias-Fano dictionary without blocks"
+                 << endl;
+            exit(EXIT_FAILURE);
+        }
+
+#ifdef MEM_MONITOR
+        mm.event("GC-IS LCE");
+#endif
+
+        vector<uint64_t> result;
+        auto start = timer::now();
+        d->lce_batch(v_query, result);
+        auto stop = timer::now();
+        for (uint64_t x : result) {
+            cout << x << endl;
+        }
+        std::chrono::duration<double> elapsed = stop - start;
+        cout << "LCE Total time(s): " << elapsed.count() << endl;
+    } else if (strcmp(mode, "-m") == 0) {
+        std::ifstream input(argv[2], std::ios::binary);
+        std::ofstream output(argv[3], std::ios::binary);
+        d->load(input);
+        d->serialize_mapped(output);
+        output.close();
     } else {
         std::cerr << "Invalid mode, use: " << endl
                   << "-c for compression;" << endl
                   << "-d for decompression;" << endl
                   << "-e for extraction;" << endl
+                  << "-count and -locate for pattern search;" << endl
+                  << "-lce for longest common extensions;" << endl
+                  << "-m for writing the memory-mappable layout;" << endl
                   << "-s for building SA under decompression" << endl
-                  << "-l for building SA+LCP under decompression" << endl;
+                  << "-l for building SA+LCP under decompression" << endl
+                  << "-bwt for building the BWT under decompression" << endl;
 
         exit(EXIT_FAILURE);
     }
@@ -3,22 +3,12 @@
 #include <fstream>
 #include <iostream>
 #include <chrono> 
+#include "gcis_mapped_file.hpp"
 
 using namespace std;
 using namespace std::chrono;
 using timer = std::chrono::high_resolution_clock;
 
-void load_string_from_file(char *&str, char *filename) {
-    std::ifstream f(filename, std::ios::binary);
-    f.seekg(0, std::ios::end);
-    uint64_t size = f.tellg();
-    f.seekg(0, std::ios::beg);
-    str = new char[size + 1];
-    f.read(str, size);
-    str[size] = 0;
-    f.close();
-};
-
 int main(int argc, char *argv[]) {
 
     if (argc != 3) {
@@ -26,10 +16,10 @@ int main(int argc, char *argv[]) {
                   << std::endl;
         exit(EXIT_FAILURE);
     }
-    char *str;
-    load_string_from_file(str, argv[1]);
+    gcis_mapped_file text(argv[1]);
+    const char *str = text.data();
 
-    size_t n = strlen(str) + 1;
+    size_t n = text.size() + 1;
     sa_int32_t *SA = new sa_int32_t[n];
     sa_int32_t k = 256;
 
@@ -38,7 +28,7 @@ int main(int argc, char *argv[]) {
     sais_u8((sa_uint8_t *)str, SA, n, k);
     auto stop = timer::now();
 
-    cout << "input:\t" << strlen(str) << " bytes" << endl;
+    cout << "input:\t" << text.size() << " bytes" << endl;
 
     cout << "time: "
          << (double)duration_cast<milliseconds>(stop - start).count() / 1000.0
@@ -2,18 +2,7 @@
 #include <fstream>
 #include <cstring>
 #include "sais.h"
-
-
-void load_string_from_file(char*& str,char* filename){
-        std::ifstream f(filename,std::ios::binary);
-        f.seekg (0, std::ios::end);
-        uint64_t size = f.tellg();
-        f.seekg(0,std::ios::beg);
-        str = new char[size+1];
-        f.read(str,size);
-        str[size]=0;
-        f.close();
-};
+#include "gcis_mapped_file.hpp"
 
 
 int main(int argc, char* argv[]){
@@ -22,10 +11,10 @@ int main(int argc, char* argv[]){
         std::cerr << "Usage: ./sais -c <input_file> <output_file>" << std::endl;
         exit(EXIT_FAILURE);
     }
-    char* str;
-    load_string_from_file(str, argv[2]);
+    gcis_mapped_file text(argv[2]);
+    const char *str = text.data();
 
-    size_t n = strlen(str)+1;
+    size_t n = text.size()+1;
     sa_int32_t* SA = new sa_int32_t[n];    
     sa_int32_t k = 256;
 
@@ -0,0 +1,945 @@
+#include <vector>
+#include <cstdint>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "gcis_eliasfano.hpp"
+#include "gcis_eliasfano_no_lcp.hpp"
+#include "gcis_blocks.hpp"
+#include "gcis_gap.hpp"
+#include "gcis_s8b.hpp"
+#include "gcis_mapped_file.hpp"
+#include "gcis_partial_sum.hpp"
+#include "gcis_search_index.hpp"
+
+// Repetitive text (without \0) large enough to span several induction blocks
+static std::string repetitive_text(uint64_t n, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::string base;
+    for (uint64_t i = 0; i < 4096; i++) {
+        base.push_back('a' + gen() % 26);
+    }
+    std::string text;
+    while (text.size() < n) {
+        uint64_t l = gen() % (base.size() - 512);
+        text.append(base, l, 64 + gen() % 448);
+        text.push_back('A' + gen() % 26);
+    }
+    text.resize(n);
+    return text;
+}
+
+static std::string encode_to_string(std::string text, int threads) {
+    gcis_dictionary<gcis_eliasfano_codec> d;
+    d.set_threads(threads);
+    d.encode(&text[0]);
+    std::stringstream ss;
+    d.serialize(ss);
+    return ss.str();
+}
+
+// Names the typed tests after their codec
+struct gcis_codec_names {
+    template <class codec_t> static std::string GetName(int) {
+        return std::is_same<codec_t, gcis_eliasfano_codec>::value ? "eliasfano"
+               : std::is_same<codec_t, gcis_gap_codec>::value     ? "gap"
+               : std::is_same<codec_t, gcis_s8b_codec>::value     ? "s8b"
+                                                                  : "eliasfano_no_lcp";
+    }
+};
+
+// Codecs that extract single rules, which the level cache, the streaming
+// decoder and the extraction of substrings are built on
+template <class codec_t> class gcis_codec : public ::testing::Test {};
+typedef ::testing::Types<gcis_eliasfano_codec, gcis_gap_codec> gcis_codecs;
+TYPED_TEST_SUITE(gcis_codec, gcis_codecs, gcis_codec_names);
+
+// Codecs whose dictionaries also write the suffix array of the text to
+// files and build the search index
+template <class codec_t> class gcis_saca_codec : public ::testing::Test {};
+typedef ::testing::Types<gcis_eliasfano_codec, gcis_gap_codec, gcis_s8b_codec>
+    gcis_saca_codecs;
+TYPED_TEST_SUITE(gcis_saca_codec, gcis_saca_codecs, gcis_codec_names);
+
+// Codecs whose dictionaries induce the suffix array of the text
+template <class codec_t> class gcis_decode_saca : public ::testing::Test {};
+typedef ::testing::Types<gcis_eliasfano_codec, gcis_gap_codec, gcis_s8b_codec,
+                         gcis_eliasfano_codec_no_lcp>
+    gcis_decode_saca_codecs;
+TYPED_TEST_SUITE(gcis_decode_saca, gcis_decode_saca_codecs, gcis_codec_names);
+
+TEST(gcis_encode, parallel_induction_is_deterministic){
+    std::string text = repetitive_text(3 * INDUCE_BLOCK + 123, 42);
+    std::string seq = encode_to_string(text, 1);
+    EXPECT_EQ(encode_to_string(text, 2), seq);
+    EXPECT_EQ(encode_to_string(text, 4), seq);
+}
+
+TEST(gcis_encode, parallel_induction_decode){
+    std::string text = repetitive_text(3 * INDUCE_BLOCK + 123, 7);
+    std::stringstream ss(encode_to_string(text, 4));
+    gcis_dictionary<gcis_eliasfano_codec> d;
+    d.load(ss);
+    char *str = d.decode();
+    EXPECT_EQ(std::string(str), text);
+    delete[] str;
+}
+
+TEST(gcis_blocks, encode_decode_extract){
+    std::string text = repetitive_text(100000, 3);
+    gcis_blocks<gcis_eliasfano_codec> d(30000);
+    d.set_threads(4);
+    d.encode(&text[0]);
+    EXPECT_EQ(d.blocks.size(), 4u);
+
+    std::stringstream ss;
+    d.serialize(ss);
+    gcis_blocks<gcis_eliasfano_codec> d2;
+    d2.set_threads(4);
+    d2.load(ss);
+    char *str = d2.decode();
+    EXPECT_EQ(std::string(str), text);
+    delete[] str;
+
+    // queries inside a block, across a block boundary and spanning blocks
+    std::vector<std::pair<uint64_t, uint64_t>> queries = {
+        {0, 10}, {29990, 30010}, {59000, 91000}, {99990, 99999}};
+    for (auto q : queries) {
+        std::string out(q.second - q.first + 1, 0);
+        d2.extract(q.first, q.second, (unsigned char *)&out[0]);
+        EXPECT_EQ(out, text.substr(q.first, q.second - q.first + 1));
+    }
+}
+
+TEST(gcis_encode, binary_text){
+    std::string text = repetitive_text(50000, 11);
+    for (uint64_t i = 0; i < text.size(); i += 97) {
+        text[i] = i % 3 ? '\0' : '\xff';
+    }
+    gcis_dictionary<gcis_eliasfano_codec> d;
+    d.encode(text.data(), text.size());
+    EXPECT_EQ(d.text_length(), text.size());
+
+    std::stringstream ss;
+    d.serialize(ss);
+    gcis_dictionary<gcis_eliasfano_codec> d2;
+    d2.load(ss);
+    char *str = d2.decode();
+    EXPECT_EQ(std::string(str, d2.text_length()), text);
+    delete[] str;
+
+    std::string out(1000, 0);
+    d2.extract(1234, 2233, (unsigned char *)&out[0]);
+    EXPECT_EQ(out, text.substr(1234, 1000));
+
+    gcis_blocks<gcis_eliasfano_codec> b(20000);
+    b.encode(text.data(), text.size());
+    str = b.decode();
+    EXPECT_EQ(b.text_length(), text.size());
+    EXPECT_EQ(std::string(str, b.text_length()), text);
+    delete[] str;
+}
+
+TEST(gcis_mapped_file, contents_and_sentinel){
+    std::string text = repetitive_text(10000, 5);
+    text[100] = '\0';
+    std::string path = ::testing::TempDir() + "gcis_mapped_file.txt";
+    std::ofstream(path, std::ios::binary) << text;
+    gcis_mapped_file f(path.c_str());
+    ASSERT_EQ(f.size(), text.size());
+    EXPECT_EQ(std::string(f.data(), f.size()), text);
+    EXPECT_EQ(f.data()[f.size()], 0);
+    EXPECT_THROW(gcis_mapped_file((path + ".missing").c_str()),
+                 std::runtime_error);
+}
+
+TYPED_TEST(gcis_codec, mapped_extract){
+    uint32_t seed = 13;
+    std::string text = repetitive_text(80000, seed);
+    gcis_dictionary<TypeParam> d;
+    d.encode(text.data(), text.size());
+    std::string path = ::testing::TempDir() + "gcis_mapped.gcm";
+    {
+        std::ofstream o(path, std::ios::binary);
+        d.serialize_mapped(o);
+    }
+    gcis_mapped_dictionary m(path.c_str());
+    EXPECT_EQ(m.text_length(), text.size());
+
+    std::mt19937 gen(seed);
+    std::vector<std::pair<uint64_t, uint64_t>> queries = {
+        {0, 0}, {0, text.size() - 1}, {text.size() - 1, text.size() - 1}};
+    for (int i = 0; i < 200; i++) {
+        uint64_t l = gen() % text.size();
+        queries.push_back({l, std::min<uint64_t>(l + gen() % 500, text.size() - 1)});
+    }
+    for (auto q : queries) {
+        std::string out(q.second - q.first + 1, 0);
+        m.extract(q.first, q.second, (unsigned char *)&out[0]);
+        EXPECT_EQ(out, text.substr(q.first, q.second - q.first + 1));
+    }
+}
+
+TYPED_TEST(gcis_codec, parallel_decode){
+    std::string text = repetitive_text(3 * INDUCE_BLOCK + 123, 19);
+    gcis_dictionary<TypeParam> d;
+    d.encode(text.data(), text.size());
+    for (int threads : {1, 2, 4}) {
+        d.set_threads(threads);
+        char *str = d.decode();
+        EXPECT_EQ(std::string(str, d.text_length()), text);
+        delete[] str;
+    }
+}
+
+// Exposes expand_level to drive it with a hand-made level
+class expand_level_dictionary : public gcis_dictionary<gcis_eliasfano_codec> {
+  public:
+    using gcis_dictionary<gcis_eliasfano_codec>::expand_level;
+};
+
+// Level whose rule r is the single symbol r
+struct unit_rule_level {
+    sdsl::int_vector<> rule;
+    uint64_t rule_start(uint64_t r) { return r; }
+    uint64_t rule_length(uint64_t) { return 1; }
+    template <class out_t> void expand_rule(uint64_t r, out_t &out, uint64_t &l) {
+        out[l++] = rule[r];
+    }
+};
+
+// Output that records the writes past its end instead of making them
+struct checked_output {
+    std::vector<uint64_t> v;
+    uint64_t overflow = 0, dummy;
+    uint64_t &operator[](uint64_t i) {
+        if (i < v.size())
+            return v[i];
+        overflow++;
+        return dummy;
+    }
+};
+
+TEST(gcis_decode, parallel_expand_short_last_chunk){
+    // The last chunk holds a single symbol, ending within 64 positions of
+    // the end of the output
+    uint64_t m = 2 * EXPAND_CHUNK + 1, tail_len = 5;
+    unit_rule_level level;
+    level.rule = sdsl::int_vector<>(m);
+    sdsl::int_vector<> tail(tail_len), r_string(m);
+    for (uint64_t i = 0; i < m; i++) {
+        level.rule[i] = i;
+        r_string[i] = m - 1 - i;
+    }
+    for (uint64_t i = 0; i < tail_len; i++) {
+        tail[i] = m + i;
+    }
+    expand_level_dictionary d;
+    d.set_threads(4);
+    checked_output out;
+    out.v.assign(tail_len + m, UINT64_MAX);
+    d.expand_level(level, tail, r_string, out);
+    EXPECT_EQ(out.overflow, 0u);
+    for (uint64_t i = 0; i < tail_len; i++) {
+        ASSERT_EQ(out.v[i], m + i);
+    }
+    for (uint64_t i = 0; i < m; i++) {
+        ASSERT_EQ(out.v[tail_len + i], m - 1 - i);
+    }
+}
+
+TYPED_TEST(gcis_codec, level_cache){
+    std::string text = repetitive_text(100000, 29);
+    gcis_dictionary<TypeParam> d;
+    d.encode(text.data(), text.size());
+    // a budget of 1 byte keeps no level, 1 GiB keeps all of them
+    for (uint64_t budget : {1ULL, 1ULL << 30}) {
+        d.set_level_cache(budget);
+        bool keeps = budget > 1;
+        for (int k = 0; k < 2; k++) {
+            uint64_t hits = d.level_cache_hits();
+            uint64_t misses = d.level_cache_misses();
+            char *str = d.decode();
+            EXPECT_EQ(std::string(str, d.text_length()), text);
+            delete[] str;
+            // the second decode finds every level cached
+            if (keeps && k == 1) {
+                EXPECT_GT(d.level_cache_hits(), hits);
+                EXPECT_EQ(d.level_cache_misses(), misses);
+            } else {
+                EXPECT_EQ(d.level_cache_hits(), hits);
+                EXPECT_GT(d.level_cache_misses(), misses);
+            }
+        }
+        uint64_t hits = d.level_cache_hits();
+        std::string out(1000, 0);
+        d.extract(5000, 5999, (unsigned char *)&out[0]);
+        EXPECT_EQ(out, text.substr(5000, 1000));
+        if (keeps)
+            EXPECT_GT(d.level_cache_hits(), hits);
+        else
+            EXPECT_EQ(d.level_cache_hits(), hits);
+    }
+}
+
+TYPED_TEST(gcis_codec, stream){
+    std::string text = repetitive_text(100000, 37);
+    for (uint64_t i = 0; i < text.size(); i += 101) {
+        text[i] = '\0';
+    }
+    gcis_dictionary<TypeParam> d;
+    d.encode(text.data(), text.size());
+
+    auto dec = d.decoder();
+    EXPECT_EQ(dec->size(), text.size());
+    std::string it_text(dec->begin(), dec->end());
+    EXPECT_EQ(it_text, text);
+    EXPECT_EQ(dec->position(), text.size());
+
+    // reads of sizes that do not match the chunks of the levels
+    dec = d.decoder();
+    std::string read_text;
+    char buf[777];
+    uint64_t n;
+    while ((n = dec->read(buf, sizeof(buf))) > 0) {
+        read_text.append(buf, n);
+    }
+    EXPECT_EQ(read_text, text);
+
+    std::string path = ::testing::TempDir() + "gcis_stream.txt";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    d.decode_to(fd);
+    close(fd);
+    gcis_mapped_file f(path.c_str());
+    EXPECT_EQ(std::string(f.data(), f.size()), text);
+}
+
+TEST(gcis_stream, blocks){
+    std::string text = repetitive_text(100000, 43);
+    gcis_blocks<gcis_eliasfano_codec> b(30000);
+    b.encode(text.data(), text.size());
+    std::string path = ::testing::TempDir() + "gcis_stream_blocks.txt";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    b.decode_to(fd);
+    close(fd);
+    gcis_mapped_file f(path.c_str());
+    EXPECT_EQ(std::string(f.data(), f.size()), text);
+}
+
+// Exposes the grouping of extract_batch
+struct coalesce_access : gcis_interface {
+    using gcis_interface::coalesce_queries;
+};
+
+// Text long enough for a query longer than EXTRACT_GROUP_MAX
+static const uint64_t EXTRACT_BATCH_TEXT = EXTRACT_GROUP_MAX + 300000;
+
+template <class dict_t> static void check_extract_batch(dict_t &d, const std::string &text) {
+    std::mt19937 gen(7);
+    uint64_t n = text.size();
+    // isolated queries, most of them alone in their group
+    std::vector<std::pair<uint64_t, uint64_t>> query = {{n - 1, n - 1}};
+    for (int i = 0; i < 300; i++) {
+        uint64_t l = gen() % n;
+        query.push_back({l, std::min<uint64_t>(l + gen() % 2000, n - 1)});
+    }
+    // far-apart clusters of overlapping, repeated and nearby queries
+    for (uint64_t c = 0; c < 5; c++) {
+        uint64_t base = c * (n / 5);
+        for (int i = 0; i < 60; i++) {
+            uint64_t l = base + gen() % 3000;
+            query.push_back({l, l + gen() % 1000});
+        }
+        query.push_back(query.back());
+    }
+    // a query longer than EXTRACT_GROUP_MAX, if the text has room for it.
+    // The isolated queries of a shorter text fall into shared groups.
+    bool long_text = n >= EXTRACT_BATCH_TEXT;
+    if (long_text)
+        query.push_back({10, 10 + EXTRACT_GROUP_MAX + 5000});
+
+    std::vector<uint64_t> order, begin;
+    std::vector<std::pair<uint64_t, uint64_t>> group;
+    coalesce_access::coalesce_queries(query, order, group, begin);
+    uint64_t single = 0, shared = 0, longest = 0;
+    for (uint64_t k = 0; k < group.size(); k++) {
+        (begin[k + 1] - begin[k] == 1 ? single : shared)++;
+        longest = std::max<uint64_t>(longest,
+                                     group[k].second - group[k].first + 1);
+    }
+    EXPECT_GE(shared, 5u);
+    if (long_text) {
+        EXPECT_GT(single, 0u);
+        EXPECT_GT(longest, EXTRACT_GROUP_MAX);
+    }
+
+    std::vector<std::string> text_out(query.size());
+    std::vector<unsigned char *> out(query.size());
+    for (uint64_t k = 0; k < query.size(); k++) {
+        text_out[k].resize(query[k].second - query[k].first + 1);
+        out[k] = (unsigned char *)&text_out[k][0];
+    }
+    d.set_threads(4);
+    d.extract_batch(query, out);
+    for (uint64_t k = 0; k < query.size(); k++) {
+        EXPECT_EQ(text_out[k], text.substr(query[k].first,
+                                           query[k].second - query[k].first + 1));
+    }
+}
+
+TYPED_TEST(gcis_codec, extract_batch){
+    std::string text = repetitive_text(EXTRACT_BATCH_TEXT, 47);
+    gcis_dictionary<TypeParam> d;
+    d.encode(text.data(), text.size());
+    check_extract_batch(d, text);
+}
+
+TEST(gcis_extract_batch, blocks){
+    std::string text = repetitive_text(EXTRACT_BATCH_TEXT, 59);
+    gcis_blocks<gcis_eliasfano_codec> d(300000);
+    d.encode(text.data(), text.size());
+    check_extract_batch(d, text);
+}
+
+TYPED_TEST(gcis_codec, position_index){
+    // periodic runs give the levels above 0 rules of many symbols
+    uint32_t seed = 67;
+    std::mt19937 gen(seed);
+    std::string text = repetitive_text(60000, seed);
+    for (int i = 0; i < 20; i++) {
+        std::string period = text.substr(gen() % 50000, 1 + gen() % 5);
+        std::string run;
+        for (uint64_t k = 200 + gen() % 2000; k > 0; k--) {
+            run += period;
+        }
+        text.insert(gen() % text.size(), run);
+    }
+    for (bool plain_lengths : {false, true}) {
+        gcis_dictionary<TypeParam> d;
+        d.encode(text.data(), text.size());
+        d.build_position_index(plain_lengths);
+        EXPECT_GT(d.position_index_size_in_bytes(), 0u);
+        check_extract_batch(d, text);
+    }
+}
+
+template <class codec_t>
+static void check_rule_buckets(gcis_dictionary<codec_t> &d, uint64_t n,
+                               gcis_bucket_cache &cache) {
+    sdsl::int_vector<> walked(n), cached(n);
+    for (uint64_t level = 0; level < d.g.size(); level++) {
+        codec_t &c = d.g[level];
+        uint64_t n_rules = c.fully_decoded_rule_len.size();
+        // forwards, so that the decoded buckets are extended, then
+        // backwards, so that the slots of the cache are replaced
+        for (uint64_t i = 0; i < 2 * n_rules; i++) {
+            uint64_t r = i < n_rules ? i : 2 * n_rules - 1 - i;
+            uint64_t k1 = 0, k2 = 0;
+            c.extract_rule(r, walked, k1);
+            cache.expand_rule(level, c, r, cached, k2);
+            ASSERT_EQ(k1, k2);
+            for (uint64_t i = 0; i < k1; i++) {
+                ASSERT_EQ(walked[i], cached[i]);
+            }
+        }
+    }
+}
+
+TYPED_TEST(gcis_codec, rule_buckets){
+    std::string text = repetitive_text(100000, 73);
+    gcis_dictionary<TypeParam> d;
+    d.encode(text.data(), text.size());
+    // a cache first filled from a dictionary with fewer buckets, as the
+    // blocks of a container share it
+    std::string prefix = text.substr(0, 2000);
+    gcis_dictionary<TypeParam> small;
+    small.encode(prefix.data(), prefix.size());
+    gcis_bucket_cache cache;
+    check_rule_buckets(small, prefix.size(), cache);
+    check_rule_buckets(d, text.size(), cache);
+    uint64_t rules = d.g[0].fully_decoded_rule_len.size();
+    EXPECT_EQ(cache.slots(0),
+              std::min<uint64_t>(rules / d.g[0].front_coding_bucket + 1,
+                                 BUCKET_CACHE_SLOTS));
+}
+
+TYPED_TEST(gcis_codec, front_coding){
+    std::string text = repetitive_text(100000, 83);
+    std::mt19937 gen(83);
+    uint64_t prev_size = 0;
+    for (uint64_t bucket : {1, 7, 32, 256, 0}) {
+        gcis_dictionary<TypeParam> d, d2;
+        d.set_front_coding(bucket);
+        d.encode(text.data(), text.size());
+        std::stringstream ss;
+        d.serialize(ss);
+        d2.load(ss);
+        ASSERT_EQ(d.g.size(), d2.g.size());
+        for (uint64_t i = 0; i < d.g.size(); i++) {
+            uint64_t b = d2.g[i].front_coding_bucket;
+            EXPECT_EQ(b, d.g[i].front_coding_bucket);
+            if (bucket) {
+                EXPECT_EQ(b, bucket);
+            } else {
+                EXPECT_TRUE(b <= FRONT_CODING_MAX_BUCKET && (b & (b - 1)) == 0);
+            }
+        }
+        // larger buckets store fewer LCPs as rule symbols
+        if (bucket) {
+            if (prev_size) {
+                EXPECT_LE(d.size_in_bytes(), prev_size);
+            }
+            prev_size = d.size_in_bytes();
+        }
+        char *str = d2.decode();
+        EXPECT_EQ(std::string(str, text.size()), text);
+        delete[] str;
+        for (int q = 0; q < 200; q++) {
+            uint64_t l = gen() % text.size();
+            uint64_t r = std::min<uint64_t>(text.size() - 1, l + gen() % 500);
+            std::string out(r - l + 1, 0);
+            d2.extract(l, r, (unsigned char *)&out[0]);
+            ASSERT_EQ(out, text.substr(l, r - l + 1));
+        }
+        gcis_bucket_cache cache;
+        check_rule_buckets(d2, text.size(), cache);
+    }
+}
+
+// Checks decode_saca and decode_saca_lcp against a plain sort of the
+// suffixes of the text with its sentinel
+template <class codec_t> static void check_decode_saca(const std::string &text) {
+    gcis_dictionary<codec_t> d;
+    d.encode(text.data(), text.size());
+    uint64_t n = text.size() + 1;
+    std::string t = text + '\0';
+    std::vector<uint64_t> sa(n), rank(n), lcp(n, 0);
+    for (uint64_t i = 0; i < n; i++) {
+        sa[i] = i;
+    }
+    std::sort(sa.begin(), sa.end(), [&](uint64_t a, uint64_t b) {
+        return t.compare(a, n, t, b, n) < 0;
+    });
+    for (uint64_t i = 0; i < n; i++) {
+        rank[sa[i]] = i;
+    }
+    for (uint64_t i = 0, h = 0; i < n; i++) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        uint64_t j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && t[i + h] == t[j + h])
+            h++;
+        lcp[rank[i]] = h;
+        if (h)
+            h--;
+    }
+
+    uint_t *SA;
+    int_t *LCP;
+    unsigned char *str = d.decode_saca(&SA);
+    EXPECT_EQ(std::string((char *)str, text.size()), text);
+    for (uint64_t i = 0; i < n; i++) {
+        ASSERT_EQ((uint64_t)SA[i], sa[i]);
+    }
+    delete[] str;
+    delete[] SA;
+    str = d.decode_saca_lcp(&SA, &LCP);
+    EXPECT_EQ(std::string((char *)str, text.size()), text);
+    for (uint64_t i = 0; i < n; i++) {
+        ASSERT_EQ((uint64_t)SA[i], sa[i]);
+        ASSERT_EQ((uint64_t)LCP[i], lcp[i]);
+    }
+    delete[] str;
+    delete[] SA;
+    delete[] LCP;
+}
+
+TYPED_TEST(gcis_decode_saca, sequential){
+    check_decode_saca<TypeParam>(repetitive_text(50000, 97));
+    // short random texts, which the s8b encoder stores without levels
+    std::mt19937 gen(97);
+    std::string text;
+    for (int i = 0; i < 300; i++) {
+        text.push_back('a' + gen() % 26);
+    }
+    check_decode_saca<TypeParam>(text);
+    check_decode_saca<TypeParam>("a");
+}
+
+// Checks that decode_saca and decode_saca_lcp with several threads give the
+// arrays of the sequential induction
+TYPED_TEST(gcis_codec, parallel_decode_saca){
+    std::string text = repetitive_text(3 * INDUCE_BLOCK + 123, 109);
+    gcis_dictionary<TypeParam> d;
+    d.encode(text.data(), text.size());
+    uint64_t n = text.size() + 1;
+    uint_t *SA1, *SA;
+    int_t *LCP1, *LCP;
+    d.set_threads(1);
+    delete[] d.decode_saca_lcp(&SA1, &LCP1);
+    for (int threads : {2, 4}) {
+        d.set_threads(threads);
+        unsigned char *str = d.decode_saca(&SA);
+        EXPECT_EQ(std::string((char *)str, text.size()), text);
+        for (uint64_t i = 0; i < n; i++) {
+            ASSERT_EQ(SA[i], SA1[i]);
+        }
+        delete[] str;
+        delete[] SA;
+        str = d.decode_saca_lcp(&SA, &LCP);
+        for (uint64_t i = 0; i < n; i++) {
+            ASSERT_EQ(SA[i], SA1[i]);
+            ASSERT_EQ(LCP[i], LCP1[i]);
+        }
+        delete[] str;
+        delete[] SA;
+        delete[] LCP;
+    }
+    delete[] SA1;
+    delete[] LCP1;
+}
+
+// Checks that decode_saca_external writes the arrays of decode_saca_lcp,
+// and decode_bwt the BWT they give, without a budget, which spills every
+// large bucket, and with a budget that holds the arrays
+template <class codec_t>
+static void check_decode_saca_external(const std::string &text) {
+    gcis_dictionary<codec_t> d;
+    d.encode(text.data(), text.size());
+    uint_t *SA;
+    int_t *LCP;
+    delete[] d.decode_saca_lcp(&SA, &LCP);
+    uint64_t n = text.size();
+    std::string header((char *)&n, sizeof(size_t));
+    std::string sa = header + std::string((char *)&SA[1], n * sizeof(uint_t));
+    std::string lcp = header + std::string((char *)&LCP[1], n * sizeof(int_t));
+    std::string lcp8 = header, big;
+    std::vector<uint64_t> plcp((2 * n + 63) / 64);
+    for (uint64_t i = 1; i <= n; i++) {
+        lcp8.push_back(LCP[i] < 255 ? (char)LCP[i] : (char)255);
+        if (LCP[i] >= 255) {
+            uint_t entry = i - 1;
+            int_t value = LCP[i];
+            big.append((char *)&entry, sizeof(entry));
+            big.append((char *)&value, sizeof(value));
+        }
+        uint64_t b = 2 * (uint64_t)SA[i] + (uint64_t)LCP[i];
+        plcp[b / 64] |= 1ULL << (b % 64);
+    }
+    std::string plcp_file =
+        header + std::string((char *)plcp.data(), plcp.size() * 8);
+    std::string bwt, runs;
+    for (uint64_t i = 0; i <= n; i++) {
+        bwt.push_back(SA[i] ? text[SA[i] - 1] : 0);
+        if (i == 0 || bwt[i] != bwt[i - 1]) {
+            uint_t r = i;
+            runs.append((char *)&r, sizeof(r));
+        }
+    }
+    delete[] SA;
+    delete[] LCP;
+
+    std::string sa_path = ::testing::TempDir() + "gcis_external.sa";
+    std::string lcp_path = ::testing::TempDir() + "gcis_external.lcp";
+    auto contents = [](const std::string &path) {
+        std::ifstream i(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(i),
+                           std::istreambuf_iterator<char>());
+    };
+    for (bool with_lcp : {false, true}) {
+        int sa_fd = open(sa_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int lcp_fd = with_lcp ? open(lcp_path.c_str(),
+                                     O_WRONLY | O_CREAT | O_TRUNC, 0644)
+                              : -1;
+        // a budget that holds none of the arrays
+        EXPECT_THROW(d.decode_saca_external(sa_fd, lcp_fd, 1,
+                                            ::testing::TempDir()),
+                     gcis_memory_error);
+        unsigned char *str =
+            d.decode_saca_external(sa_fd, lcp_fd, 0, ::testing::TempDir());
+        close(sa_fd);
+        EXPECT_EQ(std::string((char *)str, n), text);
+        delete[] str;
+        EXPECT_TRUE(contents(sa_path) == sa);
+        if (with_lcp) {
+            close(lcp_fd);
+            EXPECT_TRUE(contents(lcp_path) == lcp);
+        }
+    }
+    std::string big_path = ::testing::TempDir() + "gcis_external.big";
+    // the values of 255 or more need their own file
+    int sa_fd = open(sa_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int lcp_fd = open(lcp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    EXPECT_THROW(d.decode_saca_external(sa_fd, lcp_fd, 0, ::testing::TempDir(),
+                                        GCIS_LCP_BYTE),
+                 std::invalid_argument);
+    close(sa_fd);
+    close(lcp_fd);
+    for (uint64_t memory : {(uint64_t)0, UINT64_MAX}) {
+        for (gcis_lcp_format format : {GCIS_LCP_BYTE, GCIS_LCP_PLCP}) {
+            int sa_fd =
+                open(sa_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            int lcp_fd =
+                open(lcp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            int big_fd =
+                open(big_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            delete[] d.decode_saca_external(sa_fd, lcp_fd, memory,
+                                            ::testing::TempDir(), format,
+                                            big_fd);
+            close(sa_fd);
+            close(lcp_fd);
+            close(big_fd);
+            EXPECT_TRUE(contents(sa_path) == sa);
+            if (format == GCIS_LCP_BYTE) {
+                EXPECT_TRUE(contents(lcp_path) == lcp8);
+                EXPECT_TRUE(contents(big_path) == big);
+            } else {
+                EXPECT_TRUE(contents(lcp_path) == plcp_file);
+                EXPECT_TRUE(contents(big_path).empty());
+            }
+        }
+    }
+    for (uint64_t memory : {(uint64_t)0, UINT64_MAX}) {
+        int bwt_fd = open(sa_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int runs_fd = open(lcp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        delete[] d.decode_bwt(bwt_fd, runs_fd, memory, ::testing::TempDir());
+        close(bwt_fd);
+        close(runs_fd);
+        EXPECT_TRUE(contents(sa_path) == bwt);
+        EXPECT_TRUE(contents(lcp_path) == runs);
+    }
+}
+
+TYPED_TEST(gcis_saca_codec, decode_saca_external){
+    check_decode_saca_external<TypeParam>(repetitive_text(100000, 127));
+    // long runs of equal symbols
+    std::mt19937 gen(127);
+    std::string text;
+    while (text.size() < 50000) {
+        text.append(1 + gen() % 300, 'a' + gen() % 3);
+    }
+    check_decode_saca_external<TypeParam>(text);
+    check_decode_saca_external<TypeParam>("a");
+}
+
+// Checks that a collection keeps its documents through serialize and load,
+// and that decode_saca_da and decode_saca_da_external give the document of
+// every suffix
+TYPED_TEST(gcis_saca_codec, document_array){
+    std::mt19937 gen(139);
+    std::string base = repetitive_text(20000, 139);
+    std::string text;
+    std::vector<uint64_t> doc;
+    for (int k = 0; k < 50; k++) {
+        uint64_t l = gen() % (base.size() - 3000);
+        text.append(base, l, 1 + gen() % 3000);
+        text.push_back('\n');
+    }
+    // the last document has no separator
+    text.append(base, 0, 100);
+    for (uint64_t i = 0, k = 0; i < text.size(); i++) {
+        doc.push_back(k);
+        k += text[i] == '\n';
+    }
+    doc.push_back(51);
+
+    gcis_dictionary<TypeParam> e, d;
+    e.encode_collection(text.data(), text.size(), '\n');
+    EXPECT_EQ(e.document_count(), 51u);
+    std::stringstream ss;
+    e.serialize(ss);
+    d.load(ss);
+    EXPECT_EQ(d.document_count(), 51u);
+
+    uint_t *SA, *DA;
+    unsigned char *str = d.decode_saca_da(&SA, &DA);
+    EXPECT_EQ(std::string((char *)str, text.size()), text);
+    uint64_t n = text.size();
+    std::string header((char *)&n, sizeof(size_t));
+    std::string sa = header, da = header;
+    for (uint64_t i = 0; i <= n; i++) {
+        ASSERT_EQ((uint64_t)DA[i], doc[SA[i]]);
+        if (i > 0) {
+            sa.append((char *)&SA[i], sizeof(uint_t));
+            da.append((char *)&DA[i], sizeof(uint_t));
+        }
+    }
+    delete[] str;
+    delete[] SA;
+    delete[] DA;
+
+    std::string sa_path = ::testing::TempDir() + "gcis_documents.sa";
+    std::string da_path = ::testing::TempDir() + "gcis_documents.da";
+    for (uint64_t memory : {(uint64_t)0, UINT64_MAX}) {
+        int sa_fd = open(sa_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int da_fd = open(da_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        delete[] d.decode_saca_da_external(sa_fd, da_fd, memory,
+                                           ::testing::TempDir());
+        close(sa_fd);
+        close(da_fd);
+        std::ifstream sa_in(sa_path, std::ios::binary);
+        std::ifstream da_in(da_path, std::ios::binary);
+        EXPECT_TRUE(std::string(std::istreambuf_iterator<char>(sa_in),
+                                std::istreambuf_iterator<char>()) == sa);
+        EXPECT_TRUE(std::string(std::istreambuf_iterator<char>(da_in),
+                                std::istreambuf_iterator<char>()) == da);
+    }
+
+    // a plain text is not a collection
+    gcis_dictionary<TypeParam> plain;
+    plain.encode(text.data(), text.size());
+    EXPECT_EQ(plain.document_count(), 0u);
+    EXPECT_THROW(plain.decode_saca_da(&SA, &DA), std::runtime_error);
+}
+
+
+// Checks count and locate against a scan of the text, for substrings of
+// the text of many lengths and for random patterns
+template <class codec_t>
+static void check_search_index(const std::string &text, uint32_t seed) {
+    gcis_dictionary<codec_t> d;
+    d.encode(text.data(), text.size());
+    gcis_search_index index;
+    index.build(d);
+    EXPECT_EQ(index.text_length(), text.size());
+
+    std::mt19937 gen(seed);
+    std::vector<std::string> patterns;
+    for (int k = 0; k < 200 && !text.empty(); k++) {
+        uint64_t len = 1 + gen() % std::min<uint64_t>(text.size(), 1 + k * 3);
+        patterns.push_back(text.substr(gen() % (text.size() - len + 1), len));
+    }
+    for (int k = 0; k < 50; k++) {
+        std::string p;
+        for (uint64_t len = 1 + gen() % 6; p.size() < len;) {
+            p.push_back('a' + gen() % 4);
+        }
+        patterns.push_back(p);
+    }
+    patterns.push_back("");
+    for (const std::string &p : patterns) {
+        std::vector<uint64_t> expected;
+        for (uint64_t i = p.empty() ? std::string::npos : text.find(p);
+             i != std::string::npos; i = text.find(p, i + 1)) {
+            expected.push_back(i);
+        }
+        ASSERT_EQ(index.count(p), expected.size()) << p;
+        ASSERT_TRUE(index.locate(p) == expected) << p;
+    }
+}
+
+TYPED_TEST(gcis_saca_codec, search_index){
+    uint32_t seed = 157;
+    check_search_index<TypeParam>(repetitive_text(50000, seed), seed);
+    // long runs of equal symbols
+    std::mt19937 gen(seed);
+    std::string text;
+    while (text.size() < 20000) {
+        text.append(1 + gen() % 50, 'a' + gen() % 3);
+    }
+    check_search_index<TypeParam>(text, seed);
+    // single runs longer than the rest of the text, which the sorts of the
+    // boundaries must not compare symbol by symbol
+    check_search_index<TypeParam>(std::string(100000, 'a'), seed);
+    text = repetitive_text(20000, seed);
+    text.append(50000, '\0');
+    text.append(repetitive_text(1000, seed + 1));
+    check_search_index<TypeParam>(text, seed);
+    std::string periodic;
+    while (periodic.size() < 60000) {
+        periodic += "ab";
+    }
+    check_search_index<TypeParam>(periodic + std::string(500, 'b') + periodic,
+                                seed);
+    check_search_index<TypeParam>("abracadabra", seed);
+    check_search_index<TypeParam>("a", seed);
+}
+
+// Checks lce and equal against a scan of the text, at random positions
+// and at the starts of repeated substrings
+template <class codec_t>
+static void check_fingerprints(const std::string &text, uint32_t seed) {
+    gcis_dictionary<codec_t> d;
+    d.encode(text.data(), text.size());
+    EXPECT_THROW(d.lce(0, 0), std::runtime_error);
+    d.build_fingerprints(seed);
+    uint64_t n = text.size();
+
+    std::mt19937 gen(seed);
+    typename gcis_dictionary<codec_t>::extract_context ctx;
+    std::vector<std::pair<uint64_t, uint64_t>> query;
+    std::vector<uint64_t> answer;
+    for (int q = 0; q < 500; q++) {
+        uint64_t i = gen() % (n + 2), j = gen() % (n + 2);
+        if (q % 2 && i < n) {
+            // another occurrence of a substring starting at i
+            uint64_t len = 1 + gen() % std::min<uint64_t>(n - i, 64);
+            uint64_t k = text.find(text.substr(i, len), gen() % (i + 1));
+            j = k == std::string::npos ? j : k;
+        }
+        uint64_t expected = 0;
+        while (i < n && j < n && std::max<uint64_t>(i, j) + expected < n &&
+               text[i + expected] == text[j + expected]) {
+            expected++;
+        }
+        ASSERT_EQ(d.lce(i, j, ctx), expected) << i << " " << j;
+        query.push_back(std::make_pair(i, j));
+        answer.push_back(expected);
+        uint64_t len = gen() % (expected + 3);
+        bool same = std::max<uint64_t>(i, j) <= n && len <= n - std::max<uint64_t>(i, j) &&
+                    text.compare(std::min<uint64_t>(i, n), len, text, std::min<uint64_t>(j, n),
+                                 len) == 0;
+        ASSERT_EQ(d.equal(i, j, len), same) << i << " " << j << " " << len;
+    }
+    std::vector<uint64_t> batch;
+    static_cast<gcis_interface &>(d).lce_batch(query, batch);
+    EXPECT_EQ(batch, answer);
+}
+
+TYPED_TEST(gcis_codec, fingerprints){
+    uint32_t seed = 173;
+    check_fingerprints<TypeParam>(repetitive_text(50000, seed), seed);
+    std::string runs(20000, 'a');
+    runs[12345] = 'b';
+    check_fingerprints<TypeParam>(runs, seed);
+    check_fingerprints<TypeParam>(std::string("abra\0cad\0abra", 14), seed);
+    check_fingerprints<TypeParam>("a", seed);
+}
+
+TEST(gcis_partial_sum, find){
+    std::mt19937 gen(61);
+    for (uint64_t n : {1, 31, 32, 33, 1000, 5000}) {
+        std::vector<uint64_t> len(n), sums(n);
+        for (uint64_t i = 0; i < n; i++) {
+            len[i] = 1 + gen() % 100;
+            sums[i] = i ? sums[i - 1] + len[i - 1] : 0;
+        }
+        auto len_f = [&](uint64_t i) { return len[i]; };
+        gcis_partial_sum ps, legacy, loaded;
+        ps.build(n, len_f);
+        legacy.build(sums);
+        std::stringstream ss;
+        ps.serialize(ss);
+        loaded.load(ss);
+        for (int q = 0; q < 2000; q++) {
+            uint64_t x = gen() % (sums.back() + len.back() + 10);
+            uint64_t expected =
+                std::upper_bound(sums.begin(), sums.end(), x) - sums.begin() - 1;
+            for (gcis_partial_sum *p : {&ps, &legacy, &loaded}) {
+                uint64_t sum;
+                EXPECT_EQ(p->find(x, len_f, sum), expected);
+                EXPECT_EQ(sum, sums[expected]);
+            }
+        }
+    }
+}